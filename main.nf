@@ -11,14 +11,16 @@
 // Include modules
 include { FASTQC } from './modules/fastqc.nf'
 include { TRIM_GALORE } from './modules/trim_galore.nf'
-include { BOWTIE2_BUILD } from './modules/bowtie2_build.nf'
 include { BOWTIE2_ALIGN } from './modules/bowtie2_align.nf'
 include { RNA_MAP_BIT_VECTORS } from './modules/rna_map_bit_vectors.nf'
+include { BOWTIE2_ALIGN_BIT_VECTORS } from './modules/bowtie2_align_bit_vectors.nf'
+include { RNA_MAP_BIT_VECTOR_SERVER } from './modules/rna_map_bit_vector_server.nf'
 include { WORKFLOW_STATS } from './modules/workflow_stats.nf'
 
 // Include subworkflows
 include { MAPPING } from './workflows/mapping.nf'
 include { PARALLEL_MAPPING } from './workflows/parallel_mapping.nf'
+include { BOWTIE2_INDEX } from './workflows/bowtie2_index.nf'
 
 // Workflow parameters are defined in conf/base.config
 // All parameters can be overridden via command-line or custom config files
@@ -29,6 +31,9 @@ workflow {
     if (!params.samples_csv && !(params.fasta && params.fastq1)) {
         exit 1, "ERROR: Must provide either --fasta/--fastq1 or --samples_csv"
     }
+    if (params.checkpoint_dir && (!params.summary_output_only || !(params.rejected_log in ['off', 'counts']))) {
+        exit 1, "ERROR: --checkpoint_dir needs --summary_output_only and --rejected_log off or counts"
+    }
     
     // Define input channel for samples
     def samples_ch = params.samples_csv
@@ -113,6 +118,45 @@ workflow {
                 "Sample ${sample_id}: Processing complete (parallel mode)"
             }
         
+        WORKFLOW_STATS.out.stats
+            .view { stats_file ->
+                "Workflow statistics: ${stats_file}"
+            }
+    } else if (params.fused_bit_vectors) {
+        // Fused processing: bowtie2 output is streamed into bit vector generation
+        BOWTIE2_INDEX(samples.map { sample_id, fasta, _fq1, _fq2, _dot_bracket -> [sample_id, fasta] })
+        FASTQC(samples, params.skip_fastqc, params.fastqc_args)
+        TRIM_GALORE(FASTQC.out, params.skip_trim_galore, params.tg_q_cutoff, params.tg_args)
+        TRIM_GALORE.out
+            .combine(BOWTIE2_INDEX.out.out, by: 0)
+            .map { sample_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2 ->
+                [sample_id, fasta, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2, trimmed_fq1, trimmed_fq2, dot_bracket]
+            }
+            .set { fused_input }
+        BOWTIE2_ALIGN_BIT_VECTORS(
+            fused_input,
+            params.bt2_alignment_args,
+            params.qscore_cutoff,
+            params.map_score_cutoff,
+            params.summary_output_only,
+            plot_seq
+        )
+        
+        // Aggregate all workflow statistics at the end
+        BOWTIE2_ALIGN_BIT_VECTORS.out.summary
+            .map { sample_id, _summary_file ->
+                def output_dir = sample_id ? file("${params.output_dir}/${sample_id}") : file("${params.output_dir}")
+                [sample_id, output_dir]
+            }
+            .set { stats_input_ch }
+        
+        WORKFLOW_STATS(stats_input_ch)
+        
+        BOWTIE2_ALIGN_BIT_VECTORS.out.summary
+            .view { sample_id, summary_file ->
+                "Sample ${sample_id}: ${summary_file} (fused mode)"
+            }
+        
         WORKFLOW_STATS.out.stats
             .view { stats_file ->
                 "Workflow statistics: ${stats_file}"
@@ -130,17 +174,46 @@ workflow {
         )
         
         // Generate bit vectors (Python)
-        RNA_MAP_BIT_VECTORS(
-            MAPPING.out.aligned,
-            params.qscore_cutoff,
-            params.map_score_cutoff,
-            params.summary_output_only,
-            plot_seq
-        )
+        if (params.bit_vector_server && params.samples_csv) {
+            // Batch samples that share a reference so it is loaded once per batch
+            MAPPING.out.aligned
+                .map { sample_id, sam, fasta, is_paired, dot_bracket ->
+                    [fasta.toRealPath().toString(), sample_id, sam, fasta, is_paired, dot_bracket]
+                }
+                .groupTuple(by: 0, size: params.bit_vector_server_batch, remainder: true)
+                .map { _key, sample_ids, sams, fastas, is_paired_list, dot_brackets ->
+                    [sample_ids, sams, fastas[0], is_paired_list, dot_brackets]
+                }
+                .set { server_input }
+            
+            RNA_MAP_BIT_VECTOR_SERVER(
+                server_input,
+                params.qscore_cutoff,
+                params.map_score_cutoff,
+                params.summary_output_only,
+                plot_seq
+            )
+            
+            // samples/<sample_id>/BitVector_Files/summary.csv -> [sample_id, summary]
+            RNA_MAP_BIT_VECTOR_SERVER.out.summaries
+                .flatten()
+                .map { summary_file -> [summary_file.parent.parent.name, summary_file] }
+                .set { bit_vector_summaries }
+        } else {
+            RNA_MAP_BIT_VECTORS(
+                MAPPING.out.aligned,
+                params.qscore_cutoff,
+                params.map_score_cutoff,
+                params.summary_output_only,
+                plot_seq
+            )
+            RNA_MAP_BIT_VECTORS.out.summary
+                .set { bit_vector_summaries }
+        }
         
         // Aggregate all workflow statistics at the end
         // Collect from output directory (all files already published)
-        RNA_MAP_BIT_VECTORS.out.summary
+        bit_vector_summaries
             .map { sample_id, _summary_file ->
                 def output_dir = sample_id ? file("${params.output_dir}/${sample_id}") : file("${params.output_dir}")
                 [sample_id, output_dir]
@@ -150,7 +223,7 @@ workflow {
         WORKFLOW_STATS(stats_input_ch)
         
         // Publish results
-        RNA_MAP_BIT_VECTORS.out.summary
+        bit_vector_summaries
             .view { sample_id, summary_file ->
                 "Sample ${sample_id}: ${summary_file}"
             }
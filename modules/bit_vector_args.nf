@@ -0,0 +1,30 @@
+/*
+ * Bit Vector Options
+ *
+ * Command line options of the bit vector CLIs (rna_map.pipeline.fused_bit_vectors
+ * and rna_map.pipeline.bit_vector_server), shared by every process that runs
+ * them. Options are named after their BitVectorConfig fields and turned into
+ * flags in one place: true is passed as a bare flag, false and null are left out.
+ */
+
+// Flags for the options set in params, overridden by the task's own options
+def bitVectorArgs(Map options) {
+    def shared = [
+        storage_format     : params.storage_format,
+        histogram_json     : params.histogram_json,
+        histogram_pickle   : params.histogram_pickle,
+        rejected_log       : params.rejected_log,
+        rejected_log_every : params.rejected_log_every,
+        dedup_cache_size   : params.dedup_cache_size,
+        collapse_duplicates: params.collapse_duplicates,
+        plot_mode          : params.plot_mode,
+        plot_top_n         : params.plot_top_n,
+        plot_min_reads     : params.plot_min_reads,
+    ]
+    (shared + options)
+        .findAll { _name, value -> value != null && value != false }
+        .collect { name, value ->
+            def flag = "--${name.replace('_', '-')}"
+            value == true ? flag : "${flag} ${value}"
+        }
+}
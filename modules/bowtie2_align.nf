@@ -28,7 +28,8 @@ process BOWTIE2_ALIGN {
         saveAs: { _filename -> 'alignment_stats.json' }
     
     script:
-    def index_name = fasta.baseName
+    // Index prefix from the index files, which may be shared with other FASTAs
+    def index_name = index1.name.replaceAll(/\.1\.bt2$/, '')
     // Check if trimmed_fq2 exists and is not empty placeholder
     def is_paired = (trimmed_fq2 && trimmed_fq2.toString().contains("trimmed_2"))
     def fastq_args = is_paired ? "-1 ${trimmed_fq1} -2 ${trimmed_fq2}" : "-U ${trimmed_fq1}"
@@ -0,0 +1,124 @@
+/*
+ * Fused Bowtie2 Alignment + Bit Vector Generation Process
+ *
+ * Pipes bowtie2's SAM output straight into bit vector generation, so
+ * alignment and bit vector generation overlap and no aligned.sam is written.
+ * Alignments are only kept on request (params.keep_alignments = "bam" or "cram").
+ * Produces the same outputs as BOWTIE2_ALIGN followed by RNA_MAP_BIT_VECTORS.
+ */
+
+include { bitVectorArgs } from './bit_vector_args.nf'
+
+process BOWTIE2_ALIGN_BIT_VECTORS {
+    tag "${sample_id ?: 'single_sample'}"
+    label 'process_high'
+
+    input:
+    tuple val(sample_id), path(fasta), path(index1), path(index2), path(index3), path(index4), path(index_rev1), path(index_rev2), path(trimmed_fq1), path(trimmed_fq2), path(dot_bracket)
+    val(bt2_args)
+    val(qscore_cutoff)
+    val(map_score_cutoff)
+    val(summary_output_only)
+    val(plot_sequence)
+
+    output:
+    tuple val(sample_id), path("summary.csv"), emit: summary
+    tuple val(sample_id), path("BitVector_Files/**"), emit: bitvector_files
+    path("alignment_stats.json"), emit: stats
+    path("aligned.{bam,cram}"), optional: true, emit: alignments
+
+    publishDir { sample_id ? "${params.output_dir}/${sample_id}/Mapping_Files" : "${params.output_dir}/Mapping_Files" },
+        mode: 'copy',
+        pattern: '{alignment_stats.json,aligned.bam,aligned.cram}',
+        saveAs: { filename -> filename }
+    publishDir { sample_id ? "${params.output_dir}/${sample_id}/BitVector_Files" : "${params.output_dir}/BitVector_Files" },
+        mode: 'copy',
+        pattern: 'summary.csv',
+        saveAs: { _filename -> 'summary.csv' }
+    publishDir { sample_id ? "${params.output_dir}/${sample_id}/BitVector_Files" : "${params.output_dir}/BitVector_Files" },
+        mode: 'copy',
+        pattern: 'BitVector_Files/**',
+        saveAs: { filename -> filename.replace('BitVector_Files/', '') }
+
+    script:
+    // Index prefix from the index files, which may be shared with other FASTAs
+    def index_name = index1.name.replaceAll(/\.1\.bt2$/, '')
+    def is_paired = (trimmed_fq2 && trimmed_fq2.toString().contains("trimmed_2"))
+    def fastq_args = is_paired ? "-1 ${trimmed_fq1} -2 ${trimmed_fq2}" : "-U ${trimmed_fq1}"
+    def is_paired_val = is_paired ? "True" : "False"
+    // bowtie2 and the bit vector workers run at the same time, so they split
+    // the task CPUs; each side gets at least one
+    def bt2_cpus = Math.max(1, Math.min(task.cpus - 1, Math.round(task.cpus * (params.fused_bowtie2_cpu_fraction as double)) as int))
+    def bv_cpus = Math.max(1, task.cpus - bt2_cpus)
+    // Convert semicolon-separated args to space-separated, add -p if not present
+    def bt2_args_list = bt2_args.split(';').findAll { str -> str.trim() }
+    if (!bt2_args_list.any { arg -> arg.startsWith('-p') }) {
+        bt2_args_list << "-p ${bt2_cpus}"
+    }
+    def bt2_cmd = bt2_args_list.join(' ')
+    def dot_bracket_val = (dot_bracket && !dot_bracket.toString().contains(".empty") && dot_bracket.toString() != "") ? dot_bracket.toString() : ""
+    def bv_args = [
+        "--fasta ${fasta}",
+        "--output-dir .",
+        "--summary-copy summary.csv",
+        "--use-cpp",
+    ]
+    if (is_paired) { bv_args << "--paired" }
+    if (dot_bracket_val) { bv_args << "--csv ${dot_bracket_val}" }
+    bv_args += bitVectorArgs(
+        qscore_cutoff: qscore_cutoff,
+        map_score_cutoff: map_score_cutoff,
+        summary_output_only: summary_output_only,
+        plot_sequence: plot_sequence,
+        num_workers: bv_cpus,
+        // Plots are rendered after bowtie2 has finished
+        plot_workers: task.cpus,
+        // Leave half of the task memory for histograms, plots and the interpreter
+        max_memory_mb: task.memory ? task.memory.toMega().intdiv(2) : null,
+    )
+    def keep = params.keep_alignments ?: "none"
+    def samtools_cmd = keep == "cram" ? "samtools view -C -T ${fasta} -o aligned.cram sam.fifo"
+        : keep == "bam" ? "samtools view -b -o aligned.bam sam.fifo"
+        : ""
+    // Use conda Python if available, otherwise use system python3
+    def python_cmd = System.getenv('CONDA_PREFIX') ? "${System.getenv('CONDA_PREFIX')}/bin/python3" : "python3"
+    """
+    set -o pipefail
+    echo "${is_paired_val}" > is_paired.txt
+
+    if [ -n "${samtools_cmd}" ]; then
+        # Compress a copy of the stream while bit vectors are generated
+        mkfifo sam.fifo
+        ${samtools_cmd} &
+        samtools_pid=\$!
+        bowtie2 ${bt2_cmd} -x ${index_name} ${fastq_args} 2> bowtie2_stderr.txt \\
+            | tee sam.fifo \\
+            | ${python_cmd} -m rna_map.pipeline.fused_bit_vectors ${bv_args.join(' ')}
+        wait \$samtools_pid
+        rm -f sam.fifo
+    else
+        bowtie2 ${bt2_cmd} -x ${index_name} ${fastq_args} 2> bowtie2_stderr.txt \\
+            | ${python_cmd} -m rna_map.pipeline.fused_bit_vectors ${bv_args.join(' ')}
+    fi
+
+    ${python_cmd} << 'PYTHON_SCRIPT'
+    import json
+    from datetime import datetime
+    from pathlib import Path
+    from rna_map.io.bowtie2_log import parse_bowtie2_log
+
+    stats = {
+        "sample_id": "${sample_id}",
+        "reference": "${fasta.getName()}",
+        "is_paired_end": ${is_paired_val},
+        "timestamp": datetime.now().isoformat(),
+        "bowtie2_args": "${bt2_cmd}",
+        "fused_bit_vectors": True,
+        "alignment": parse_bowtie2_log(Path("bowtie2_stderr.txt").read_text(), ${is_paired_val}),
+    }
+    with open("alignment_stats.json", "w") as f:
+        json.dump(stats, f, indent=2)
+    print("Alignment statistics saved to alignment_stats.json")
+    PYTHON_SCRIPT
+    """
+}
@@ -1,23 +1,54 @@
 /*
  * Bowtie2 Index Building Process
- * 
+ *
  * Reusable process for building Bowtie2 indices from FASTA files.
+ * Runs once per distinct reference (see workflows/bowtie2_index.nf).
+ *
+ * With params.bt2_index_cache set, indices are stored in that shared
+ * directory under the FASTA content hash and bowtie2 version, and later
+ * builds of the same reference link the cached index instead of rebuilding.
  */
 
 process BOWTIE2_BUILD {
-    tag "${sample_id}"
+    tag "${ref_key.take(12)}"
     label 'process_low'
-    
+
     input:
-    tuple val(sample_id), path(fasta), path(trimmed_fq1), path(trimmed_fq2), path(dot_bracket)
-    
+    tuple val(ref_key), path(fasta)  // ref_key: SHA-256 of the FASTA content
+
     output:
-    tuple val(sample_id), path(fasta), path("${fasta.baseName}.1.bt2"), path("${fasta.baseName}.2.bt2"), path("${fasta.baseName}.3.bt2"), path("${fasta.baseName}.4.bt2"), path("${fasta.baseName}.rev.1.bt2"), path("${fasta.baseName}.rev.2.bt2"), path(trimmed_fq1), path(trimmed_fq2), path(dot_bracket), emit: out
-    
+    tuple val(ref_key), path("${fasta.baseName}.1.bt2"), path("${fasta.baseName}.2.bt2"), path("${fasta.baseName}.3.bt2"), path("${fasta.baseName}.4.bt2"), path("${fasta.baseName}.rev.1.bt2"), path("${fasta.baseName}.rev.2.bt2"), emit: out
+
     script:
     def index_name = fasta.baseName
+    def cache_dir = params.bt2_index_cache ?: ""
     """
-    bowtie2-build ${fasta} ${index_name}
+    cache_dir="${cache_dir}"
+    if [ -z "\${cache_dir}" ]; then
+        bowtie2-build ${fasta} ${index_name}
+        exit 0
+    fi
+
+    # The index format depends on the bowtie2 version as well as the sequences
+    bt2_version=\$(bowtie2-build --version | awk 'NR == 1 { print \$NF }')
+    entry="\${cache_dir}/${ref_key}-bowtie2-\${bt2_version}"
+    suffixes="1.bt2 2.bt2 3.bt2 4.bt2 rev.1.bt2 rev.2.bt2"
+
+    if [ ! -d "\${entry}" ]; then
+        bowtie2-build ${fasta} ${index_name}
+        # Populate a private directory and rename it into place, so concurrent
+        # runs never see a partial entry; the loser of a race drops its copy
+        mkdir -p "\${cache_dir}"
+        tmp=\$(mktemp -d "\${cache_dir}/.tmp.XXXXXX")
+        for suffix in \${suffixes}; do
+            cp "${index_name}.\${suffix}" "\${tmp}/index.\${suffix}"
+        done
+        chmod 755 "\${tmp}"
+        mv -T "\${tmp}" "\${entry}" 2> /dev/null || rm -rf "\${tmp}"
+    else
+        for suffix in \${suffixes}; do
+            ln -s "\${entry}/index.\${suffix}" "${index_name}.\${suffix}"
+        done
+    fi
     """
 }
-
@@ -2,7 +2,7 @@
  * Join Bit Vector Files Process
  * 
  * Merges bit vector files from parallel processing into a single file.
- * Handles both text and JSON formats.
+ * Handles text, JSON and columnar formats.
  */
 
 process JOIN_BIT_VECTORS {
@@ -36,7 +36,7 @@ process JOIN_BIT_VECTORS {
     bitvector_files = [Path(f.strip().strip("'").strip('"')) for f in bitvector_files_str.split(',') if f.strip()]
     
     # Filter to only existing files that match bitvector pattern
-    bitvector_files = [f for f in bitvector_files if f.exists() and ('_bitvectors.txt' in str(f) or '_bitvectors.json' in str(f))]
+    bitvector_files = [f for f in bitvector_files if f.exists() and ('_bitvectors.txt' in str(f) or '_bitvectors.json' in str(f) or '_bitvectors.rmbv' in str(f))]
     
     if not bitvector_files:
         print(f"WARNING: No bit vector files found. Input was: {bitvector_files_str}", file=sys.stderr)
@@ -66,7 +66,11 @@ process JOIN_BIT_VECTORS {
         first_file = files_sorted[0]
         is_json = first_file.suffix == '.json'
         
-        if is_json:
+        if first_file.suffix == '.rmbv':
+            # Append columnar row groups without re-encoding them
+            from rna_map.io.columnar_storage import concatenate_columnar_files
+            concatenate_columnar_files(files_sorted, f"{ref_name}_bitvectors.rmbv")
+        elif is_json:
             # Merge JSON files
             merged_data = []
             for json_file in files_sorted:
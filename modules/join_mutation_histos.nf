@@ -2,7 +2,10 @@
  * Join Mutation Histograms Process
  * 
  * Merges mutation histogram files from parallel processing into a single file.
- * Handles both pickle (.p) and JSON formats.
+ * Chunks are streamed from their compact binary histograms (mutation_histos.rmh),
+ * falling back to the pickle file of older outputs for chunks that have none.
+ * Writes the merged histograms as binary, as pickle when params.histogram_pickle
+ * is set and as JSON when params.histogram_json is set.
  */
 
 process JOIN_MUTATION_HISTOS {
@@ -14,8 +17,9 @@ process JOIN_MUTATION_HISTOS {
     
     output:
     tuple val(sample_id), path("aligned.sam"), path(fasta), val(is_paired), path(dot_bracket), emit: out
-    path("mutation_histos.p"), emit: pickle_file
-    path("mutation_histos.json"), emit: json_file
+    path("mutation_histos.p"), emit: pickle_file, optional: true
+    path("mutation_histos.json"), emit: json_file, optional: true
+    path("mutation_histos.rmh"), emit: binary_file
     
     publishDir { sample_id ? "${params.output_dir}/${sample_id}/BitVector_Files" : "${params.output_dir}/BitVector_Files" },
         mode: 'copy',
@@ -23,66 +27,56 @@ process JOIN_MUTATION_HISTOS {
         saveAs: { filename -> filename }
     
     script:
+    def histogram_json_py = params.histogram_json ? "True" : "False"
+    def histogram_pickle_py = params.histogram_pickle ? "True" : "False"
     """
     # Create dummy aligned.sam (not used, but required for channel compatibility)
     touch aligned.sam
     
     python3 << 'PYTHON_SCRIPT'
     import sys
-    import pickle
-    import json
     from pathlib import Path
-    
-    # mut_histo_p_str and mut_histo_json_str are comma-separated strings of file paths
+    from rna_map.analysis.statistics import merge_mut_histo_dicts
+    from rna_map.io.histogram_binary import (
+        HISTO_BINARY_FILE_NAME,
+        merge_histogram_files,
+    )
+    from rna_map.mutation_histogram import (
+        get_mut_histos_from_pickle_file,
+        write_mut_histos_to_binary_file,
+        write_mut_histos_to_json_file,
+        write_mut_histos_to_pickle_file,
+    )
+    
+    # mut_histo_p_str is a comma-separated string of the chunks' binary
+    # histogram paths; older chunk outputs only have a pickle file next to it
     mut_histo_p_str = "${mut_histo_p_str}"
-    mut_histo_json_str = "${mut_histo_json_str}"
-    
-    # Split by comma and clean up paths
-    pickle_files = [Path(f.strip().strip("'").strip('"')) for f in mut_histo_p_str.split(',') if f.strip()]
-    
-    # Filter to only existing files
-    pickle_files = [f for f in pickle_files if f.exists() and f.suffix == '.p']
-    
-    if not pickle_files:
-        print("WARNING: No mutation histogram pickle files found", file=sys.stderr)
-        # Create empty files
-        with open("mutation_histos.p", "wb") as f:
-            pickle.dump({}, f)
-        with open("mutation_histos.json", "w") as f:
-            json.dump({}, f)
-        sys.exit(0)
-    
-    # Load and merge all mutation histograms
-    from rna_map.analysis.statistics import merge_all_merge_mut_histo_dicts
-    
-    all_mut_histos = []
-    for pickle_file in pickle_files:
-        pickle_path = Path(pickle_file)
-        if pickle_path.exists():
-            with open(pickle_path, "rb") as f:
-                mut_histos = pickle.load(f)
-                all_mut_histos.append(mut_histos)
-    
-    if not all_mut_histos:
-        print("WARNING: No mutation histograms loaded", file=sys.stderr)
-        with open("mutation_histos.p", "wb") as f:
-            pickle.dump({}, f)
-        with open("mutation_histos.json", "w") as f:
-            json.dump({}, f)
-        sys.exit(0)
-    
-    # Merge all mutation histograms
-    merged_histos = merge_all_merge_mut_histo_dicts(all_mut_histos)
-    
-    # Save merged pickle file
-    with open("mutation_histos.p", "wb") as f:
-        pickle.dump(merged_histos, f)
-    
-    # Save merged JSON file
-    from rna_map.mutation_histogram import write_mut_histos_to_json_file
-    write_mut_histos_to_json_file(merged_histos, "mutation_histos.json")
-    
-    print(f"Merged {len(all_mut_histos)} mutation histogram files")
+    histo_files = [Path(f.strip().strip("'").strip('"')) for f in mut_histo_p_str.split(',') if f.strip()]
+    binary_files = []
+    legacy_files = []
+    for histo_file in histo_files:
+        binary_file = histo_file.with_name(HISTO_BINARY_FILE_NAME)
+        pickle_file = histo_file.with_name("mutation_histos.p")
+        if binary_file.exists():
+            binary_files.append(binary_file)
+        elif pickle_file.exists():
+            legacy_files.append(pickle_file)
+    
+    if not binary_files and not legacy_files:
+        print("WARNING: No mutation histogram files found", file=sys.stderr)
+    
+    # Streaming merge: only the running total and one histogram are in memory
+    merged_histos = merge_histogram_files(binary_files)
+    for pickle_file in legacy_files:
+        merge_mut_histo_dicts(merged_histos, get_mut_histos_from_pickle_file(str(pickle_file)))
+    
+    write_mut_histos_to_binary_file(merged_histos, HISTO_BINARY_FILE_NAME)
+    if ${histogram_pickle_py}:
+        write_mut_histos_to_pickle_file(merged_histos, "mutation_histos.p")
+    if ${histogram_json_py}:
+        write_mut_histos_to_json_file(merged_histos, "mutation_histos.json")
+    
+    print(f"Merged {len(binary_files) + len(legacy_files)} mutation histogram files")
     print(f"Total sequences: {len(merged_histos)}")
     PYTHON_SCRIPT
     """
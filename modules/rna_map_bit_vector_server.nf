@@ -0,0 +1,63 @@
+/*
+ * RNA MAP Bit Vector Server Process
+ * 
+ * Generates bit vectors for a batch of samples aligned to the same reference.
+ * The reference set is loaded once and shared by long-lived worker processes
+ * that work through the batch, instead of one RNA_MAP_BIT_VECTORS task per sample.
+ * Outputs are published to the same per-sample locations as RNA_MAP_BIT_VECTORS.
+ */
+
+include { bitVectorArgs } from './bit_vector_args.nf'
+
+process RNA_MAP_BIT_VECTOR_SERVER {
+    tag "${fasta.getName()} (${sample_ids.size()} samples)"
+    label 'process_high'
+    
+    input:
+    tuple val(sample_ids), path(sams, stageAs: "sam_?/*"), path(fasta), val(is_paired_list), path(dot_brackets, stageAs: "db_?/*")
+    val(qscore_cutoff)
+    val(map_score_cutoff)
+    val(summary_output_only)
+    val(plot_sequence)
+    
+    output:
+    path("samples/*/BitVector_Files/summary.csv"), emit: summaries
+    path("samples/*/BitVector_Files/**"), emit: bitvector_files
+    
+    publishDir "${params.output_dir}",
+        mode: 'copy',
+        pattern: 'samples/**',
+        saveAs: { filename -> filename.replaceFirst(/^samples\//, '') }
+    
+    script:
+    // A single staged file is not passed as a list
+    def sam_list = sams instanceof List ? sams : [sams]
+    def dot_bracket_list = dot_brackets instanceof List ? dot_brackets : [dot_brackets]
+    def rows = (0..<sample_ids.size()).collect { i ->
+        def db = dot_bracket_list[i].toString()
+        def db_val = db.contains(".empty") ? "" : db
+        "${sample_ids[i]},${sam_list[i]},${is_paired_list[i]},${db_val}"
+    }
+    def bv_args = [
+        "--fasta ${fasta}",
+        "--manifest manifest.csv",
+        "--output-dir samples",
+    ] + bitVectorArgs(
+        qscore_cutoff: qscore_cutoff,
+        map_score_cutoff: map_score_cutoff,
+        summary_output_only: summary_output_only,
+        plot_sequence: plot_sequence,
+        num_workers: task.cpus,
+        plot_workers: task.cpus,
+    )
+    // Use conda Python if available, otherwise use system python3
+    def python_cmd = System.getenv('CONDA_PREFIX') ? "${System.getenv('CONDA_PREFIX')}/bin/python3" : "python3"
+    """
+    cat > manifest.csv << 'MANIFEST'
+    sample_id,sam,paired,dot_bracket
+    ${rows.join('\n    ')}
+    MANIFEST
+    
+    ${python_cmd} -m rna_map.pipeline.bit_vector_server ${bv_args.join(' ')}
+    """
+}
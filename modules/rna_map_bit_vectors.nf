@@ -5,6 +5,8 @@
  * This is specific to RNA MAP analysis but can be reused in other workflows.
  */
 
+include { bitVectorArgs } from './bit_vector_args.nf'
+
 process RNA_MAP_BIT_VECTORS {
     tag "${sample_id ?: 'single_sample'}"
     label 'process_high'
@@ -35,48 +37,32 @@ process RNA_MAP_BIT_VECTORS {
     
     script:
     def dot_bracket_val = (dot_bracket && !dot_bracket.toString().contains(".empty") && dot_bracket.toString() != "") ? dot_bracket.toString() : ""
-    def is_paired_py = (is_paired == "True") ? "True" : "False"
-    def summary_only_py = summary_output_only ? "True" : "False"
-    def plot_sequence_py = plot_sequence ? "True" : "False"
+    def bv_args = [
+        "--sam ${sam}",
+        "--fasta ${fasta}",
+        "--output-dir .",
+        "--summary-copy summary.csv",
+    ]
+    if (is_paired == "True") { bv_args << "--paired" }
+    if (dot_bracket_val) { bv_args << "--csv ${dot_bracket_val}" }
+    bv_args += bitVectorArgs(
+        qscore_cutoff: qscore_cutoff,
+        map_score_cutoff: map_score_cutoff,
+        summary_output_only: summary_output_only,
+        plot_sequence: plot_sequence,
+        num_workers: task.cpus,
+        plot_workers: task.cpus,
+        // Leave half of the task memory for histograms, plots and the interpreter
+        max_memory_mb: task.memory ? task.memory.toMega().intdiv(2) : null,
+        // Checkpoints outside the work directory, so a retried task resumes
+        checkpoint_dir: params.checkpoint_dir ? "${params.checkpoint_dir}/${sample_id ?: 'single_sample'}" : null,
+        resume: params.checkpoint_dir as boolean,
+        checkpoint_every: params.checkpoint_dir ? params.checkpoint_every : 0,
+    )
     // Use conda Python if available, otherwise use system python3
     def python_cmd = System.getenv('CONDA_PREFIX') ? "${System.getenv('CONDA_PREFIX')}/bin/python3" : "python3"
     """
-    ${python_cmd} << 'PYTHON_SCRIPT'
-    import sys
-    from pathlib import Path
-    from rna_map.pipeline.functions import generate_bit_vectors
-    from rna_map.core.config import BitVectorConfig
-    
-    sam_path = Path("${sam}")
-    fasta_path = Path("${fasta}")
-    dot_bracket_path = Path("${dot_bracket_val}") if "${dot_bracket_val}" else None
-    is_paired = ${is_paired_py}
-    
-    config = BitVectorConfig(
-        qscore_cutoff=${qscore_cutoff},
-        map_score_cutoff=${map_score_cutoff},
-        summary_output_only=${summary_only_py},
-        plot_sequence=${plot_sequence_py}
-    )
-    
-    result = generate_bit_vectors(
-        sam_path=sam_path,
-        fasta=fasta_path,
-        output_dir=Path("."),
-        config=config,
-        csv_file=dot_bracket_path,
-        paired=is_paired
-    )
-    
-    import shutil
-    import sys
-    if result.summary_path.exists():
-        shutil.copy(result.summary_path, "summary.csv")
-        print(f"Copied summary to summary.csv from {result.summary_path}")
-    else:
-        print(f"ERROR: Summary file not found at {result.summary_path}", file=sys.stderr)
-        sys.exit(1)
-    PYTHON_SCRIPT
+    ${python_cmd} -m rna_map.pipeline.fused_bit_vectors ${bv_args.join(' ')}
     """
 }
 
@@ -6,7 +6,7 @@
  * 
  * This process runs at the end and collects:
  * - Bowtie2 alignment statistics
- * - Bit vector generation statistics
+ * - Bit vector generation statistics (summary.csv and bit_vector_stats.json)
  * - Overall workflow summary
  */
 
@@ -173,6 +173,51 @@ process WORKFLOW_STATS {
         except Exception as e:
             stats["bit_vectors"]["error"] = f"Could not parse summary CSV: {str(e)}"
     
+    # Load bit vector stage timings from BitVector_Files
+    # Handle both single file (non-parallel) and multiple chunk files (parallel)
+    bv_stats_files = []
+    single_bv_stats_file = output_dir / "BitVector_Files" / "bit_vector_stats.json"
+    if single_bv_stats_file.exists():
+        bv_stats_files = [single_bv_stats_file]
+    elif output_dir.parent.exists():
+        # Look for pattern: <sample_id>_chunk*/BitVector_Files/bit_vector_stats.json
+        for chunk_dir in output_dir.parent.iterdir():
+            if chunk_dir.is_dir() and sample_id in chunk_dir.name and "_chunk" in chunk_dir.name:
+                chunk_stats = chunk_dir / "BitVector_Files" / "bit_vector_stats.json"
+                if chunk_stats.exists():
+                    bv_stats_files.append(chunk_stats)
+    
+    if bv_stats_files:
+        performance = {
+            "engine": None,
+            "reads": 0,
+            "accepted": 0,
+            "bytes_read": 0,
+            "wall_seconds": 0.0,
+            "stage_seconds": {},
+            "rejects": {},
+        }
+        for stats_file in bv_stats_files:
+            try:
+                with open(stats_file) as f:
+                    chunk_data = json.load(f)
+                performance["engine"] = performance["engine"] or chunk_data.get("engine")
+                for key in ("reads", "accepted", "bytes_read", "wall_seconds"):
+                    performance[key] += chunk_data.get(key, 0)
+                for group in ("stage_seconds", "rejects"):
+                    for name, value in chunk_data.get(group, {}).items():
+                        performance[group][name] = performance[group].get(name, 0) + value
+            except Exception as e:
+                performance["error"] = f"Could not load bit vector stats from {stats_file}: {str(e)}"
+        # Time spent producing bit vectors, summed over chunks
+        generation_seconds = performance["wall_seconds"] - sum(
+            performance["stage_seconds"].get(stage, 0) for stage in ("plots", "summary")
+        )
+        performance["reads_per_sec"] = (performance["reads"] / generation_seconds) if generation_seconds > 0 else 0
+        if len(bv_stats_files) > 1:
+            performance["chunks_processed"] = len(bv_stats_files)
+        stats["bit_vectors"]["performance"] = performance
+    
     # Calculate overall summary statistics
     if "total_reads" in stats["alignment"]:
         total_reads = stats["alignment"]["total_reads"]
@@ -198,6 +243,7 @@ process WORKFLOW_STATS {
     stats["files"] = {
         "alignment_stats": alignment_stats_path,
         "bitvector_summary": str(summary_file) if summary_file.exists() else None,
+        "bit_vector_stats": str(bv_stats_files[0]) if bv_stats_files else None,
         "sam_file": str(output_dir / "Mapping_Files" / "aligned.sam") if (output_dir / "Mapping_Files" / "aligned.sam").exists() else None
     }
     
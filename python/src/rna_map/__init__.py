@@ -11,6 +11,7 @@ Package Structure:
     - pipeline: Pipeline orchestration (Mapper, BitVectorGenerator)
     - analysis: Mutation analysis (MutationHistogram, statistics)
     - visualization: Plotting and visualization (Plotly-based plots)
+    - benchmark: Synthetic reads and throughput benchmarks for bit vector engines
 
 For detailed documentation, see CODE_DOCUMENTATION.md
 """
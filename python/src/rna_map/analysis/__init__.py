@@ -5,6 +5,8 @@ including mutation histograms, bit vector iteration, and statistical calculation
 """
 
 from .bit_vector_iterator import BitVectorIterator
+from .deletion_ambiguity import DeletionAmbiguityIndex
+from .histogram_accumulator import HistogramAccumulator
 from .mutation_histogram import MutationHistogram
 from .statistics import (
     get_dataframe,
@@ -15,6 +17,8 @@ from .statistics import (
 __all__ = [
     "MutationHistogram",
     "BitVectorIterator",
+    "DeletionAmbiguityIndex",
+    "HistogramAccumulator",
     "get_dataframe",
     "merge_mut_histo_dicts",
     "merge_all_merge_mut_histo_dicts",
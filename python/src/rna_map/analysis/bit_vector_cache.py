@@ -0,0 +1,115 @@
+"""Cache of bit vectors for identical alignments.
+
+Amplicon libraries are highly redundant: many reads share reference,
+position, CIGAR and sequence, and their qualities only matter as pass or
+fail against the quality cutoff. Such reads produce the same bit vector, so
+it is computed once and shared. Cached bit vectors must not be modified.
+"""
+
+from collections import OrderedDict
+from typing import Any
+
+from rna_map.analysis.stage_stats import StageStats
+
+DEFAULT_CACHE_SIZE = 1 << 16
+
+
+class BitVectorCache:
+    """Bounded least-recently-used cache of bit vector data.
+
+    Attributes:
+        max_size: Maximum number of cached bit vectors
+        hits: Lookups answered from the cache
+        misses: Lookups that had to compute the bit vector
+        evictions: Bit vectors dropped to stay within max_size
+    """
+
+    def __init__(self, max_size: int, min_qual_char: int) -> None:
+        """Initialize BitVectorCache.
+
+        Args:
+            max_size: Maximum number of cached bit vectors
+            min_qual_char: Quality characters above this code pass the cutoff
+
+        Raises:
+            ValueError: If max_size is smaller than 1
+        """
+        if max_size < 1:
+            raise ValueError("max_size must be at least 1")
+        self.max_size = max_size
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+        self.__entries: OrderedDict[tuple, Any] = OrderedDict()
+        # Quality string -> pass/fail string, e.g. "II#I" -> "1101"
+        self.__qual_bins = {
+            code: "1" if code > min_qual_char else "0" for code in range(256)
+        }
+        self.__reported = (0, 0, 0)
+
+    def __len__(self) -> int:
+        return len(self.__entries)
+
+    def key(self, reads: list) -> tuple:
+        """Get the alignment signature of a read or mate pair.
+
+        Args:
+            reads: AlignedRead objects
+
+        Returns:
+            Hashable signature; reads with equal signatures have equal bit
+            vectors
+        """
+        bins = self.__qual_bins
+        return tuple(
+            (read.rname, read.pos, read.cigar, read.seq, read.qual.translate(bins))
+            for read in reads
+        )
+
+    def get(self, key: tuple) -> Any | None:
+        """Look up the bit vector data of a signature.
+
+        Args:
+            key: Signature from key()
+
+        Returns:
+            Cached bit vector data, or None if it is not cached
+        """
+        data = self.__entries.get(key)
+        if data is None:
+            self.misses += 1
+            return None
+        self.hits += 1
+        self.__entries.move_to_end(key)
+        return data
+
+    def put(self, key: tuple, data: Any) -> None:
+        """Cache the bit vector data of a signature.
+
+        Args:
+            key: Signature from key()
+            data: Bit vector data
+        """
+        self.__entries[key] = data
+        if len(self.__entries) > self.max_size:
+            self.__entries.popitem(last=False)
+            self.evictions += 1
+
+    @property
+    def hit_rate(self) -> float:
+        """Fraction of lookups answered from the cache."""
+        lookups = self.hits + self.misses
+        return self.hits / lookups if lookups else 0.0
+
+    def report(self, stats: StageStats) -> None:
+        """Add the lookups since the last report to stage counters.
+
+        Args:
+            stats: Stats that receive dedup_hits, dedup_misses and
+                dedup_evictions
+        """
+        hits, misses, evictions = self.__reported
+        stats.count("dedup_hits", self.hits - hits)
+        stats.count("dedup_misses", self.misses - misses)
+        stats.count("dedup_evictions", self.evictions - evictions)
+        self.__reported = (self.hits, self.misses, self.evictions)
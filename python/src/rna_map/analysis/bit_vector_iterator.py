@@ -1,11 +1,37 @@
 """Bit vector iterator for generating bit vectors from SAM files."""
 
+import itertools
 from pathlib import Path
-import re
+import time
 
-from rna_map import settings
+import numpy as np
+
+from rna_map.analysis.bit_vector_cache import BitVectorCache
+from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
+from rna_map.analysis.stage_stats import StageStats
 from rna_map.core.bit_vector import BitVector, BitVectorSymbols
-from rna_map.io.fastq import parse_phred_qscore_file
+from rna_map.core.cigar import (
+    MATCH_OPS,
+    OP_D,
+    OP_I,
+    OP_M,
+    OP_MASK,
+    OP_N,
+    OP_S,
+    OP_SHIFT,
+    REF_OPS,
+    last_consuming_op,
+    parse_cigar,
+)
+from rna_map.core.dense_bit_vector import (
+    CONFLICT_TABLE,
+    ENCODE,
+    ENCODE_TABLE,
+    SYMBOLS,
+    UNRESOLVED_CONFLICTS,
+    DenseBitVector,
+    merge_dense_bit_vectors,
+)
 from rna_map.io.sam import (
     AlignedRead,
     PairedSamIterator,
@@ -15,6 +41,23 @@ from rna_map.logger import get_logger
 
 log = get_logger("BIT_VECTOR")
 
+# Quality characters are Phred+33 (see resources/phred_ascii.txt)
+PHRED_OFFSET = 33
+# Match runs shorter than this use the scalar loop; numpy call overhead
+# outweighs the vectorized comparison for a handful of bases
+MIN_VECTOR_RUN = 16
+# References made of these bases compare like the aligner, so MD tags of
+# reads aligned to them can stand in for the reference comparison
+PLAIN_BASES = frozenset("ACGTN")
+# Merged symbol of two overlapping mates by (mate 1, mate 2) symbol, for
+# the symbol pairs CONFLICT_TABLE has a rule for
+MATE_CONFLICTS = {
+    (bit1, bit2): SYMBOLS[CONFLICT_TABLE[code1, code2]]
+    for bit1, code1 in ENCODE.items()
+    for bit2, code2 in ENCODE.items()
+    if bit1 != "N" and bit2 != "N" and not UNRESOLVED_CONFLICTS[code1, code2]
+}
+
 
 class BitVectorIterator:
     """Generate bit vectors from SAM files.
@@ -24,42 +67,66 @@ class BitVectorIterator:
 
     def __init__(
         self,
-        sam_path: Path | str,
+        sam_path: Path | str | None,
         ref_seqs: dict[str, str],
         paired: bool,
         qscore_cutoff: int = 25,
         num_of_surbases: int = 10,
         use_pysam: bool = False,
+        dense: bool = False,
+        stats: StageStats | None = None,
+        ambig_index: DeletionAmbiguityIndex | None = None,
+        cache_size: int = 0,
     ) -> None:
         """Initialize BitVectorIterator.
 
         Args:
-            sam_path: Path to SAM file
+            sam_path: Path to SAM file, or None to only convert reads passed
+                to get_bit_vector
             ref_seqs: Dictionary of reference sequences
             paired: Whether reads are paired-end
             qscore_cutoff: Quality score cutoff (default: 25)
             num_of_surbases: Number of surrounding bases for ambiguity check
             use_pysam: If True, use pysam for SAM parsing (faster, more robust)
+            dense: If True, produce DenseBitVector data instead of dicts
+            stats: If given, time spent parsing and converting reads is added
+                to its "parse" and "kernel" stages
+            ambig_index: Deletion ambiguity cache to reuse, e.g. one shared by
+                all samples of a bit vector server; a new one if None
+            cache_size: Number of bit vectors kept for reuse by identical
+                alignments (0 disables the cache); reads with a cached
+                alignment share its bit vector data
         """
-        sam_path_str = str(sam_path)
-        if paired:
-            self.__sam_iterator: PairedSamIterator | SingleSamIterator = (
-                PairedSamIterator(sam_path_str, ref_seqs, use_pysam=use_pysam)
-            )
-        else:
-            self.__sam_iterator = SingleSamIterator(sam_path_str, ref_seqs, use_pysam=use_pysam)
+        self.__sam_iterator: PairedSamIterator | SingleSamIterator | None = None
+        if sam_path is not None:
+            sam_path_str = str(sam_path)
+            if paired:
+                self.__sam_iterator = PairedSamIterator(
+                    sam_path_str, ref_seqs, use_pysam=use_pysam
+                )
+            else:
+                self.__sam_iterator = SingleSamIterator(
+                    sam_path_str, ref_seqs, use_pysam=use_pysam
+                )
         self.count = 0
         self.rejected = 0
         self.__ref_seqs = ref_seqs
         self.__paired = paired
-        self.__cigar_pattern = re.compile(r"(\d+)([A-Z]{1})")
-        self.__phred_qscores = parse_phred_qscore_file(
-            settings.get_py_path() / "resources" / "phred_ascii.txt"
-        )
+        self.__min_qual_char = PHRED_OFFSET + qscore_cutoff
         self.__bases = ["A", "C", "G", "T"]
         self.__qscore_cutoff = qscore_cutoff
-        self.__num_of_surbases = num_of_surbases
+        self.ambig_index = ambig_index or DeletionAmbiguityIndex(num_of_surbases)
         self.__bts = BitVectorSymbols()
+        self.__dense = dense
+        self.__stats = stats
+        # Whether the MD tag fast path may be used, by reference name
+        self.__plain_refs: dict[str, bool] = {}
+        # ASCII buffer of each reference sequence, read without copies by
+        # the vectorized match runs
+        self.__ref_codes: dict[str, bytes] = {}
+        self.cache = (
+            BitVectorCache(cache_size, self.__min_qual_char) if cache_size else None
+        )
 
     def __iter__(self):
         """Return iterator."""
@@ -75,18 +142,64 @@ class BitVectorIterator:
             StopIteration: When no more reads
             ValueError: If read aligned to unknown reference
         """
+        if self.__sam_iterator is None:
+            raise StopIteration
         self.count += 1
+        if self.__stats is None:
+            return self.get_bit_vector(next(self.__sam_iterator))
+        start = time.perf_counter()
         reads = next(self.__sam_iterator)
+        parsed = time.perf_counter()
+        bit_vector = self.get_bit_vector(reads)
+        self.__stats.add("parse", parsed - start)
+        self.__stats.add("kernel", time.perf_counter() - parsed)
+        return bit_vector
+
+    def skip(self, num_records: int) -> int:
+        """Advance past SAM records without generating their bit vectors.
+
+        Args:
+            num_records: Number of reads (or mate pairs) to skip
+
+        Returns:
+            Number of records skipped, fewer if the file ends first
+        """
+        if self.__sam_iterator is None:
+            return 0
+        skipped = sum(1 for _ in itertools.islice(self.__sam_iterator, num_records))
+        self.count += skipped
+        return skipped
+
+    def get_bit_vector(self, reads: list[AlignedRead]) -> BitVector:
+        """Generate the bit vector for a single read or a mate pair.
+
+        Args:
+            reads: List with one read (single-end) or both mates (paired-end)
+
+        Returns:
+            BitVector object
+
+        Raises:
+            ValueError: If read aligned to unknown reference
+        """
         for read in reads:
             if read.rname not in self.__ref_seqs:
                 raise ValueError(
                     f"read {read.qname} aligned to {read.rname} which is not in "
                     "the reference fasta"
                 )
+        cache = self.cache
+        if cache is not None:
+            key = cache.key(reads)
+            data = cache.get(key)
+            if data is not None:
+                return BitVector(reads, data)
         if self.__paired:
             data = self.__get_bit_vector_paired(reads[0], reads[1])
         else:
             data = self.__get_bit_vector_single(reads[0])
+        if cache is not None:
+            cache.put(key, data)
         return BitVector(reads, data)
 
     def __get_bit_vector_single(self, read: AlignedRead) -> dict[int, str]:
@@ -114,34 +227,121 @@ class BitVectorIterator:
         Returns:
             Dictionary mapping position to bit value
         """
-        bitvector: dict[int, str] = {}
+        if self.__is_full_match(read, ref_seq):
+            return self.__convert_full_match(read)
         read_seq = read.seq
         q_scores = read.qual
         i = read.pos
         j = 0
-        cigar_ops = self._parse_cigar(read.cigar)
-        op_index = 0
-        while op_index < len(cigar_ops):
-            op = cigar_ops[op_index]
-            desc, length = op[1], int(op[0])
-            if desc == "M":
+        cigar_ops = self._parse_cigar(read)
+        if cigar_ops is None:
+            log.warn(f"unknown cigar op encounters: {read.cigar}")
+            return self.__new_bit_vector(read.pos, ())
+        # Hard clips and padding after a soft clip do not stop it trailing
+        last = last_consuming_op(cigar_ops)
+        bitvector = self.__new_bit_vector(read.pos, cigar_ops, last)
+        for op_index, op in enumerate(cigar_ops):
+            code, length = op & OP_MASK, op >> OP_SHIFT
+            if code in MATCH_OPS:
                 i, j = self._process_match_operation(
                     bitvector, read_seq, q_scores, ref_seq, i, j, length
                 )
-            elif desc == "D":
+            elif code == OP_D:
                 i = self._process_deletion_operation(bitvector, ref_seq, i, length)
-            elif desc == "I":
+            elif code == OP_I:
                 j += length
-            elif desc == "S":
+            elif code == OP_S:
                 i, j = self._process_soft_clip_operation(
-                    bitvector, i, j, length, op_index, len(cigar_ops)
+                    bitvector, i, j, length, op_index, last + 1
                 )
-            else:
-                log.warn(f"unknown cigar op encounters: {desc}")
-                return {}
-            op_index += 1
+            elif code == OP_N:
+                # Skipped reference (spliced alignment) carries no data
+                i += length
+            # Hard clips and padding consume neither read nor reference
         return bitvector
 
+    def __is_full_match(self, read: AlignedRead, ref_seq: str) -> bool:
+        """Check if the MD tag shows the read matches the reference throughout.
+
+        An all-match CIGAR ("148M") with an MD tag that is the same plain
+        count ("148") has no mismatches, insertions, deletions or clips.
+        The MD tag is only trusted for references of upper case A/C/G/T/N,
+        where the aligner's comparison is the same as ours.
+
+        Args:
+            read: AlignedRead object
+            ref_seq: Reference sequence
+
+        Returns:
+            True if the read can skip the reference comparison
+        """
+        cigar = read.cigar
+        if cigar[-1:] != "M" or cigar[:-1] != read.md_string:
+            return False
+        if not read.md_string.isdigit():
+            return False
+        plain = self.__plain_refs.get(read.rname)
+        if plain is None:
+            plain = set(ref_seq) <= PLAIN_BASES
+            self.__plain_refs[read.rname] = plain
+        return plain
+
+    def __convert_full_match(self, read: AlignedRead) -> dict[int, str]:
+        """Convert a read without edits to a bit vector from its qualities.
+
+        Every base matches the reference, so each position is nomut where
+        the quality passes the cutoff and ambiguous elsewhere.
+
+        Args:
+            read: AlignedRead object that passed __is_full_match
+
+        Returns:
+            Dictionary mapping position to bit value
+        """
+        q_scores = read.qual
+        length = len(q_scores)
+        pos = read.pos
+        nomut, ambig = self.__bts.nomut_bit, self.__bts.ambig_info
+        bitvector = self.__new_bit_vector(pos, (length << OP_SHIFT | OP_M,))
+        if length < MIN_VECTOR_RUN:
+            min_qual = self.__min_qual_char
+            for idx, q in enumerate(q_scores):
+                bitvector[pos + idx] = nomut if ord(q) > min_qual else ambig
+            return bitvector
+        quals = np.frombuffer(q_scores.encode(), dtype=np.uint8)
+        symbols = np.where(
+            quals > self.__min_qual_char, ord(nomut), ord(ambig)
+        ).astype(np.uint8)
+        if isinstance(bitvector, DenseBitVector):
+            bitvector.set_codes(pos, ENCODE_TABLE[symbols])
+        else:
+            bitvector.update(zip(range(pos, pos + length), symbols.tobytes().decode()))
+        return bitvector
+
+    def __new_bit_vector(
+        self, pos: int, cigar_ops: tuple[int, ...], last: int = -1
+    ) -> dict[int, str] | DenseBitVector:
+        """Create an empty bit vector for a read.
+
+        Dense bit vectors are sized to the reference span of the CIGAR:
+        match, deletion and skip runs, plus a trailing soft clip marked as
+        missing.
+
+        Args:
+            pos: Reference position of the first aligned base
+            cigar_ops: Packed CIGAR operations
+            last: Index of the last op that is not a hard clip or padding
+
+        Returns:
+            Empty dictionary or DenseBitVector
+        """
+        if not self.__dense:
+            return {}
+        span = sum(op >> OP_SHIFT for op in cigar_ops if op & OP_MASK in REF_OPS)
+        if last >= 0 and cigar_ops[last] & OP_MASK == OP_S:
+            span += cigar_ops[last] >> OP_SHIFT
+        return DenseBitVector(pos, span)
+
     def _process_match_operation(
         self,
         bitvector: dict[int, str],
@@ -166,8 +366,13 @@ class BitVectorIterator:
         Returns:
             Tuple of (new_i, new_j) positions
         """
+        if length >= MIN_VECTOR_RUN:
+            self.__process_match_run(
+                bitvector, read_seq, q_scores, ref_seq, i, j, length
+            )
+            return i + length, j + length
         for _ in range(length):
-            if self.__phred_qscores[q_scores[j]] > self.__qscore_cutoff:
+            if ord(q_scores[j]) > self.__min_qual_char:
                 if read_seq[j] != ref_seq[i - 1]:
                     bitvector[i] = read_seq[j]
                 else:
@@ -178,6 +383,45 @@ class BitVectorIterator:
             j += 1
         return i, j
 
+    def __process_match_run(
+        self,
+        bitvector: dict[int, str] | DenseBitVector,
+        read_seq: str,
+        q_scores: str,
+        ref_seq: str,
+        i: int,
+        j: int,
+        length: int,
+    ) -> None:
+        """Vectorized quality filter and mismatch detection for a match run.
+
+        Compares the whole run against the reference at once and writes
+        the same symbols as the scalar loop in _process_match_operation.
+
+        Args:
+            bitvector: Bit vector to update
+            read_seq: Read sequence
+            q_scores: Quality scores
+            ref_seq: Reference sequence
+            i: Reference position
+            j: Read position
+            length: Operation length
+        """
+        quals = np.frombuffer(q_scores[j : j + length].encode(), dtype=np.uint8)
+        bases = np.frombuffer(read_seq[j : j + length].encode(), dtype=np.uint8)
+        ref_codes = self.__ref_codes.get(ref_seq)
+        if ref_codes is None:
+            ref_codes = self.__ref_codes[ref_seq] = ref_seq.encode()
+        ref = np.frombuffer(ref_codes, dtype=np.uint8, count=length, offset=i - 1)
+        symbols = np.where(bases != ref, bases, ord(self.__bts.nomut_bit))
+        symbols = np.where(
+            quals > self.__min_qual_char, symbols, ord(self.__bts.ambig_info)
+        ).astype(np.uint8)
+        if isinstance(bitvector, DenseBitVector):
+            bitvector.set_codes(i, ENCODE_TABLE[symbols])
+        else:
+            bitvector.update(zip(range(i, i + length), symbols.tobytes().decode()))
+
     def _process_deletion_operation(
         self, bitvector: dict[int, str], ref_seq: str, i: int, length: int
     ) -> int:
@@ -195,7 +439,7 @@ class BitVectorIterator:
         for _ in range(length - 1):
             bitvector[i] = self.__bts.ambig_info
             i += 1
-        is_ambig = self.__calc_ambig_reads(ref_seq, i, length)
+        is_ambig = self.ambig_index.is_ambiguous(ref_seq, i, length)
         if is_ambig:
             bitvector[i] = self.__bts.ambig_info
         else:
@@ -250,45 +494,22 @@ class BitVectorIterator:
         bit_vector = self.__merge_paired_bit_vectors(bit_vector_1, bit_vector_2)
         return bit_vector
 
-    def _parse_cigar(self, cigar_string: str) -> list[tuple[str, ...]]:
-        """Parse CIGAR string.
+    def _parse_cigar(self, read: AlignedRead) -> tuple[int, ...] | None:
+        """Get the packed CIGAR operations of a read.
 
-        Args:
-            cigar_string: CIGAR string
-
-        Returns:
-            List of (length, operation) tuples
-        """
-        return re.findall(self.__cigar_pattern, cigar_string)
-
-    def __calc_ambig_reads(self, ref_seq: str, i: int, length: int) -> bool:
-        """Calculate if deletion is ambiguous.
+        Reads from BAM files carry their binary CIGAR; text CIGARs are
+        decoded once per distinct string.
 
         Args:
-            ref_seq: Reference sequence
-            i: Position
-            length: Deletion length
+            read: AlignedRead object
 
         Returns:
-            True if ambiguous, False otherwise
+            Packed operations (see rna_map.core.cigar), or None if the CIGAR
+            has an op outside CIGAR_OPS
         """
-        orig_del_start = i - length + 1
-        orig_sur_start = orig_del_start - self.__num_of_surbases
-        orig_sur_end = i + self.__num_of_surbases
-        orig_sur_seq = (
-            ref_seq[orig_sur_start - 1 : orig_del_start - 1] + ref_seq[i:orig_sur_end]
-        )
-        for new_del_end in range(i - length, i + length + 1):
-            if new_del_end == i:
-                continue
-            new_del_start = new_del_end - length + 1
-            sur_seq = (
-                ref_seq[orig_sur_start - 1 : new_del_start - 1]
-                + ref_seq[new_del_end:orig_sur_end]
-            )
-            if sur_seq == orig_sur_seq:
-                return True
-        return False
+        if read.cigar_ops is not None:
+            return read.cigar_ops
+        return parse_cigar(read.cigar)
 
     def __merge_paired_bit_vectors(
         self, bit_vector_1: dict[int, str], bit_vector_2: dict[int, str]
@@ -302,17 +523,29 @@ class BitVectorIterator:
         Returns:
             Merged bit vector
         """
-        bit_vector = dict(bit_vector_1)
+        if self.__dense:
+            return merge_dense_bit_vectors(
+                bit_vector_1, bit_vector_2, self._resolve_bit_conflict
+            )
+        # Mate 1 is freshly built, so mate 2 is folded into it in place
+        bit_vector = bit_vector_1
         for pos, bit in bit_vector_2.items():
-            if pos not in bit_vector:
+            bit1 = bit_vector.get(pos)
+            if bit1 is None:
                 bit_vector[pos] = bit
-            elif bit != bit_vector[pos]:
-                bit_vector[pos] = self._resolve_bit_conflict(bit_vector_1[pos], bit)
+            elif bit != bit1:
+                merged = MATE_CONFLICTS.get((bit1, bit))
+                if merged is None:
+                    merged = self._resolve_bit_conflict(bit1, bit)
+                bit_vector[pos] = merged
         return bit_vector
 
     def _resolve_bit_conflict(self, bit1: str, bit2: str) -> str:
         """Resolve conflict between two different bit values.
 
+        Merges look pairs of known symbols up in MATE_CONFLICTS; this
+        handles the rest, e.g. read bases other than A/C/G/T.
+
         Args:
             bit1: First bit value
             bit2: Second bit value
@@ -0,0 +1,93 @@
+"""Lazily filled lookup table for deletion ambiguity."""
+
+from rna_map.analysis.stage_stats import StageStats
+
+
+class DeletionAmbiguityIndex:
+    """Caches whether a deletion could be placed elsewhere in the reference.
+
+    The answer only depends on the reference, the deletion end position and
+    length, and the number of surrounding bases compared, so each distinct
+    deletion is computed once and later reads cost a single dict lookup.
+
+    Attributes:
+        hits: Lookups answered from the table
+        misses: Lookups that computed a new entry
+    """
+
+    def __init__(self, num_of_surbases: int) -> None:
+        """Initialize DeletionAmbiguityIndex.
+
+        Args:
+            num_of_surbases: Number of surrounding bases for ambiguity check
+        """
+        self.num_of_surbases = num_of_surbases
+        self.__tables: dict[str, dict[tuple[int, int], bool]] = {}
+        self.hits = 0
+        self.misses = 0
+        self.__reported = (0, 0)
+
+    def is_ambiguous(self, ref_seq: str, i: int, length: int) -> bool:
+        """Check if a deletion is ambiguous.
+
+        Args:
+            ref_seq: Reference sequence
+            i: Last deleted position (1-based)
+            length: Deletion length
+
+        Returns:
+            True if shifting the deletion gives the same surrounding sequence
+        """
+        table = self.__tables.get(ref_seq)
+        if table is None:
+            table = self.__tables[ref_seq] = {}
+        key = (i, length)
+        is_ambig = table.get(key)
+        if is_ambig is None:
+            self.misses += 1
+            is_ambig = table[key] = self.calc_ambiguity(ref_seq, i, length)
+        else:
+            self.hits += 1
+        return is_ambig
+
+    def report(self, stats: StageStats) -> None:
+        """Add the lookups since the last report to stage counters.
+
+        An index shared by several samples reports each sample's share.
+
+        Args:
+            stats: Stats that receive ambig_hits and ambig_misses
+        """
+        hits, misses = self.__reported
+        stats.count("ambig_hits", self.hits - hits)
+        stats.count("ambig_misses", self.misses - misses)
+        self.__reported = (self.hits, self.misses)
+
+    def calc_ambiguity(self, ref_seq: str, i: int, length: int) -> bool:
+        """Calculate if a deletion is ambiguous without the cache.
+
+        Args:
+            ref_seq: Reference sequence
+            i: Last deleted position (1-based)
+            length: Deletion length
+
+        Returns:
+            True if shifting the deletion gives the same surrounding sequence
+        """
+        orig_del_start = i - length + 1
+        orig_sur_start = orig_del_start - self.num_of_surbases
+        orig_sur_end = i + self.num_of_surbases
+        orig_sur_seq = (
+            ref_seq[orig_sur_start - 1 : orig_del_start - 1] + ref_seq[i:orig_sur_end]
+        )
+        for new_del_end in range(i - length, i + length + 1):
+            if new_del_end == i:
+                continue
+            new_del_start = new_del_end - length + 1
+            sur_seq = (
+                ref_seq[orig_sur_start - 1 : new_del_start - 1]
+                + ref_seq[new_del_end:orig_sur_end]
+            )
+            if sur_seq == orig_sur_seq:
+                return True
+        return False
@@ -0,0 +1,265 @@
+"""Read filtering and mutation histogram accumulation for bit vectors."""
+
+from bisect import bisect_left, bisect_right
+from typing import Callable
+
+import numpy as np
+
+from rna_map.analysis.bit_vector_cache import DEFAULT_CACHE_SIZE
+from rna_map.analysis.mutation_histogram import COUNT_DTYPE, MutationHistogram
+from rna_map.core import dense_bit_vector as dense
+from rna_map.core.bit_vector import BitVector, BitVectorSymbols
+from rna_map.core.config import StricterConstraints
+from rna_map.core.dense_bit_vector import DenseBitVector
+
+RejectCallback = Callable[[MutationHistogram, BitVector, str], None]
+
+
+class HistogramAccumulator:
+    """Applies read filters and accumulates accepted bit vectors.
+
+    Only the positions a read actually covers are visited, so the cost of
+    recording a bit vector is proportional to the read length rather than
+    the reference length, and no bit vector has to be kept after it is
+    recorded.
+    """
+
+    def __init__(
+        self,
+        mut_histos: dict[str, MutationHistogram],
+        ref_seqs: dict[str, str],
+        map_score_cutoff: int,
+        stricter: StricterConstraints | None = None,
+        on_reject: RejectCallback | None = None,
+        count_duplicates: bool = False,
+        max_pending: int = DEFAULT_CACHE_SIZE,
+    ) -> None:
+        """Initialize HistogramAccumulator.
+
+        Args:
+            mut_histos: Mutation histograms by reference name (updated in place)
+            ref_seqs: Reference sequences by name
+            map_score_cutoff: Minimum mapping quality for each read
+            stricter: Stricter constraints, or None to disable them
+            on_reject: Called with (histogram, bit vector, reason) on rejection
+            count_duplicates: Count accepted bit vectors that share their data
+                object (see BitVectorCache) and record each one once with its
+                multiplicity; histograms are complete only after flush()
+            max_pending: With count_duplicates, number of distinct bit
+                vectors held back before they are recorded
+        """
+        self.mut_histos = mut_histos
+        self.__ref_seqs = ref_seqs
+        self.__map_score_cutoff = map_score_cutoff
+        self.__stricter = stricter
+        self.__on_reject = on_reject
+        # id(data) -> [histogram, data, count]; holding data keeps the id unique
+        self.__pending: dict[int, list] | None = {} if count_duplicates else None
+        self.__max_pending = max_pending
+        self.__bases = ("A", "C", "G", "T")
+        self.__bts = BitVectorSymbols()
+
+    def add(self, bit_vector: BitVector) -> bool:
+        """Filter a bit vector and record it if it passes.
+
+        Args:
+            bit_vector: BitVector to record
+
+        Returns:
+            True if the bit vector was accepted
+        """
+        mh = self.mut_histos[bit_vector.reads[0].rname]
+        reason = self.get_rejection_reason(mh, bit_vector)
+        if reason is not None:
+            if self.__on_reject is not None:
+                self.__on_reject(mh, bit_vector, reason)
+            mh.record_skip(reason)
+            return False
+        if self.__pending is None:
+            self.record(mh, bit_vector.data)
+            return True
+        data = bit_vector.data
+        entry = self.__pending.get(id(data))
+        if entry is not None:
+            entry[2] += 1
+        else:
+            self.__pending[id(data)] = [mh, data, 1]
+            if len(self.__pending) > self.__max_pending:
+                self.flush()
+        return True
+
+    def flush(self) -> None:
+        """Record the bit vectors held back by count_duplicates."""
+        if not self.__pending:
+            return
+        for mh, data, count in self.__pending.values():
+            self.record(mh, data, count)
+        self.__pending.clear()
+
+    def get_rejection_reason(
+        self, mh: MutationHistogram, bit_vector: BitVector
+    ) -> str | None:
+        """Get the reason a bit vector should be rejected.
+
+        Args:
+            mh: MutationHistogram of the read's reference
+            bit_vector: BitVector to check
+
+        Returns:
+            Rejection reason, or None if the bit vector is accepted
+        """
+        for read in bit_vector.reads:
+            if read.mapq < self.__map_score_cutoff:
+                return "low_mapq"
+        if self.__stricter is None:
+            return None
+        if self.__are_reads_too_short(bit_vector):
+            return "short_read"
+        mut_positions = self.__get_mutation_positions(bit_vector.data)
+        num_muts = bisect_right(mut_positions, mh.end) - bisect_left(
+            mut_positions, mh.start
+        )
+        if num_muts > self.__stricter.mutation_count_cutoff:
+            return "too_many_muts"
+        if self.__muts_too_close(mh, mut_positions):
+            return "muts_too_close"
+        return None
+
+    def record(
+        self,
+        mh: MutationHistogram,
+        data: dict[int, str] | DenseBitVector,
+        count: int = 1,
+    ) -> None:
+        """Add an accepted bit vector to a mutation histogram.
+
+        Args:
+            mh: MutationHistogram to update
+            data: Bit vector dictionary or dense bit vector
+            count: Number of reads with this bit vector
+        """
+        if isinstance(data, DenseBitVector):
+            self.__record_dense(mh, data, count)
+            return
+        mh.num_reads += count
+        mh.num_aligned += count
+        # Count rows are looked up once per read, not once per position
+        cov_bases = mh.cov_bases
+        mut_bases = mh.mut_bases
+        del_bases = mh.del_bases
+        info_bases = mh.info_bases
+        mod_bases = mh.mod_bases
+        total_muts = 0
+        for pos, read_bit in data.items():
+            if pos < mh.start or pos > mh.end:
+                continue
+            if read_bit != self.__bts.ambig_info:
+                cov_bases[pos] += count
+            if read_bit in self.__bases:
+                total_muts += 1
+                mod_bases[read_bit][pos] += count
+                mut_bases[pos] += count
+            elif read_bit == self.__bts.del_bit:
+                del_bases[pos] += count
+            info_bases[pos] += count
+        mh.num_of_mutations[total_muts] += count
+
+    def __record_dense(
+        self, mh: MutationHistogram, data: DenseBitVector, count: int = 1
+    ) -> None:
+        """Add an accepted dense bit vector with array operations.
+
+        Args:
+            mh: MutationHistogram to update
+            data: Dense bit vector
+            count: Number of reads with this bit vector
+        """
+        mh.num_reads += count
+        mh.num_aligned += count
+        start = max(mh.start, data.start)
+        end = min(mh.end, data.end)
+        total_muts = 0
+        if start <= end:
+            codes = data.codes[start - data.start : end - data.start + 1]
+            span = slice(start, end + 1)
+
+            def weighted(mask: np.ndarray) -> np.ndarray:
+                if count == 1:
+                    return mask
+                return np.multiply(mask, count, dtype=COUNT_DTYPE)
+
+            covered = codes != dense.NO_DATA
+            mh.info_bases[span] += weighted(covered)
+            mh.cov_bases[span] += weighted(covered & (codes != dense.AMBIG))
+            mh.del_bases[span] += weighted(codes == dense.DEL)
+            muts = dense.is_mutation(codes)
+            mh.mut_bases[span] += weighted(muts)
+            for base, code in dense.BASE_CODES.items():
+                mh.mod_bases[base][span] += weighted(codes == code)
+            total_muts = int(muts.sum())
+        mh.num_of_mutations[total_muts] += count
+
+    def __are_reads_too_short(self, bit_vector: BitVector) -> bool:
+        """Check if any read covers too little of the reference.
+
+        Args:
+            bit_vector: BitVector to check
+
+        Returns:
+            True if a read is shorter than the length cutoff
+        """
+        ref_len = len(self.__ref_seqs[bit_vector.reads[0].rname])
+        cutoff = self.__stricter.percent_length_cutoff
+        return any(len(read.seq) / ref_len < cutoff for read in bit_vector.reads)
+
+    def __get_mutation_positions(
+        self, data: dict[int, str] | DenseBitVector
+    ) -> list[int] | np.ndarray:
+        """Get all sorted mutation positions of a bit vector.
+
+        Args:
+            data: Bit vector dictionary or dense bit vector
+
+        Returns:
+            Sorted mutated positions (an array for dense bit vectors)
+        """
+        if isinstance(data, DenseBitVector):
+            return data.mutation_positions(data.start, data.end)
+        return sorted(
+            pos for pos, read_bit in data.items() if read_bit in self.__bases
+        )
+
+    def __muts_too_close(
+        self, mh: MutationHistogram, mut_positions: list[int] | np.ndarray
+    ) -> bool:
+        """Check if any mutation has another mutation within the distance cutoff.
+
+        A mutation inside the histogram coordinates is too close when another
+        mutation lies at most min_mut_distance before it or less than
+        min_mut_distance after it. The nearest mutation on each side is its
+        neighbour in the sorted positions, so one pass over the gaps between
+        neighbours is enough.
+
+        Args:
+            mh: MutationHistogram of the read's reference
+            mut_positions: All sorted mutation positions of the bit vector
+
+        Returns:
+            True if mutations are too close
+        """
+        cutoff = self.__stricter.min_mut_distance
+        if isinstance(mut_positions, np.ndarray):
+            gaps = np.diff(mut_positions)
+            inside = (mut_positions >= mh.start) & (mut_positions <= mh.end)
+            too_close = ((gaps <= cutoff) & inside[1:]) | (
+                (gaps < cutoff) & inside[:-1]
+            )
+            return bool(too_close.any())
+        start, end = mh.start, mh.end
+        for prev, pos in zip(mut_positions, mut_positions[1:]):
+            gap = pos - prev
+            if gap <= cutoff and start <= pos <= end:
+                return True
+            if gap < cutoff and start <= prev <= end:
+                return True
+        return False
@@ -7,6 +7,84 @@ from rna_map.logger import get_logger
 
 log = get_logger("MUT_HISTOGRAM")
 
+# Per-position counters are integers; uint32 holds 4e9 reads per position
+COUNT_DTYPE = np.uint32
+
+# Rows of a histogram's count block
+COUNT_FIELDS = ("mut_bases", "info_bases", "del_bases", "ins_bases", "cov_bases")
+MOD_BASES = ("A", "C", "G", "T")
+NUM_COUNT_ROWS = len(COUNT_FIELDS) + len(MOD_BASES)
+_MOD_ROW = {base: len(COUNT_FIELDS) + i for i, base in enumerate(MOD_BASES)}
+
+# Columns per HistogramStore block (9 uint32 rows, about 2.4 MB)
+DEFAULT_BLOCK_COLUMNS = 1 << 16
+
+
+class HistogramStore:
+    """Struct-of-arrays count storage shared by many mutation histograms.
+
+    The counts of all histograms of a reference panel live in a few large
+    (NUM_COUNT_ROWS, columns) blocks instead of nine small arrays each. A
+    histogram only takes its columns the first time it is written to, so
+    references without reads cost no count memory at all, and the columns
+    of references that are hit are packed next to each other.
+    """
+
+    def __init__(self, block_columns: int = DEFAULT_BLOCK_COLUMNS) -> None:
+        """Initialize HistogramStore.
+
+        Args:
+            block_columns: Number of columns allocated per block
+        """
+        self.block_columns = block_columns
+        self.blocks: list[np.ndarray] = []
+        self.__used = 0
+
+    def allocate(self, length: int) -> np.ndarray:
+        """Reserve zeroed count columns for one histogram.
+
+        Args:
+            length: Number of columns (sequence length + 1)
+
+        Returns:
+            (NUM_COUNT_ROWS, length) view into a store block
+        """
+        if not self.blocks or self.__used + length > self.blocks[-1].shape[1]:
+            columns = max(self.block_columns, length)
+            self.blocks.append(np.zeros((NUM_COUNT_ROWS, columns), dtype=COUNT_DTYPE))
+            self.__used = 0
+        counts = self.blocks[-1][:, self.__used : self.__used + length]
+        self.__used += length
+        return counts
+
+    @property
+    def nbytes(self) -> int:
+        """Number of bytes held by the store blocks."""
+        return sum(block.nbytes for block in self.blocks)
+
+
+class _BaseCounts(dict):
+    """Per-base count rows of a histogram.
+
+    Lookups are plain dict lookups; assigning to a base copies the values
+    into its row of the count block, so the rows never leave the block.
+    """
+
+    def __setitem__(self, base: str, values) -> None:
+        self[base][:] = values
+
+
+def _count_row(field: str) -> property:
+    index = COUNT_FIELDS.index(field)
+
+    def fget(self: "MutationHistogram") -> np.ndarray:
+        return self.counts[index]
+
+    def fset(self: "MutationHistogram", values) -> None:
+        self.counts[index] = values
+
+    return property(fget, fset, doc=f"Row {index} of the count block")
+
 
 class MutationHistogram:
     """Tracks and analyzes mutation patterns across reads.
@@ -28,8 +106,18 @@ class MutationHistogram:
         mod_bases: Dictionary (A/C/G/T) of arrays counting specific mutations
         start: Start position (1-based)
         end: End position (1-based)
+
+    The count arrays are uint32 rows of one count block, allocated on first
+    access (from a shared HistogramStore if one is given), so histograms of
+    references that never get a read stay small.
     """
 
+    mut_bases = _count_row("mut_bases")
+    info_bases = _count_row("info_bases")
+    del_bases = _count_row("del_bases")
+    ins_bases = _count_row("ins_bases")
+    cov_bases = _count_row("cov_bases")
+
     def __init__(
         self,
         name: str,
@@ -37,6 +125,7 @@ class MutationHistogram:
         data_type: str,
         start: int | None = None,
         end: int | None = None,
+        store: HistogramStore | None = None,
     ) -> None:
         """Initialize a MutationHistogram.
 
@@ -46,6 +135,7 @@ class MutationHistogram:
             data_type: Type of data (e.g., "DMS")
             start: Start position (1-based), defaults to 1
             end: End position (1-based), defaults to len(sequence)
+            store: Shared count storage, or None for a private count block
         """
         self.name = name
         self.sequence = sequence
@@ -59,18 +149,10 @@ class MutationHistogram:
             "too_many_muts": 0,
             "muts_too_close": 0,
         }
-        self.num_of_mutations = [0] * (len(sequence) + 1)
-        self.mut_bases = np.zeros(len(sequence) + 1)
-        self.info_bases = np.zeros(len(sequence) + 1)
-        self.del_bases = np.zeros(len(sequence) + 1)
-        self.ins_bases = np.zeros(len(sequence) + 1)
-        self.cov_bases = np.zeros(len(sequence) + 1)
-        self.mod_bases = {
-            "A": np.zeros(len(sequence) + 1),
-            "C": np.zeros(len(sequence) + 1),
-            "G": np.zeros(len(sequence) + 1),
-            "T": np.zeros(len(sequence) + 1),
-        }
+        self._store = store
+        self._counts: np.ndarray | None = None
+        self._mod_bases: _BaseCounts | None = None
+        self._num_of_mutations: list[int] | None = None
         self.start = start
         self.end = end
         if self.start is None:
@@ -78,15 +160,101 @@ class MutationHistogram:
         if self.end is None:
             self.end = len(self.sequence)
 
+    @property
+    def allocated(self) -> bool:
+        """Whether the count block has been allocated."""
+        return self._counts is not None
+
+    @property
+    def counts(self) -> np.ndarray:
+        """Count block, rows in COUNT_FIELDS then MOD_BASES order."""
+        if self._counts is None:
+            self._set_counts(self.__allocate())
+        return self._counts
+
+    def __allocate(self) -> np.ndarray:
+        length = len(self.sequence) + 1
+        if self._store is not None:
+            return self._store.allocate(length)
+        return np.zeros((NUM_COUNT_ROWS, length), dtype=COUNT_DTYPE)
+
+    def _set_counts(self, counts: np.ndarray) -> None:
+        self._counts = counts
+        self._mod_bases = _BaseCounts(
+            (base, counts[row]) for base, row in _MOD_ROW.items()
+        )
+
+    @property
+    def mod_bases(self) -> dict[str, np.ndarray]:
+        """Dictionary (A/C/G/T) of count rows for specific mutations."""
+        if self._mod_bases is None:
+            self._set_counts(self.__allocate())
+        return self._mod_bases
+
+    @mod_bases.setter
+    def mod_bases(self, mod_bases: dict) -> None:
+        for base, values in mod_bases.items():
+            self.mod_bases[base] = values
+
+    @property
+    def num_of_mutations(self) -> list[int]:
+        """Number of reads by mutation count."""
+        if self._num_of_mutations is None:
+            self._num_of_mutations = [0] * (len(self.sequence) + 1)
+        return self._num_of_mutations
+
+    @num_of_mutations.setter
+    def num_of_mutations(self, num_of_mutations: list[int]) -> None:
+        self._num_of_mutations = num_of_mutations
+
+    def __getstate__(self) -> dict:
+        state = self.__dict__.copy()
+        # Unpickled histograms own a compact copy of their counts
+        state["_store"] = None
+        state["_mod_bases"] = None
+        if self._counts is not None:
+            state["_counts"] = np.ascontiguousarray(self._counts)
+        return state
+
+    def __setstate__(self, state: dict) -> None:
+        if "mut_bases" in state:
+            self.__set_legacy_state(state)
+            return
+        self.__dict__.update(state)
+        if self._counts is not None:
+            self._set_counts(self._counts)
+
+    def __set_legacy_state(self, state: dict) -> None:
+        """Load a pickle written before counts moved into a count block."""
+        state = dict(state)
+        rows = {field: state.pop(field) for field in COUNT_FIELDS}
+        mod_bases = state.pop("mod_bases")
+        num_of_mutations = state.pop("num_of_mutations")
+        self.__dict__.update(state)
+        self._store = None
+        self._counts = None
+        self._mod_bases = None
+        self._num_of_mutations = list(num_of_mutations)
+        for field, values in rows.items():
+            setattr(self, field, values)
+        self.mod_bases = mod_bases
+
     @classmethod
     def from_dict(cls, d: dict) -> "MutationHistogram":
         """Create MutationHistogram from dictionary.
 
+        Instead of the per-field count lists of get_dict, d may hold the whole
+        count block under "counts". A uint32 block of the right shape is used
+        as is, without copying, e.g. a view of a memory-mapped file.
+
         Args:
             d: Dictionary with histogram data
 
         Returns:
             MutationHistogram instance
+
+        Raises:
+            ValueError: If the count block has the wrong shape
         """
         mh = cls(d["name"], d["sequence"], d["data_type"])
         mh.structure = d["structure"]
@@ -96,6 +264,15 @@ class MutationHistogram:
         mh.num_aligned = d["num_aligned"]
         mh.skips = d["skips"]
         mh.num_of_mutations = d["num_of_mutations"]
+        if "counts" in d:
+            counts = np.asarray(d["counts"], dtype=COUNT_DTYPE)
+            if counts.shape != (NUM_COUNT_ROWS, len(mh.sequence) + 1):
+                raise ValueError(
+                    f"{mh.name}: count block of shape {counts.shape} does not"
+                    " match the sequence"
+                )
+            mh._set_counts(counts)
+            return mh
         mh.mut_bases = np.array(d["mut_bases"])
         mh.info_bases = np.array(d["info_bases"])
         mh.del_bases = np.array(d["del_bases"])
@@ -162,14 +339,13 @@ class MutationHistogram:
         self.num_aligned += other.num_aligned
         for key in self.skips:
             self.skips[key] += other.skips[key]
-        for ii in range(len(other.num_of_mutations)):
-            self.num_of_mutations[ii] += other.num_of_mutations[ii]
-        self.mut_bases += other.mut_bases
-        self.ins_bases += other.ins_bases
-        self.cov_bases += other.cov_bases
-        self.info_bases += other.info_bases
-        for key in self.mod_bases:
-            self.mod_bases[key] += other.mod_bases[key]
+        if other._num_of_mutations is not None:
+            num_of_mutations = self.num_of_mutations
+            for ii in range(len(other.num_of_mutations)):
+                num_of_mutations[ii] += other.num_of_mutations[ii]
+        if other.allocated:
+            counts = self.counts
+            counts += other.counts
 
     def record_skip(self, t: str) -> None:
         """Record a skipped read.
@@ -186,14 +362,19 @@ class MutationHistogram:
         Returns:
             List of coverage fractions per position
         """
-        read_cov = []
-        for pos in self.get_nuc_coords():
-            try:
-                cov_frac = self.cov_bases[pos] / self.num_reads
-            except ZeroDivisionError:
-                cov_frac = 0.0
-            read_cov.append(cov_frac)
-        return read_cov
+        start, end = self.get_nuc_range()
+        with np.errstate(divide="ignore", invalid="ignore"):
+            return (self.cov_bases[start : end + 1] / self.num_reads).tolist()
+
+    def get_nuc_range(self) -> tuple[int, int]:
+        """Get the first and last nucleotide coordinates.
+
+        Returns:
+            Start and end positions (1-based, inclusive)
+        """
+        start = self.start if self.start is not None else 1
+        end = self.end if self.end is not None else len(self.sequence)
+        return start, end
 
     def get_nuc_coords(self) -> list[int]:
         """Get nucleotide coordinates.
@@ -201,8 +382,7 @@ class MutationHistogram:
         Returns:
             List of positions from start to end
         """
-        start = self.start if self.start is not None else 1
-        end = self.end if self.end is not None else len(self.sequence)
+        start, end = self.get_nuc_range()
         return list(range(start, end + 1))
 
     def get_pop_avg(self, inc_del: bool = False) -> list[float]:
@@ -214,19 +394,13 @@ class MutationHistogram:
         Returns:
             List of mutation fractions per position
         """
-        pop_avg = []
-        for pos in self.get_nuc_coords():
-            try:
-                if inc_del:
-                    mut_frac = (
-                        self.del_bases[pos] + self.mut_bases[pos]
-                    ) / self.info_bases[pos]
-                else:
-                    mut_frac = self.mut_bases[pos] / self.info_bases[pos]
-            except Exception:
-                mut_frac = 0.0
-            pop_avg.append(round(mut_frac, 5))
-        return pop_avg
+        start, end = self.get_nuc_range()
+        coords = slice(start, end + 1)
+        muts = self.mut_bases[coords]
+        if inc_del:
+            muts = self.del_bases[coords] + muts
+        with np.errstate(divide="ignore", invalid="ignore"):
+            return np.round(muts / self.info_bases[coords], 5).tolist()
 
     def get_pop_avg_dataframe(self) -> pd.DataFrame:
         """Get population average as DataFrame.
@@ -267,20 +441,18 @@ class MutationHistogram:
         """Calculate signal-to-noise ratio (AC/GU ratio).
 
         Returns:
-            Signal-to-noise ratio as float
+            Signal-to-noise ratio as float, 0.0 if the sequence has no A/C
+            or no G/U or there are no G/U mutations
         """
         seq = self.sequence
-        AC: float = 0.0
-        GU: float = 0.0
         AC_count = seq.count("A") + seq.count("C")
         GU_count = seq.count("G") + seq.count("U") + seq.count("T")
-        for pos in self.get_nuc_coords():
-            if seq[pos - 1] == "A" or seq[pos - 1] == "C":
-                AC += float(self.mut_bases[pos])
-            else:
-                GU += float(self.mut_bases[pos])
-        AC /= float(AC_count)
-        GU /= float(GU_count)
-        if GU == 0:
+        start, end = self.get_nuc_range()
+        bases = np.frombuffer(seq[start - 1 : end].encode(), dtype=np.uint8)
+        muts = self.mut_bases[start : end + 1]
+        is_ac = (bases == ord("A")) | (bases == ord("C"))
+        AC = float(muts[is_ac].sum())
+        GU = float(muts.sum()) - AC
+        if AC_count == 0 or GU_count == 0 or GU == 0:
             return 0.0
-        return round(float(AC / GU), 2)
+        return round(float((AC / AC_count) / (GU / GU_count)), 2)
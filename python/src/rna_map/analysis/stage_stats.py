@@ -0,0 +1,143 @@
+"""Per-stage timers and counters for bit vector generation.
+
+Hot loops call ``time.perf_counter`` directly and hand the elapsed time to
+``add``; the ``timed`` context manager is meant for coarse stages such as
+plotting. Stats of worker processes are combined with ``merge``.
+"""
+
+from collections import defaultdict
+from contextlib import contextmanager
+import json
+import os
+from pathlib import Path
+import time
+
+STAGES = (
+    "parse",
+    "kernel",
+    "filter",
+    "rejected_log",
+    "storage",
+    "checkpoint",
+    "plots",
+    "summary",
+)
+STATS_FILE_NAME = "bit_vector_stats.json"
+
+
+class StageStats:
+    """Accumulated wall-clock time per stage plus event counters.
+
+    Attributes:
+        engine: Name of the bit vector engine ("python", "parallel", "cpp")
+        seconds: Seconds spent per stage (summed over workers when parallel)
+        counters: Event counts such as reads and bytes read
+    """
+
+    def __init__(self, engine: str = "python") -> None:
+        """Initialize StageStats.
+
+        Args:
+            engine: Name of the bit vector engine
+        """
+        self.engine = engine
+        self.seconds: dict[str, float] = defaultdict(float)
+        self.counters: dict[str, int] = defaultdict(int)
+        self.__start = time.perf_counter()
+
+    def add(self, stage: str, seconds: float) -> None:
+        """Add time to a stage.
+
+        Args:
+            stage: Stage name (see STAGES)
+            seconds: Elapsed seconds
+        """
+        self.seconds[stage] += seconds
+
+    def count(self, name: str, n: int = 1) -> None:
+        """Increment a counter.
+
+        Args:
+            name: Counter name
+            n: Amount to add
+        """
+        self.counters[name] += n
+
+    def count_input_bytes(self, path: Path | str) -> None:
+        """Count the size of an input file as bytes_read.
+
+        Streams such as /dev/stdin have no size up front, so bytes_read is
+        left out for them rather than reported as 0.
+
+        Args:
+            path: Input path
+        """
+        if os.path.isfile(path):
+            self.counters["bytes_read"] += os.path.getsize(path)
+
+    @contextmanager
+    def timed(self, stage: str):
+        """Time the enclosed block as a stage.
+
+        Args:
+            stage: Stage name (see STAGES)
+        """
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.seconds[stage] += time.perf_counter() - start
+
+    def merge(self, other: "StageStats") -> None:
+        """Add the times and counters of another StageStats.
+
+        Args:
+            other: Stats to merge (e.g. from a worker batch)
+        """
+        for stage, seconds in other.seconds.items():
+            self.seconds[stage] += seconds
+        for name, n in other.counters.items():
+            self.counters[name] += n
+
+    def to_dict(self, rejects: dict[str, int] | None = None) -> dict:
+        """Convert to the bit_vector_stats.json layout.
+
+        Args:
+            rejects: Rejected reads per reason
+
+        Returns:
+            JSON-serializable dictionary
+        """
+        wall_seconds = time.perf_counter() - self.__start
+        reads = self.counters.get("reads", 0)
+        dedup_lookups = self.counters.get("dedup_hits", 0) + self.counters.get(
+            "dedup_misses", 0
+        )
+        generation_seconds = wall_seconds - sum(
+            self.seconds.get(stage, 0.0) for stage in ("plots", "summary")
+        )
+        out = {
+            "engine": self.engine,
+            "reads": reads,
+            "accepted": self.counters.get("accepted", 0),
+            # None when the input was a stream of unknown size
+            "bytes_read": self.counters.get("bytes_read"),
+            "wall_seconds": wall_seconds,
+            "reads_per_sec": reads / generation_seconds if generation_seconds > 0 else 0.0,
+            "stage_seconds": {stage: self.seconds.get(stage, 0.0) for stage in STAGES},
+            "counters": dict(self.counters),
+            "rejects": dict(rejects or {}),
+        }
+        if dedup_lookups:
+            out["dedup_hit_rate"] = self.counters["dedup_hits"] / dedup_lookups
+        return out
+
+    def write_json(self, path: Path | str, rejects: dict[str, int] | None = None) -> None:
+        """Write stats as JSON.
+
+        Args:
+            path: Output path
+            rejects: Rejected reads per reason
+        """
+        with open(path, "w") as f:
+            json.dump(self.to_dict(rejects), f, indent=2)
@@ -1,10 +1,212 @@
-"""Statistical analysis functions for mutation histograms."""
+"""Statistical analysis functions for mutation histograms.
 
-from typing import Any
+Statistics of whole reference panels are computed by HistogramStats, which
+gathers the count rows of all histograms into flat arrays and derives each
+column with a few numpy operations over every reference, instead of a
+Python loop over the positions of each histogram.
+"""
 
+import csv
+import itertools
+from pathlib import Path
+from typing import Any, Iterable, Sequence
+
+import numpy as np
 import pandas as pd
 
-from .mutation_histogram import MutationHistogram
+from .mutation_histogram import COUNT_DTYPE, COUNT_FIELDS, MutationHistogram
+
+# Columns of summary.csv
+SUMMARY_COLUMNS = (
+    "name",
+    "reads",
+    "aligned",
+    "no_mut",
+    "1_mut",
+    "2_mut",
+    "3_mut",
+    "3plus_mut",
+    "sn",
+)
+# Histograms per block of write_summary_csv; bounds the gathered arrays
+SUMMARY_BLOCK_SIZE = 4096
+# Index of each mutation count column in get_percent_mutations
+_MUTATION_COLUMNS = {"no_mut": 0, "1_mut": 1, "2_mut": 2, "3_mut": 3, "3plus_mut": 4}
+
+
+class HistogramStats:
+    """Statistics of many mutation histograms, computed for all at once.
+
+    Results match the per-histogram MutationHistogram methods. References
+    that never got a read are read as zero counts without allocating their
+    count blocks.
+    """
+
+    def __init__(self, mut_histos: Sequence[MutationHistogram]) -> None:
+        """Initialize HistogramStats.
+
+        Args:
+            mut_histos: Mutation histograms, one row per histogram
+        """
+        self.mut_histos = list(mut_histos)
+        self.__coords = [mh.get_nuc_range() for mh in self.mut_histos]
+        self.__lengths = np.array(
+            [max(0, end - start + 1) for start, end in self.__coords], dtype=np.int64
+        )
+        self.__rows: dict[str, np.ndarray] = {}
+
+    def __len__(self) -> int:
+        return len(self.mut_histos)
+
+    def __row(self, field: str) -> np.ndarray:
+        """Count row of field over the nucleotide coordinates of every histogram."""
+        if field not in self.__rows:
+            index = COUNT_FIELDS.index(field)
+            parts = [
+                mh.counts[index, start : end + 1]
+                if mh.allocated
+                else np.zeros(length, dtype=COUNT_DTYPE)
+                for mh, (start, end), length in zip(
+                    self.mut_histos, self.__coords, self.__lengths.tolist()
+                )
+            ]
+            self.__rows[field] = (
+                np.concatenate(parts) if parts else np.zeros(0, dtype=COUNT_DTYPE)
+            )
+        return self.__rows[field]
+
+    def __per_position(self, values: np.ndarray) -> np.ndarray:
+        """Repeat one value per histogram over its positions."""
+        return np.repeat(values, self.__lengths)
+
+    def __split(self, values: np.ndarray) -> list[list[float]]:
+        """Split a flat per-position array into one list per histogram."""
+        offsets = np.cumsum(self.__lengths)[:-1]
+        return [part.tolist() for part in np.split(values, offsets)]
+
+    def __per_histogram_sum(self, values: np.ndarray) -> np.ndarray:
+        index = self.__per_position(np.arange(len(self)))
+        return np.bincount(index, weights=values, minlength=len(self))
+
+    def num_reads(self) -> list[int]:
+        """Number of reads of each histogram."""
+        return [mh.num_reads for mh in self.mut_histos]
+
+    def num_aligned(self) -> list[int]:
+        """Number of aligned reads of each histogram."""
+        return [mh.num_aligned for mh in self.mut_histos]
+
+    def aligned_percentage(self) -> list[float]:
+        """Percentage of reads aligned, 0.0 for histograms without reads."""
+        reads = np.array(self.num_reads(), dtype=np.int64)
+        aligned = np.array(self.num_aligned(), dtype=np.int64)
+        with np.errstate(divide="ignore", invalid="ignore"):
+            percentages = (aligned / reads * 100).tolist()
+        return [
+            round(pct, 2) if n else 0.0 for pct, n in zip(percentages, reads.tolist())
+        ]
+
+    def percent_mutations(self) -> np.ndarray:
+        """Percentage of reads with 0, 1, 2, 3 and more mutations.
+
+        Returns:
+            (histograms, 5) array, rows of zeros for histograms without
+            aligned reads
+        """
+        counts = np.zeros((len(self), 5), dtype=np.int64)
+        aligned = np.array(self.num_aligned(), dtype=np.int64)
+        for i, mh in enumerate(self.mut_histos):
+            if not mh.num_aligned:
+                continue
+            num_of_mutations = mh.num_of_mutations
+            head = num_of_mutations[0:4]
+            counts[i, : len(head)] = head
+            counts[i, 4] = sum(num_of_mutations[5:])
+        with np.errstate(divide="ignore", invalid="ignore"):
+            percentages = np.round((counts / aligned[:, None]) * 100, 2)
+        percentages[aligned == 0] = 0.0
+        return percentages
+
+    def signal_to_noise(self) -> list[float]:
+        """AC/GU mutation ratio of each histogram (see get_signal_to_noise)."""
+        bases = np.frombuffer(
+            "".join(
+                mh.sequence[start - 1 : end]
+                for mh, (start, end) in zip(self.mut_histos, self.__coords)
+            ).encode(),
+            dtype=np.uint8,
+        )
+        is_ac = (bases == ord("A")) | (bases == ord("C"))
+        muts = self.__row("mut_bases")
+        ac = self.__per_histogram_sum(muts * is_ac)
+        gu = self.__per_histogram_sum(muts) - ac
+        ac_count = np.array(
+            [mh.sequence.count("A") + mh.sequence.count("C") for mh in self.mut_histos],
+            dtype=np.float64,
+        )
+        gu_count = np.array(
+            [
+                mh.sequence.count("G") + mh.sequence.count("U") + mh.sequence.count("T")
+                for mh in self.mut_histos
+            ],
+            dtype=np.float64,
+        )
+        with np.errstate(divide="ignore", invalid="ignore"):
+            ratios = ((ac / ac_count) / (gu / gu_count)).tolist()
+            valid = ((ac_count > 0) & (gu_count > 0) & (gu > 0)).tolist()
+        return [round(r, 2) if ok else 0.0 for r, ok in zip(ratios, valid)]
+
+    def read_coverage(self) -> list[list[float]]:
+        """Coverage fractions per position of each histogram."""
+        reads = np.array(self.num_reads(), dtype=np.int64)
+        with np.errstate(divide="ignore", invalid="ignore"):
+            coverage = self.__row("cov_bases") / self.__per_position(reads)
+        return self.__split(coverage)
+
+    def pop_avg(self, inc_del: bool = False) -> list[list[float]]:
+        """Population average mutation rates per position of each histogram.
+
+        Args:
+            inc_del: If True, include deletions in the average
+        """
+        muts = self.__row("mut_bases")
+        if inc_del:
+            muts = self.__row("del_bases") + muts
+        with np.errstate(divide="ignore", invalid="ignore"):
+            pop_avg = np.round(muts / self.__row("info_bases"), 5)
+        return self.__split(pop_avg)
+
+    def column(self, column: str) -> list:
+        """Get the values of a column for every histogram.
+
+        Args:
+            column: Column name (see get_dataframe)
+
+        Returns:
+            One value per histogram
+
+        Raises:
+            ValueError: If invalid column name
+        """
+        if column in ("num_reads", "reads"):
+            return self.num_reads()
+        if column == "num_aligned":
+            return self.num_aligned()
+        if column == "aligned":
+            return self.aligned_percentage()
+        if column in _MUTATION_COLUMNS:
+            return self.percent_mutations()[:, _MUTATION_COLUMNS[column]].tolist()
+        if column == "percent_mutations":
+            return self.percent_mutations().tolist()
+        if column in ("signal_to_noise", "sn"):
+            return self.signal_to_noise()
+        if column == "read_coverage":
+            return self.read_coverage()
+        if column == "pop_avg":
+            return self.pop_avg()
+        if column == "pop_avg_del":
+            return self.pop_avg(inc_del=True)
+        return [_get_column_value(mh, column) for mh in self.mut_histos]
 
 
 def get_dataframe(
@@ -22,11 +224,48 @@ def get_dataframe(
     Raises:
         ValueError: If invalid column name provided
     """
-    data = []
-    for _, mut_histo in mut_histos.items():
-        data_row = [_get_column_value(mut_histo, dc) for dc in data_cols]
-        data.append(data_row)
-    return pd.DataFrame(data, columns=data_cols)
+    stats = HistogramStats(list(mut_histos.values()))
+    columns = [stats.column(dc) for dc in data_cols]
+    return pd.DataFrame(list(zip(*columns)), columns=data_cols)
+
+
+def write_summary_csv(
+    mut_histos: Iterable[MutationHistogram],
+    path: Path | str,
+    columns: Sequence[str] = SUMMARY_COLUMNS,
+    head_rows: int = 0,
+    block_size: int = SUMMARY_BLOCK_SIZE,
+) -> list[list]:
+    """Write a summary CSV of mutation histograms a block at a time.
+
+    The statistics of each block of histograms are computed together and
+    written before the next block is read, so memory does not grow with the
+    number of references. The file matches get_dataframe(...).to_csv.
+
+    Args:
+        mut_histos: Mutation histograms, one row each
+        path: Output CSV path
+        columns: Column names (see get_dataframe)
+        head_rows: Number of leading rows to return, e.g. for logging
+        block_size: Histograms per block
+
+    Returns:
+        The first head_rows rows
+
+    Raises:
+        ValueError: If invalid column name provided
+    """
+    head: list[list] = []
+    histos = iter(mut_histos)
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f, lineterminator="\n")
+        writer.writerow(columns)
+        while block := list(itertools.islice(histos, block_size)):
+            stats = HistogramStats(block)
+            rows = [list(row) for row in zip(*(stats.column(c) for c in columns))]
+            writer.writerows(rows)
+            head.extend(rows[: max(0, head_rows - len(head))])
+    return head
 
 
 def _get_column_value(mut_histo: MutationHistogram, column: str) -> Any:
@@ -108,15 +347,7 @@ def _get_mutation_percentage(mut_histo: MutationHistogram, column: str) -> float
     Returns:
         Mutation percentage
     """
-    percentages = mut_histo.get_percent_mutations()
-    index_map = {
-        "no_mut": 0,
-        "1_mut": 1,
-        "2_mut": 2,
-        "3_mut": 3,
-        "3plus_mut": 4,
-    }
-    return percentages[index_map[column]]
+    return mut_histo.get_percent_mutations()[_MUTATION_COLUMNS[column]]
 
 
 def merge_mut_histo_dicts(
@@ -0,0 +1,30 @@
+"""Benchmarks for the bit vector engines.
+
+Run with ``python -m rna_map.benchmark --help``.
+"""
+
+from rna_map.benchmark.runner import (
+    ENGINES,
+    EngineResult,
+    build_report,
+    compare_reports,
+    run_benchmarks,
+    run_engine,
+)
+from rna_map.benchmark.synthetic_sam import (
+    SyntheticDataSet,
+    SyntheticSamSpec,
+    write_synthetic_dataset,
+)
+
+__all__ = [
+    "ENGINES",
+    "EngineResult",
+    "SyntheticDataSet",
+    "SyntheticSamSpec",
+    "build_report",
+    "compare_reports",
+    "run_benchmarks",
+    "run_engine",
+    "write_synthetic_dataset",
+]
@@ -0,0 +1,86 @@
+"""Command line entry point: python -m rna_map.benchmark."""
+
+import argparse
+import json
+from pathlib import Path
+import tempfile
+
+from rna_map.benchmark.runner import (
+    ENGINES,
+    build_report,
+    compare_reports,
+    run_benchmarks,
+    write_report,
+)
+from rna_map.benchmark.synthetic_sam import SyntheticSamSpec, write_synthetic_dataset
+
+
+def parse_args(argv: list[str] | None = None) -> argparse.Namespace:
+    """Parse command line arguments."""
+    defaults = SyntheticSamSpec()
+    parser = argparse.ArgumentParser(
+        description="Benchmark the bit vector engines on synthetic reads"
+    )
+    parser.add_argument("--num-reads", type=int, default=defaults.num_reads)
+    parser.add_argument("--read-length", type=int, default=defaults.read_length)
+    parser.add_argument("--num-references", type=int, default=defaults.num_references)
+    parser.add_argument(
+        "--reference-length", type=int, default=defaults.reference_length
+    )
+    parser.add_argument("--mutation-rate", type=float, default=defaults.mutation_rate)
+    parser.add_argument("--indel-rate", type=float, default=defaults.indel_rate)
+    parser.add_argument("--paired", action="store_true")
+    parser.add_argument("--seed", type=int, default=defaults.seed)
+    parser.add_argument(
+        "--engines", nargs="+", choices=ENGINES, default=list(ENGINES)
+    )
+    parser.add_argument(
+        "--output", type=Path, default=Path("bit_vector_benchmark.json"),
+        help="Path of the JSON report",
+    )
+    parser.add_argument(
+        "--compare", type=Path, default=None,
+        help="Earlier JSON report to compare against",
+    )
+    return parser.parse_args(argv)
+
+
+def main(argv: list[str] | None = None) -> None:
+    """Generate a synthetic data set, benchmark the engines, write a report."""
+    args = parse_args(argv)
+    spec = SyntheticSamSpec(
+        num_reads=args.num_reads,
+        read_length=args.read_length,
+        num_references=args.num_references,
+        reference_length=args.reference_length,
+        mutation_rate=args.mutation_rate,
+        indel_rate=args.indel_rate,
+        paired=args.paired,
+        seed=args.seed,
+    )
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        dataset = write_synthetic_dataset(spec, Path(tmp_dir))
+        results = run_benchmarks(
+            dataset.sam, dataset.fasta, spec.paired, dataset.num_bases,
+            tuple(args.engines),
+        )
+    report = build_report(spec.to_dict(), results)
+    write_report(report, args.output)
+    print(f"{'engine':<14}{'reads/s':>12}{'ns/base':>10}{'peak MB':>10}")
+    for r in results:
+        if r.status != "ok":
+            print(f"{r.engine:<14}{'skipped: ' + r.message}")
+            continue
+        print(
+            f"{r.engine:<14}{r.reads_per_sec:>12.0f}{r.ns_per_base:>10.1f}"
+            f"{r.peak_rss_mb:>10.1f}"
+        )
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+        for engine, speedup in compare_reports(baseline, report).items():
+            print(f"{engine}: {speedup:.2f}x vs {args.compare}")
+
+
+if __name__ == "__main__":
+    main()
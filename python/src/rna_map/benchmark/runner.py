@@ -0,0 +1,238 @@
+"""Throughput benchmarks for the bit vector engines.
+
+Each engine runs in a fresh process so its peak RSS is not inflated by the
+engines measured before it. Results are collected in a JSON report that
+records the data set, the host and every engine, so runs of different
+releases can be compared with compare_reports.
+"""
+
+from dataclasses import asdict, dataclass
+from datetime import datetime, timezone
+import json
+import multiprocessing
+import os
+from pathlib import Path
+import platform
+import resource
+import sys
+import time
+
+from rna_map.logger import get_logger
+
+log = get_logger("BENCHMARK.RUNNER")
+
+REPORT_VERSION = 1
+ENGINES = ("python", "python_dense", "pysam", "cpp")
+
+
+@dataclass
+class EngineResult:
+    """Benchmark result of one engine.
+
+    Attributes:
+        engine: Engine name (see ENGINES)
+        status: "ok", or "skipped" when the engine is not available
+        num_reads: Number of bit vectors generated
+        num_bases: Number of read bases processed
+        seconds: Wall-clock time spent generating bit vectors
+        reads_per_sec: Bit vectors generated per second
+        ns_per_base: Nanoseconds per read base
+        peak_rss_mb: Peak resident set size of the engine process
+        message: Reason the engine was skipped
+    """
+
+    engine: str
+    status: str = "ok"
+    num_reads: int = 0
+    num_bases: int = 0
+    seconds: float = 0.0
+    reads_per_sec: float = 0.0
+    ns_per_base: float = 0.0
+    peak_rss_mb: float = 0.0
+    message: str = ""
+
+
+def _peak_rss_mb() -> float:
+    """Get the peak RSS of this process in MB."""
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # ru_maxrss is in bytes on macOS and in kilobytes elsewhere
+    return peak / 2**20 if sys.platform == "darwin" else peak / 2**10
+
+
+def _iter_cpp_bit_vectors(sam_path: Path, ref_seqs: dict[str, str], paired: bool):
+    """Generate bit vector data with the C++ extension."""
+    from rna_map import settings
+    from rna_map.io.fastq import parse_phred_qscore_file
+    from rna_map.io.sam_reader import iter_sam_fields
+    from rna_map.pipeline import _cpp_bit_vectors as cpp
+
+    generator = cpp.bit_vector_cpp.BitVectorGenerator(
+        qscore_cutoff=25, num_of_surbases=10
+    )
+    phred_qscores = parse_phred_qscore_file(
+        settings.get_py_path() / "resources" / "phred_ascii.txt"
+    )
+    for record in iter_sam_fields(sam_path, paired):
+        reads = [cpp._cpp_read_from_fields(fields) for fields in record]
+        ref_seq = ref_seqs[reads[0].rname]
+        if len(reads) > 1:
+            yield generator.generate_paired(reads[0], reads[1], ref_seq, phred_qscores)
+        else:
+            yield generator.generate_single(reads[0], ref_seq, phred_qscores)
+
+
+def _engine_iterator(engine: str, sam_path: Path, ref_seqs: dict, paired: bool):
+    """Get the bit vector iterator of an engine.
+
+    Raises:
+        ImportError: If the engine's backend is not installed
+    """
+    from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+    from rna_map.io.sam import PYSAM_AVAILABLE
+
+    if engine == "python":
+        return BitVectorIterator(sam_path, ref_seqs, paired)
+    if engine == "python_dense":
+        return BitVectorIterator(sam_path, ref_seqs, paired, dense=True)
+    if engine == "pysam":
+        if not PYSAM_AVAILABLE:
+            raise ImportError("pysam is not installed")
+        return BitVectorIterator(sam_path, ref_seqs, paired, use_pysam=True)
+    if engine == "cpp":
+        from rna_map.pipeline import _cpp_bit_vectors as cpp
+
+        if not cpp.CPP_AVAILABLE:
+            raise ImportError("C++ bit vector module not available")
+        return _iter_cpp_bit_vectors(sam_path, ref_seqs, paired)
+    raise ValueError(f"unknown engine: {engine}")
+
+
+def run_engine(
+    engine: str, sam_path: Path, fasta_path: Path, paired: bool, num_bases: int
+) -> EngineResult:
+    """Time one engine in the current process.
+
+    Args:
+        engine: Engine name (see ENGINES)
+        sam_path: Path to SAM file
+        fasta_path: Path to reference FASTA file
+        paired: Whether reads are paired-end
+        num_bases: Number of read bases in the SAM file
+
+    Returns:
+        EngineResult for the engine
+    """
+    from rna_map.io.fasta import fasta_to_dict
+
+    ref_seqs = fasta_to_dict(fasta_path)
+    try:
+        bit_vectors = _engine_iterator(engine, sam_path, ref_seqs, paired)
+    except ImportError as exc:
+        return EngineResult(engine, status="skipped", message=str(exc))
+    num_reads = 0
+    start = time.perf_counter()
+    for _ in bit_vectors:
+        num_reads += 1
+    seconds = time.perf_counter() - start
+    return EngineResult(
+        engine=engine,
+        num_reads=num_reads,
+        num_bases=num_bases,
+        seconds=seconds,
+        reads_per_sec=num_reads / seconds if seconds else 0.0,
+        ns_per_base=seconds * 1e9 / num_bases if num_bases else 0.0,
+        peak_rss_mb=_peak_rss_mb(),
+    )
+
+
+def run_benchmarks(
+    sam_path: Path,
+    fasta_path: Path,
+    paired: bool,
+    num_bases: int,
+    engines: tuple[str, ...] = ENGINES,
+) -> list[EngineResult]:
+    """Run each engine in its own process.
+
+    Args:
+        sam_path: Path to SAM file
+        fasta_path: Path to reference FASTA file
+        paired: Whether reads are paired-end
+        num_bases: Number of read bases in the SAM file
+        engines: Engines to run
+
+    Returns:
+        One EngineResult per engine, in the order given
+    """
+    results = []
+    ctx = multiprocessing.get_context("spawn")
+    for engine in engines:
+        with ctx.Pool(1) as pool:
+            result = pool.apply(
+                run_engine, (engine, sam_path, fasta_path, paired, num_bases)
+            )
+        log.info(
+            f"{engine}: {result.status} {result.reads_per_sec:.0f} reads/s "
+            f"{result.ns_per_base:.1f} ns/base {result.peak_rss_mb:.1f} MB"
+        )
+        results.append(result)
+    return results
+
+
+def build_report(dataset: dict, results: list[EngineResult]) -> dict:
+    """Build the machine-readable benchmark report.
+
+    Args:
+        dataset: Description of the benchmarked data set
+        results: Engine results
+
+    Returns:
+        JSON-serializable report
+    """
+    from rna_map import __version__
+
+    return {
+        "report_version": REPORT_VERSION,
+        "rna_map_version": __version__,
+        "timestamp": datetime.now(timezone.utc).isoformat(),
+        "host": {
+            "platform": platform.platform(),
+            "python": platform.python_version(),
+            "cpu_count": os.cpu_count(),
+        },
+        "dataset": dataset,
+        "results": [asdict(result) for result in results],
+    }
+
+
+def write_report(report: dict, path: Path) -> None:
+    """Write a benchmark report as JSON.
+
+    Args:
+        report: Report from build_report
+        path: Output path
+    """
+    with open(path, "w") as f:
+        json.dump(report, f, indent=2)
+
+
+def compare_reports(baseline: dict, current: dict) -> dict[str, float]:
+    """Compare the throughput of two reports.
+
+    Args:
+        baseline: Earlier report
+        current: Later report
+
+    Returns:
+        Speedup (current / baseline reads per second) of every engine that
+        ran in both reports
+    """
+    def rates(report: dict) -> dict[str, float]:
+        return {
+            r["engine"]: r["reads_per_sec"]
+            for r in report["results"]
+            if r["status"] == "ok" and r["reads_per_sec"] > 0
+        }
+
+    old, new = rates(baseline), rates(current)
+    return {engine: new[engine] / old[engine] for engine in new if engine in old}
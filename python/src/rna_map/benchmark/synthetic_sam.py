@@ -0,0 +1,192 @@
+"""Synthetic reference and SAM generation for benchmarks.
+
+Reads are drawn from random references with substitutions, deletions and
+insertions at fixed per-base rates. Every read carries a CIGAR string and an
+MD tag that agree with its sequence, so the output can be fed to every bit
+vector engine.
+"""
+
+from dataclasses import asdict, dataclass
+from pathlib import Path
+import random
+
+BASES = "ACGT"
+
+# Indels are kept away from read ends, as aligners do
+_INDEL_EDGE = 5
+_MAX_DELETION = 3
+_MAX_INSERTION = 2
+
+
+@dataclass(frozen=True)
+class SyntheticSamSpec:
+    """Parameters of a synthetic data set.
+
+    Attributes:
+        num_reads: Number of reads (or mate pairs when paired)
+        read_length: Length of every read
+        num_references: Number of reference sequences
+        reference_length: Length of every reference sequence
+        mutation_rate: Per-base substitution rate
+        indel_rate: Per-base rate of insertions and deletions combined
+        paired: Whether to write paired-end reads
+        mapq: Mapping quality written for every read
+        seed: Random seed
+    """
+
+    num_reads: int = 10000
+    read_length: int = 150
+    num_references: int = 1
+    reference_length: int = 300
+    mutation_rate: float = 0.01
+    indel_rate: float = 0.001
+    paired: bool = False
+    mapq: int = 42
+    seed: int = 0
+
+    def to_dict(self) -> dict:
+        """Convert to a dictionary."""
+        return asdict(self)
+
+
+@dataclass(frozen=True)
+class SyntheticDataSet:
+    """Files written by write_synthetic_dataset.
+
+    Attributes:
+        fasta: Path to the reference FASTA file
+        sam: Path to the SAM file
+        num_bases: Total number of read bases in the SAM file
+    """
+
+    fasta: Path
+    sam: Path
+    num_bases: int
+
+
+def _simulate_read(
+    rng: random.Random, ref_seq: str, pos: int, spec: SyntheticSamSpec
+) -> tuple[str, str, str]:
+    """Simulate one read starting at a 1-based reference position.
+
+    Returns:
+        Tuple of (sequence, CIGAR string, MD tag value)
+    """
+    length = spec.read_length
+    seq: list[str] = []
+    ops: list[list] = []
+    md: list[str] = []
+    run = 0
+    ref_i = pos - 1
+
+    def add_op(op: str, n: int) -> None:
+        if ops and ops[-1][0] == op:
+            ops[-1][1] += n
+        else:
+            ops.append([op, n])
+
+    while len(seq) < length and ref_i < len(ref_seq):
+        remaining = length - len(seq)
+        in_body = len(seq) >= _INDEL_EDGE and remaining > _INDEL_EDGE
+        r = rng.random()
+        if in_body and r < spec.indel_rate / 2:
+            n = rng.randint(1, _MAX_DELETION)
+            if ref_i + n + remaining <= len(ref_seq):
+                md += [str(run), "^" + ref_seq[ref_i : ref_i + n]]
+                run = 0
+                add_op("D", n)
+                ref_i += n
+                continue
+        elif in_body and r < spec.indel_rate:
+            n = min(rng.randint(1, _MAX_INSERTION), remaining - _INDEL_EDGE)
+            seq += rng.choices(BASES, k=n)
+            add_op("I", n)
+            continue
+        ref_base = ref_seq[ref_i]
+        if rng.random() < spec.mutation_rate:
+            seq.append(rng.choice(BASES.replace(ref_base, "")))
+            md += [str(run), ref_base]
+            run = 0
+        else:
+            seq.append(ref_base)
+            run += 1
+        add_op("M", 1)
+        ref_i += 1
+    md.append(str(run))
+    cigar = "".join(f"{n}{op}" for op, n in ops)
+    return "".join(seq), cigar, "".join(md)
+
+
+def _sam_line(
+    qname: str, flag: int, rname: str, pos: int, mapq: int, read: tuple,
+    rnext: str = "*", pnext: int = 0, tlen: int = 0,
+) -> str:
+    """Format one SAM record."""
+    seq, cigar, md = read
+    return (
+        f"{qname}\t{flag}\t{rname}\t{pos}\t{mapq}\t{cigar}\t{rnext}\t{pnext}\t"
+        f"{tlen}\t{seq}\t{'I' * len(seq)}\tAS:i:0\tMD:Z:{md}\n"
+    )
+
+
+def write_synthetic_dataset(spec: SyntheticSamSpec, out_dir: Path) -> SyntheticDataSet:
+    """Write a random reference FASTA and a matching SAM file.
+
+    Args:
+        spec: Data set parameters
+        out_dir: Output directory (created if needed)
+
+    Returns:
+        SyntheticDataSet with the written paths
+
+    Raises:
+        ValueError: If the references are too short for the reads
+    """
+    min_ref_length = spec.read_length + _MAX_DELETION * 2
+    if spec.reference_length < min_ref_length:
+        raise ValueError(
+            f"reference_length must be at least {min_ref_length} for reads of "
+            f"length {spec.read_length}"
+        )
+    rng = random.Random(spec.seed)
+    out_dir = Path(out_dir)
+    out_dir.mkdir(parents=True, exist_ok=True)
+    refs = {
+        f"ref_{i}": "".join(rng.choices(BASES, k=spec.reference_length))
+        for i in range(spec.num_references)
+    }
+    fasta_path = out_dir / "synthetic.fasta"
+    with open(fasta_path, "w") as f:
+        for name, seq in refs.items():
+            f.write(f">{name}\n{seq}\n")
+
+    sam_path = out_dir / "synthetic.sam"
+    names = list(refs)
+    last_start = spec.reference_length - spec.read_length - _MAX_DELETION * 2 + 1
+    num_bases = 0
+    with open(sam_path, "w") as f:
+        f.write("@HD\tVN:1.0\tSO:unsorted\n")
+        for name in names:
+            f.write(f"@SQ\tSN:{name}\tLN:{spec.reference_length}\n")
+        f.write("@PG\tID:synthetic\tPN:rna_map.benchmark\n")
+        for i in range(spec.num_reads):
+            name = rng.choice(names)
+            ref_seq = refs[name]
+            qname = f"read_{i}"
+            pos1 = rng.randint(1, last_start)
+            read1 = _simulate_read(rng, ref_seq, pos1, spec)
+            num_bases += len(read1[0])
+            if not spec.paired:
+                f.write(_sam_line(qname, 0, name, pos1, spec.mapq, read1))
+                continue
+            pos2 = rng.randint(pos1, last_start)
+            read2 = _simulate_read(rng, ref_seq, pos2, spec)
+            num_bases += len(read2[0])
+            tlen = pos2 + spec.read_length - pos1
+            f.write(
+                _sam_line(qname, 99, name, pos1, spec.mapq, read1, "=", pos2, tlen)
+            )
+            f.write(
+                _sam_line(qname, 147, name, pos2, spec.mapq, read2, "=", pos1, -tlen)
+            )
+    return SyntheticDataSet(fasta=fasta_path, sam=sam_path, num_bases=num_bases)
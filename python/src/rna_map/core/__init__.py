@@ -2,7 +2,7 @@
 
 This module contains core data structures including:
 - Input dataclasses
-- Bit vector data structures
+- Bit vector data structures (dict and dense)
 - Aligned read data structures
 - Configuration dataclasses
 - Result dataclasses
@@ -11,6 +11,7 @@ This module contains core data structures including:
 from rna_map.core.aligned_read import AlignedRead
 from rna_map.core.bit_vector import BitVector, BitVectorSymbols
 from rna_map.core.config import BitVectorConfig, MappingConfig, StricterConstraints
+from rna_map.core.dense_bit_vector import DenseBitVector
 # from rna_map.core.inputs import Inputs  # Not needed for bit vector generation
 from rna_map.core.results import BitVectorResult
 
@@ -18,6 +19,7 @@ __all__ = [
     "AlignedRead",
     "BitVector",
     "BitVectorSymbols",
+    "DenseBitVector",
     "Inputs",
     "MappingConfig",  # Used by CLI for parsing arguments
     "BitVectorConfig",  # Used by Nextflow
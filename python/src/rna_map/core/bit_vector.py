@@ -2,6 +2,7 @@
 
 from dataclasses import dataclass
 
+from rna_map.core.dense_bit_vector import DenseBitVector
 from rna_map.io.sam import AlignedRead
 
 
@@ -11,11 +12,11 @@ class BitVector:
 
     Attributes:
         reads: List of aligned reads used to generate this bit vector
-        data: Dictionary mapping positions to bit values
+        data: Dictionary (or DenseBitVector) mapping positions to bit values
     """
 
     reads: list[AlignedRead]
-    data: dict[int, str]
+    data: dict[int, str] | DenseBitVector
 
 
 @dataclass(frozen=True, order=True)
@@ -0,0 +1,100 @@
+"""CIGAR decoding into packed operations.
+
+Operations are packed like BAM's binary CIGAR, ``length << 4 | op`` with the
+op codes of ``CIGAR_OPS``, so CIGARs read from BAM files through pysam need
+no text step. Text CIGARs are decoded once per distinct string; aligned
+libraries share a handful of CIGARs across millions of reads.
+"""
+
+from functools import lru_cache
+import re
+from typing import Iterable
+
+# BAM op codes are the indices into this string
+CIGAR_OPS = "MIDNSHP=X"
+OP_M, OP_I, OP_D, OP_N, OP_S, OP_H, OP_P, OP_EQ, OP_X = range(len(CIGAR_OPS))
+OP_SHIFT = 4
+OP_MASK = 0xF
+
+# Ops compared base by base against the reference
+MATCH_OPS = frozenset((OP_M, OP_EQ, OP_X))
+# Ops that advance the reference position
+REF_OPS = frozenset((OP_M, OP_D, OP_N, OP_EQ, OP_X))
+# Ops that consume neither read nor reference bases
+EMPTY_OPS = frozenset((OP_H, OP_P))
+
+_TOKEN = re.compile(r"(\d+)(\D)")
+# Number of distinct CIGAR strings kept decoded
+CIGAR_CACHE_SIZE = 1 << 14
+
+
+@lru_cache(maxsize=CIGAR_CACHE_SIZE)
+def parse_cigar(cigar: str) -> tuple[int, ...] | None:
+    """Decode a text CIGAR into packed operations.
+
+    Args:
+        cigar: CIGAR string; "*" and "" decode to no operations
+
+    Returns:
+        Packed operations, or None if the CIGAR has an op outside CIGAR_OPS
+        or is malformed
+    """
+    if cigar in ("*", ""):
+        return ()
+    ops = []
+    consumed = 0
+    for match in _TOKEN.finditer(cigar):
+        if match.start() != consumed:
+            return None
+        code = CIGAR_OPS.find(match.group(2))
+        if code < 0:
+            return None
+        ops.append(int(match.group(1)) << OP_SHIFT | code)
+        consumed = match.end()
+    if consumed != len(cigar):
+        return None
+    return tuple(ops)
+
+
+def pack_cigartuples(
+    cigartuples: Iterable[tuple[int, int]] | None,
+) -> tuple[int, ...]:
+    """Pack pysam (op, length) CIGAR tuples.
+
+    Args:
+        cigartuples: pysam AlignedSegment.cigartuples, None if unaligned
+
+    Returns:
+        Packed operations
+    """
+    if not cigartuples:
+        return ()
+    return tuple(length << OP_SHIFT | op for op, length in cigartuples)
+
+
+def last_consuming_op(ops: tuple[int, ...]) -> int:
+    """Get the index of the last op that is not a hard clip or padding.
+
+    Args:
+        ops: Packed operations
+
+    Returns:
+        Index into ops, -1 if there is no such op
+    """
+    last = len(ops) - 1
+    while last >= 0 and ops[last] & OP_MASK in EMPTY_OPS:
+        last -= 1
+    return last
+
+
+def format_cigar(ops: Iterable[int]) -> str:
+    """Encode packed operations as a text CIGAR.
+
+    Args:
+        ops: Packed operations
+
+    Returns:
+        CIGAR string, "*" if there are no operations
+    """
+    text = "".join(f"{op >> OP_SHIFT}{CIGAR_OPS[op & OP_MASK]}" for op in ops)
+    return text or "*"
@@ -3,6 +3,8 @@
 from dataclasses import dataclass
 
 from rna_map.io.bit_vector_storage import StorageFormat
+from rna_map.io.plot_bundle import DEFAULT_PLOT_TOP_N, PlotMode
+from rna_map.io.rejected_log import DEFAULT_SAMPLE_EVERY, RejectedLogMode
 
 
 @dataclass(frozen=True)
@@ -86,9 +88,39 @@ class BitVectorConfig:
         map_score_cutoff: Minimum mapping score cutoff
         plot_sequence: Whether to plot sequence/structure on plots
         summary_output_only: Only generate summary files (skip bit vector files)
-        storage_format: Storage format for bit vectors (TEXT or JSON)
+        storage_format: Storage format for bit vectors (TEXT, JSON or COLUMNAR)
         stricter_constraints: Optional stricter constraints
         use_cpp: Whether to use C++ implementation (if available)
+        use_pysam: Whether to use pysam for SAM parsing
+        num_workers: Number of worker processes for bit vector generation
+        dense_bit_vectors: Use DenseBitVector arrays instead of dicts per read
+        max_memory_mb: Memory ceiling (MB) for reads buffered between stages
+        histogram_json: Also write mutation_histos.json (binary always)
+        histogram_pickle: Also write mutation_histos.p, for readers of the
+            old pickle output (binary always)
+        rejected_log: What is logged about rejected reads (off/counts/sampled/full)
+        rejected_log_every: In sampled mode, log one of every this many rejects
+        rejected_log_compress: Write rejected_bvs.csv.gz instead of rejected_bvs.csv
+        dedup_cache_size: Bit vectors cached for reads with identical
+            alignments (0 disables the cache)
+        collapse_duplicates: Write reads with the same bit vector once, with
+            their count in collapsed_counts.csv; with many distinct bit
+            vectors a bit vector can be written once per table flush
+        plot_mode: Which references are plotted (all/top/none); pop_avg.json
+            always has all of them
+        plot_top_n: In top mode, the number of references plotted
+        plot_min_reads: References with fewer aligned reads are not plotted
+        plot_workers: Number of worker processes rendering plots
+        checkpoint_every: Write a checkpoint of the histograms every this
+            many SAM records (0 disables checkpoints)
+        resume: Continue from the checkpoint of the same SAM file; needs
+            summary_output_only and a rejected_log of off or counts, since
+            bit vector files and rejected rows cannot be resumed
+        append_histograms: Add the reads to the histograms already in the
+            output directory instead of starting from zero
+        checkpoint_dir: Directory of the checkpoint files, the output
+            directory if None; a directory that outlives the job lets a
+            rerun in a new working directory resume
     """
 
     qscore_cutoff: int = 25
@@ -100,6 +132,24 @@ class BitVectorConfig:
     stricter_constraints: StricterConstraints | None = None
     use_cpp: bool = False
     use_pysam: bool = False
+    num_workers: int = 1
+    dense_bit_vectors: bool = False
+    max_memory_mb: int | None = None
+    histogram_json: bool = False
+    histogram_pickle: bool = False
+    rejected_log: RejectedLogMode = RejectedLogMode.FULL
+    rejected_log_every: int = DEFAULT_SAMPLE_EVERY
+    rejected_log_compress: bool = False
+    dedup_cache_size: int = 0
+    collapse_duplicates: bool = False
+    plot_mode: PlotMode = PlotMode.ALL
+    plot_top_n: int = DEFAULT_PLOT_TOP_N
+    plot_min_reads: int = 0
+    plot_workers: int = 1
+    checkpoint_every: int = 0
+    resume: bool = False
+    append_histograms: bool = False
+    checkpoint_dir: str | None = None
 
     @classmethod
     def from_dict(cls, data: dict, use_stricter: bool = False) -> "BitVectorConfig":
@@ -116,12 +166,7 @@ class BitVectorConfig:
         if use_stricter and "stricter_constraints" in data:
             stricter = StricterConstraints.from_dict(data["stricter_constraints"])
 
-        storage_format_str = data.get("storage_format", "text").lower()
-        storage_format = (
-            StorageFormat.JSON
-            if storage_format_str == "json"
-            else StorageFormat.TEXT
-        )
+        storage_format = StorageFormat.parse(data.get("storage_format", "text"))
 
         return cls(
             qscore_cutoff=data.get("qscore_cutoff", 25),
@@ -133,5 +178,67 @@ class BitVectorConfig:
             stricter_constraints=stricter,
             use_cpp=data.get("use_cpp", False),
             use_pysam=data.get("use_pysam", False),
+            num_workers=data.get("num_workers", 1),
+            dense_bit_vectors=data.get("dense_bit_vectors", False),
+            max_memory_mb=data.get("max_memory_mb"),
+            histogram_json=data.get("histogram_json", False),
+            histogram_pickle=data.get("histogram_pickle", False),
+            rejected_log=RejectedLogMode.parse(data.get("rejected_log", "full")),
+            rejected_log_every=data.get("rejected_log_every", DEFAULT_SAMPLE_EVERY),
+            rejected_log_compress=data.get("rejected_log_compress", False),
+            dedup_cache_size=data.get("dedup_cache_size", 0),
+            collapse_duplicates=data.get("collapse_duplicates", False),
+            plot_mode=PlotMode.parse(data.get("plot_mode", "all")),
+            plot_top_n=data.get("plot_top_n", DEFAULT_PLOT_TOP_N),
+            plot_min_reads=data.get("plot_min_reads", 0),
+            plot_workers=data.get("plot_workers", 1),
+            checkpoint_every=data.get("checkpoint_every", 0),
+            resume=data.get("resume", False),
+            append_histograms=data.get("append_histograms", False),
+            checkpoint_dir=data.get("checkpoint_dir"),
         )
 
+    def to_params(self) -> dict:
+        """Build the ``bit_vector`` section of the BitVectorGenerator params.
+
+        This is the inverse of from_dict for the options the generator reads;
+        use_cpp and use_pysam pick the backend and are not passed on.
+
+        Returns:
+            Dictionary with bit vector configuration
+        """
+        params = {
+            "qscore_cutoff": self.qscore_cutoff,
+            "num_of_surbases": self.num_of_surbases,
+            "map_score_cutoff": self.map_score_cutoff,
+            "plot_sequence": self.plot_sequence,
+            "summary_output_only": self.summary_output_only,
+            "storage_format": self.storage_format.value,
+            "num_workers": self.num_workers,
+            "dense_bit_vectors": self.dense_bit_vectors,
+            "max_memory_mb": self.max_memory_mb,
+            "histogram_json": self.histogram_json,
+            "histogram_pickle": self.histogram_pickle,
+            "rejected_log": self.rejected_log.value,
+            "rejected_log_every": self.rejected_log_every,
+            "rejected_log_compress": self.rejected_log_compress,
+            "dedup_cache_size": self.dedup_cache_size,
+            "collapse_duplicates": self.collapse_duplicates,
+            "plot_mode": self.plot_mode.value,
+            "plot_top_n": self.plot_top_n,
+            "plot_min_reads": self.plot_min_reads,
+            "plot_workers": self.plot_workers,
+            "checkpoint_every": self.checkpoint_every,
+            "resume": self.resume,
+            "append_histograms": self.append_histograms,
+            "checkpoint_dir": self.checkpoint_dir,
+        }
+        stricter = self.stricter_constraints
+        if stricter:
+            params["stricter_constraints"] = {
+                "min_mut_distance": stricter.min_mut_distance,
+                "percent_length_cutoff": stricter.percent_length_cutoff,
+                "mutation_count_cutoff": stricter.mutation_count_cutoff,
+            }
+        return params
+
@@ -0,0 +1,328 @@
+"""Dense byte-array bit vector representation.
+
+A ``DenseBitVector`` stores one uint8 symbol code per reference position
+over the span a read covers, instead of a ``dict[int, str]`` with one string
+per position. It implements the mapping protocol (``pos -> symbol``), so
+code written against dict bit vectors keeps working, while histogram
+updates and writers can use the ``codes`` numpy view directly.
+"""
+
+from collections.abc import Iterator, MutableMapping
+from typing import Callable
+
+import numpy as np
+
+# Symbol codes; 0 marks positions the read does not cover
+NO_DATA = 0
+NOMUT = 1
+DEL = 2
+AMBIG = 3
+MISS = 4
+A, C, G, T, N = 5, 6, 7, 8, 9
+BASE_CODES = {"A": A, "C": C, "G": G, "T": T}
+
+# Code -> symbol; any read base other than A/C/G/T is stored as N
+SYMBOLS = ".01?*ACGTN"
+ENCODE = {symbol: code for code, symbol in enumerate(SYMBOLS) if code != NO_DATA}
+DECODE_TABLE = np.frombuffer(SYMBOLS.encode(), dtype=np.uint8)
+# ASCII byte -> code, for encoding whole runs of symbols at once
+ENCODE_TABLE = np.full(256, N, dtype=np.uint8)
+for _symbol, _code in ENCODE.items():
+    ENCODE_TABLE[ord(_symbol)] = _code
+
+
+def _resolve_conflict_codes(code_1: int, code_2: int) -> int | None:
+    """Resolve two overlapping mate symbols, None if no rule applies."""
+    if code_1 == code_2 or code_2 == NO_DATA:
+        return code_1
+    if code_1 == NO_DATA:
+        return code_2
+    codes = {code_1, code_2}
+    if NOMUT in codes:
+        return NOMUT
+    # Ambiguous and missing information yield to the other mate
+    for code in (AMBIG, MISS):
+        if code in codes:
+            return (codes - {code}).pop()
+    if codes <= {A, C, G, T, DEL}:
+        return AMBIG
+    return None
+
+
+def _build_conflict_tables() -> tuple[np.ndarray, np.ndarray]:
+    table = np.zeros((len(SYMBOLS), len(SYMBOLS)), dtype=np.uint8)
+    unresolved = np.zeros((len(SYMBOLS), len(SYMBOLS)), dtype=bool)
+    for code_1 in range(len(SYMBOLS)):
+        for code_2 in range(len(SYMBOLS)):
+            code = _resolve_conflict_codes(code_1, code_2)
+            # Without a rule mate 1 wins, as BitVectorIterator always did
+            table[code_1, code_2] = code_1 if code is None else code
+            unresolved[code_1, code_2] = code is None
+    return table, unresolved
+
+
+# Merged code of two mates by (mate 1 code, mate 2 code): nomut beats a
+# mutation, ambiguous and missing yield to the other mate, and two different
+# bases or a base and a deletion are ambiguous. UNRESOLVED_CONFLICTS marks
+# the pairs no rule covers (N against a base or deletion).
+CONFLICT_TABLE, UNRESOLVED_CONFLICTS = _build_conflict_tables()
+
+
+def encode_symbol(symbol: str) -> int:
+    """Get the code of a bit vector symbol.
+
+    Args:
+        symbol: Bit vector symbol (BitVectorSymbols value or read base)
+
+    Returns:
+        Symbol code
+    """
+    return ENCODE.get(symbol, N)
+
+
+def is_mutation(codes: np.ndarray) -> np.ndarray:
+    """Get a mask of positions holding an A/C/G/T mutation.
+
+    Args:
+        codes: Array of symbol codes
+
+    Returns:
+        Boolean mask
+    """
+    return (codes >= A) & (codes <= T)
+
+
+class DenseBitVector(MutableMapping):
+    """Bit vector stored as a contiguous array of symbol codes.
+
+    Attributes:
+        start: Reference position (1-based) of the first code
+        codes: uint8 numpy view over the code buffer (zero-copy)
+    """
+
+    __slots__ = ("start", "_buf")
+
+    def __init__(self, start: int, length: int) -> None:
+        """Initialize an empty DenseBitVector.
+
+        Args:
+            start: Reference position (1-based) of the first code
+            length: Number of reference positions covered
+        """
+        self.start = start
+        self._buf = bytearray(length)
+
+    @classmethod
+    def from_dict(cls, data: dict[int, str]) -> "DenseBitVector":
+        """Create from a dictionary bit vector.
+
+        Args:
+            data: Dictionary mapping positions to bit values
+
+        Returns:
+            DenseBitVector instance
+        """
+        if not data:
+            return cls(1, 0)
+        start = min(data)
+        bit_vector = cls(start, max(data) - start + 1)
+        for pos, bit in data.items():
+            bit_vector[pos] = bit
+        return bit_vector
+
+    @classmethod
+    def from_codes(cls, start: int, codes: np.ndarray) -> "DenseBitVector":
+        """Create from an array of symbol codes.
+
+        Args:
+            start: Reference position (1-based) of the first code
+            codes: Array of symbol codes
+
+        Returns:
+            DenseBitVector instance
+        """
+        bit_vector = cls(start, 0)
+        bit_vector._buf = bytearray(np.asarray(codes, dtype=np.uint8).tobytes())
+        return bit_vector
+
+    @property
+    def codes(self) -> np.ndarray:
+        """Get the symbol codes as a numpy array sharing this buffer."""
+        if not self._buf:
+            return np.zeros(0, dtype=np.uint8)
+        return np.frombuffer(self._buf, dtype=np.uint8)
+
+    @property
+    def end(self) -> int:
+        """Get the last reference position (1-based) of the code buffer."""
+        return self.start + len(self._buf) - 1
+
+    def __getitem__(self, pos: int) -> str:
+        """Get the symbol at a reference position.
+
+        Raises:
+            KeyError: If the position is not covered
+        """
+        idx = pos - self.start
+        if idx < 0 or idx >= len(self._buf) or self._buf[idx] == NO_DATA:
+            raise KeyError(pos)
+        return SYMBOLS[self._buf[idx]]
+
+    def __setitem__(self, pos: int, symbol: str) -> None:
+        """Set the symbol at a reference position inside the buffer."""
+        self._buf[pos - self.start] = ENCODE.get(symbol, N)
+
+    def set_codes(self, pos: int, codes: np.ndarray) -> None:
+        """Set a run of symbol codes starting at a reference position.
+
+        Args:
+            pos: Reference position (1-based) of the first code
+            codes: uint8 array of symbol codes
+        """
+        idx = pos - self.start
+        self._buf[idx : idx + len(codes)] = codes.tobytes()
+
+    def __delitem__(self, pos: int) -> None:
+        """Mark a reference position as not covered."""
+        if pos not in self:
+            raise KeyError(pos)
+        self._buf[pos - self.start] = NO_DATA
+
+    def __contains__(self, pos: object) -> bool:
+        """Check if a reference position is covered."""
+        if not isinstance(pos, (int, np.integer)):
+            return False
+        idx = pos - self.start
+        return 0 <= idx < len(self._buf) and self._buf[idx] != NO_DATA
+
+    def __iter__(self) -> Iterator[int]:
+        """Iterate over covered positions in reference order."""
+        for idx in np.flatnonzero(self.codes):
+            yield self.start + int(idx)
+
+    def __len__(self) -> int:
+        """Get the number of covered positions."""
+        return len(self._buf) - self._buf.count(NO_DATA)
+
+    def __getstate__(self):
+        """Get state for pickling."""
+        return self.start, bytes(self._buf)
+
+    def __setstate__(self, state) -> None:
+        """Restore state from pickling."""
+        self.start, buf = state
+        self._buf = bytearray(buf)
+
+    def __repr__(self) -> str:
+        """Get string representation."""
+        bit_string = self.get_bit_string(self.start, self.end)
+        return f"DenseBitVector(start={self.start}, {bit_string!r})"
+
+    def to_dict(self) -> dict[int, str]:
+        """Convert to a dictionary bit vector.
+
+        Returns:
+            Dictionary mapping positions to bit values
+        """
+        return {pos: self[pos] for pos in self}
+
+    def get_codes(self, start: int, end: int) -> np.ndarray:
+        """Get symbol codes for a reference range, NO_DATA where uncovered.
+
+        Args:
+            start: First reference position (1-based)
+            end: Last reference position (1-based, inclusive)
+
+        Returns:
+            uint8 array of length end - start + 1
+        """
+        out = np.zeros(max(end - start + 1, 0), dtype=np.uint8)
+        lo = max(start, self.start)
+        hi = min(end, self.end)
+        if lo <= hi:
+            out[lo - start : hi - start + 1] = self.codes[
+                lo - self.start : hi - self.start + 1
+            ]
+        return out
+
+    def get_bit_string(self, start: int, end: int) -> str:
+        """Get the bit vector string for a reference range, '.' where uncovered.
+
+        Args:
+            start: First reference position (1-based)
+            end: Last reference position (1-based, inclusive)
+
+        Returns:
+            Bit vector string
+        """
+        return DECODE_TABLE[self.get_codes(start, end)].tobytes().decode()
+
+    def mutation_positions(self, start: int, end: int) -> np.ndarray:
+        """Get sorted A/C/G/T mutation positions inside a reference range.
+
+        Args:
+            start: First reference position (1-based)
+            end: Last reference position (1-based, inclusive)
+
+        Returns:
+            Array of mutated positions
+        """
+        return np.flatnonzero(is_mutation(self.get_codes(start, end))) + start
+
+
+def get_bit_string(data: dict[int, str] | DenseBitVector, start: int, end: int) -> str:
+    """Get the bit vector string for a reference range, '.' where uncovered.
+
+    Args:
+        data: Dictionary or dense bit vector
+        start: First reference position (1-based)
+        end: Last reference position (1-based, inclusive)
+
+    Returns:
+        Bit vector string
+    """
+    if isinstance(data, DenseBitVector):
+        return data.get_bit_string(start, end)
+    return "".join(data.get(pos, ".") for pos in range(start, end + 1))
+
+
+def merge_dense_bit_vectors(
+    bit_vector_1: DenseBitVector,
+    bit_vector_2: DenseBitVector,
+    resolve: Callable[[str, str], str] | None = None,
+) -> DenseBitVector:
+    """Merge the dense bit vectors of two mates.
+
+    Mate 1 is copied into a buffer spanning both mates and mate 2 is folded
+    in through CONFLICT_TABLE, so overlapping mates cost one table lookup
+    per position.
+
+    Args:
+        bit_vector_1: Bit vector of mate 1
+        bit_vector_2: Bit vector of mate 2
+        resolve: Called as ``resolve(symbol_1, symbol_2)`` for the symbol
+            pairs CONFLICT_TABLE has no rule for; mate 1's symbol is kept if
+            None
+
+    Returns:
+        Merged bit vector
+    """
+    if not len(bit_vector_2._buf):
+        return bit_vector_1
+    if not len(bit_vector_1._buf):
+        return bit_vector_2
+    start = min(bit_vector_1.start, bit_vector_2.start)
+    end = max(bit_vector_1.end, bit_vector_2.end)
+    codes_1 = bit_vector_1.get_codes(bit_vector_2.start, bit_vector_2.end)
+    codes_2 = bit_vector_2.codes
+    merged_codes = CONFLICT_TABLE[codes_1, codes_2]
+    if resolve is not None:
+        for idx in np.flatnonzero(UNRESOLVED_CONFLICTS[codes_1, codes_2]):
+            bit = resolve(SYMBOLS[codes_1[idx]], SYMBOLS[codes_2[idx]])
+            merged_codes[idx] = encode_symbol(bit)
+    merged = DenseBitVector(start, end - start + 1)
+    idx_1 = bit_vector_1.start - start
+    merged._buf[idx_1 : idx_1 + len(bit_vector_1._buf)] = bit_vector_1._buf
+    idx_2 = bit_vector_2.start - start
+    merged._buf[idx_2 : idx_2 + len(codes_2)] = merged_codes.tobytes()
+    return merged
@@ -2,6 +2,7 @@
 
 import json
 from abc import ABC, abstractmethod
+from collections import OrderedDict
 from enum import Enum
 from pathlib import Path
 from typing import Any
@@ -10,12 +11,37 @@ from rna_map.logger import get_logger
 
 log = get_logger("IO.BIT_VECTOR_STORAGE")
 
+# Limits of TextWriterPool: open files, and characters buffered across references
+DEFAULT_MAX_OPEN_FILES = 64
+DEFAULT_BUFFER_BYTES = 32 * 2**20
+COLLAPSED_COUNTS_FILE_NAME = "collapsed_counts.csv"
+DEFAULT_COLLAPSE_MAX_GROUPS = 1_000_000
+DEFAULT_COLLAPSE_MAX_BYTES = 512 * 2**20
+# Rough size of a group's key, dict entry and list beyond its contents
+_GROUP_OVERHEAD_BYTES = 256
+
 
 class StorageFormat(str, Enum):
     """Bit vector storage format options."""
 
     TEXT = "text"  # Original text format (_bitvectors.txt)
     JSON = "json"  # JSON format (muts.json)
+    COLUMNAR = "columnar"  # Chunked binary format (columnar_bitvectors.rmbv)
+
+    @classmethod
+    def parse(cls, value: str) -> "StorageFormat":
+        """Parse a storage format name, falling back to TEXT.
+
+        Args:
+            value: Storage format name (case-insensitive)
+
+        Returns:
+            StorageFormat member
+        """
+        try:
+            return cls(value.lower())
+        except ValueError:
+            return cls.TEXT
 
 
 class BitVectorStorageWriter(ABC):
@@ -48,6 +74,36 @@ class BitVectorStorageWriter(ABC):
         self.close()
 
 
+def _text_header(name: str, sequence: str, data_type: str, start: int, end: int) -> str:
+    return (
+        f"@ref\t{name}\t{sequence}\t{data_type}\n"
+        f"@coordinates:\t{start},{end}:{len(sequence)}\n"
+        "Query_name\tBit_vector\tN_Mutations\n"
+    )
+
+
+def _text_line(q_name: str, bit_vector: dict[int, str], start: int, end: int) -> str:
+    # Lazy import to avoid circular dependency (core.config imports this module)
+    from rna_map.core import dense_bit_vector as dense
+
+    if isinstance(bit_vector, dense.DenseBitVector):
+        codes = bit_vector.get_codes(start, end)
+        n_mutations = int((codes >= dense.A).sum())
+        bit_string = dense.DECODE_TABLE[codes].tobytes().decode()
+        return f"{q_name}\t{bit_string}\t{n_mutations}\n"
+    n_mutations = 0
+    bit_string = ""
+    for pos in range(start, end + 1):
+        if pos not in bit_vector:
+            bit_string += "."
+        else:
+            read_bit = bit_vector[pos]
+            if read_bit.isalpha():
+                n_mutations += 1
+            bit_string += read_bit
+    return f"{q_name}\t{bit_string}\t{n_mutations}\n"
+
+
 class TextStorageWriter(BitVectorStorageWriter):
     """Text format storage writer (original format)."""
 
@@ -75,9 +131,7 @@ class TextStorageWriter(BitVectorStorageWriter):
         self.sequence = sequence
         self.file_path = path / Path(name + "_bitvectors.txt")
         self.f = open(self.file_path, "w")
-        self.f.write(f"@ref\t{name}\t{sequence}\t{data_type}\n")
-        self.f.write(f"@coordinates:\t{start},{end}:{len(sequence)}\n")
-        self.f.write("Query_name\tBit_vector\tN_Mutations\n")
+        self.f.write(_text_header(name, sequence, data_type, start, end))
 
     def write_bit_vector(
         self, q_name: str, bit_vector: dict[int, str], reads: list[Any]
@@ -86,20 +140,10 @@ class TextStorageWriter(BitVectorStorageWriter):
 
         Args:
             q_name: Query name
-            bit_vector: Bit vector dictionary
+            bit_vector: Bit vector dictionary or DenseBitVector
             reads: List of reads (unused in text format)
         """
-        n_mutations = 0
-        bit_string = ""
-        for pos in range(self.start, self.end + 1):
-            if pos not in bit_vector:
-                bit_string += "."
-            else:
-                read_bit = bit_vector[pos]
-                if read_bit.isalpha():
-                    n_mutations += 1
-                bit_string += read_bit
-        self.f.write(f"{q_name}\t{bit_string}\t{n_mutations}\n")
+        self.f.write(_text_line(q_name, bit_vector, self.start, self.end))
 
     def close(self) -> None:
         """Close the file."""
@@ -107,6 +151,123 @@ class TextStorageWriter(BitVectorStorageWriter):
             self.f.close()
 
 
+class TextWriterPool(BitVectorStorageWriter):
+    """Text format writer for many references with few open files.
+
+    Writes the same <name>_bitvectors.txt files as one TextStorageWriter per
+    reference, but lines are buffered per reference and appended in large
+    writes once buffer_bytes is used up, largest buffers first. At most
+    max_open files are open at a time; the least recently used is closed
+    to make room, so libraries with thousands of references stay within
+    the file descriptor limit.
+    """
+
+    def __init__(
+        self,
+        path: Path,
+        ref_seqs: dict[str, str],
+        data_type: str = "DMS",
+        max_open: int = DEFAULT_MAX_OPEN_FILES,
+        buffer_bytes: int = DEFAULT_BUFFER_BYTES,
+    ) -> None:
+        """Initialize the writer pool.
+
+        Args:
+            path: Output directory path
+            ref_seqs: Reference sequences by name; bit vectors of other
+                references are dropped
+            data_type: Type of data (e.g., "DMS")
+            max_open: Maximum number of open files
+            buffer_bytes: Buffered characters across all references before
+                buffers are flushed
+        """
+        self.path = path
+        self.__ref_seqs = ref_seqs
+        self.__data_type = data_type
+        self.__max_open = max(1, max_open)
+        self.__buffer_bytes = buffer_bytes
+        self.__buffers: dict[str, list[str]] = {}
+        self.__sizes: dict[str, int] = {}
+        self.__buffered = 0
+        self.__open: OrderedDict[str, Any] = OrderedDict()
+        self.__created: set[str] = set()
+        self.files_opened = 0
+
+    def write_bit_vector(
+        self, q_name: str, bit_vector: dict[int, str], reads: list[Any]
+    ) -> None:
+        """Buffer a bit vector in the text file of its reference.
+
+        Args:
+            q_name: Query name
+            bit_vector: Bit vector dictionary or DenseBitVector
+            reads: List of reads; the first read's rname selects the file
+        """
+        name = reads[0].rname
+        sequence = self.__ref_seqs.get(name)
+        if sequence is None:
+            return
+        line = _text_line(q_name, bit_vector, 1, len(sequence))
+        buffer = self.__buffers.get(name)
+        if buffer is None:
+            buffer = self.__buffers[name] = []
+            self.__sizes[name] = 0
+        buffer.append(line)
+        self.__sizes[name] += len(line)
+        self.__buffered += len(line)
+        if self.__buffered > self.__buffer_bytes:
+            self.__flush_largest()
+
+    def __flush_largest(self) -> None:
+        """Flush the largest buffers until half of the budget is free."""
+        for name in sorted(self.__sizes, key=self.__sizes.get, reverse=True):
+            if self.__buffered <= self.__buffer_bytes // 2:
+                break
+            self.__flush(name)
+
+    def __flush(self, name: str) -> None:
+        buffer = self.__buffers.pop(name)
+        self.__buffered -= self.__sizes.pop(name)
+        self.__handle(name).write("".join(buffer))
+
+    def __handle(self, name: str):
+        """Get the open file of a reference, opening it if needed."""
+        f = self.__open.get(name)
+        if f is not None:
+            self.__open.move_to_end(name)
+            return f
+        if len(self.__open) >= self.__max_open:
+            _, oldest = self.__open.popitem(last=False)
+            oldest.close()
+        file_path = self.path / f"{name}_bitvectors.txt"
+        self.files_opened += 1
+        if name in self.__created:
+            f = open(file_path, "a")
+        else:
+            f = open(file_path, "w")
+            sequence = self.__ref_seqs[name]
+            f.write(_text_header(name, sequence, self.__data_type, 1, len(sequence)))
+            self.__created.add(name)
+        self.__open[name] = f
+        return f
+
+    def close(self) -> None:
+        """Flush all buffers, close all files and write header-only files."""
+        for name in list(self.__buffers):
+            self.__flush(name)
+        for f in self.__open.values():
+            f.close()
+        self.__open.clear()
+        # A reference without reads still gets a file, as with TextStorageWriter
+        for name, sequence in self.__ref_seqs.items():
+            if name not in self.__created:
+                with open(self.path / f"{name}_bitvectors.txt", "w") as f:
+                    f.write(
+                        _text_header(name, sequence, self.__data_type, 1, len(sequence))
+                    )
+                self.__created.add(name)
+
+
 class JsonStorageWriter(BitVectorStorageWriter):
     """JSON format storage writer (better_mut_storage format)."""
 
@@ -172,6 +333,123 @@ class JsonStorageWriter(BitVectorStorageWriter):
             self.f.close()
 
 
+def _content_key(bit_vector: dict[int, str]) -> tuple:
+    """Get a key that is equal for bit vectors with the same symbols."""
+    # Lazy import to avoid circular dependency (core.config imports this module)
+    from rna_map.core.dense_bit_vector import DenseBitVector
+
+    if isinstance(bit_vector, DenseBitVector):
+        # Uncovered (zero) codes at either end do not change the bit vector
+        codes = bit_vector.codes.tobytes()
+        trimmed = codes.lstrip(b"\0")
+        start = bit_vector.start + len(codes) - len(trimmed)
+        return (start, trimmed.rstrip(b"\0"))
+    return tuple(sorted(bit_vector.items()))
+
+
+class _ReadMetadata:
+    """The fields of an aligned read that storage writers use."""
+
+    __slots__ = ("rname", "mapq", "seq")
+
+    def __init__(self, read: Any) -> None:
+        self.rname = read.rname
+        self.mapq = read.mapq
+        self.seq = read.seq
+
+
+def _group_bytes(q_name: str, key: tuple, reads: list[_ReadMetadata]) -> int:
+    """Estimate the memory held by a group of a CollapsingWriter."""
+    content = key[1]
+    if len(content) == 2 and isinstance(content[1], bytes):
+        # DenseBitVector key: (start, trimmed codes)
+        size = len(content[1])
+    else:
+        # Sorted (position, symbol) pairs, stored twice: in the key and the dict
+        size = 2 * 64 * len(content)
+    return _GROUP_OVERHEAD_BYTES + len(q_name) + size + sum(len(r.seq) for r in reads)
+
+
+class CollapsingWriter(BitVectorStorageWriter):
+    """Writes each distinct bit vector once instead of once per read.
+
+    Bit vectors are grouped by reference and content. When the group table
+    holds max_groups groups or about max_bytes bytes, and when closed, the
+    first read of each group is written to the wrapped writer, in order of
+    first appearance, and collapsed_counts.csv gets the number of reads of
+    each group by that read's name. Memory is therefore bounded, but a bit
+    vector seen again after a flush starts a new group: a bit vector can
+    appear more than once in the output, and its total count is the sum of
+    its rows in collapsed_counts.csv. Of each group's reads only the fields
+    storage writers use are kept.
+    """
+
+    def __init__(
+        self,
+        writer: BitVectorStorageWriter,
+        path: Path,
+        max_groups: int = DEFAULT_COLLAPSE_MAX_GROUPS,
+        max_bytes: int = DEFAULT_COLLAPSE_MAX_BYTES,
+    ) -> None:
+        """Initialize the collapsing writer.
+
+        Args:
+            writer: Writer that receives one bit vector per group
+            path: Output directory of collapsed_counts.csv
+            max_groups: Groups held before the table is flushed
+            max_bytes: Estimated bytes held before the table is flushed
+        """
+        self.writer = writer
+        self.file_path = Path(path) / COLLAPSED_COUNTS_FILE_NAME
+        self.max_groups = max(1, max_groups)
+        self.max_bytes = max_bytes
+        self.flushes = 0
+        self.__groups: dict[tuple, list] = {}
+        self.__bytes = 0
+        self.__counts = open(self.file_path, "w")
+        self.__counts.write("qname,rname,count\n")
+        self.__closed = False
+
+    def write_bit_vector(
+        self, q_name: str, bit_vector: dict[int, str], reads: list[Any]
+    ) -> None:
+        """Count a bit vector in its group.
+
+        Args:
+            q_name: Query name
+            bit_vector: Bit vector dictionary or DenseBitVector
+            reads: List of reads; the first read's rname is part of the group
+        """
+        key = (reads[0].rname, _content_key(bit_vector))
+        group = self.__groups.get(key)
+        if group is not None:
+            group[3] += 1
+            return
+        metadata = [_ReadMetadata(read) for read in reads]
+        self.__groups[key] = [q_name, bit_vector, metadata, 1]
+        self.__bytes += _group_bytes(q_name, key, metadata)
+        if len(self.__groups) >= self.max_groups or self.__bytes >= self.max_bytes:
+            self.__flush()
+            self.flushes += 1
+
+    def __flush(self) -> None:
+        """Write one bit vector per group and the group counts."""
+        for (rname, _), (q_name, bit_vector, reads, count) in self.__groups.items():
+            self.writer.write_bit_vector(q_name, bit_vector, reads)
+            self.__counts.write(f"{q_name},{rname},{count}\n")
+        self.__groups.clear()
+        self.__bytes = 0
+
+    def close(self) -> None:
+        """Flush the remaining groups and close the wrapped writer."""
+        if self.__closed:
+            return
+        self.__closed = True
+        self.__flush()
+        self.__counts.close()
+        self.writer.close()
+
+
 def create_storage_writer(
     format_type: StorageFormat,
     path: Path,
@@ -180,6 +458,9 @@ def create_storage_writer(
     data_type: str = "DMS",
     start: int = 1,
     end: int = 1,
+    references: list[str] | None = None,
+    ref_seqs: dict[str, str] | None = None,
+    collapse: bool = False,
 ) -> BitVectorStorageWriter:
     """Create a storage writer for the specified format.
 
@@ -191,14 +472,32 @@ def create_storage_writer(
         data_type: Type of data (required for TEXT format)
         start: Start position (required for TEXT format)
         end: End position (required for TEXT format)
+        references: Reference names (required for COLUMNAR format)
+        ref_seqs: Reference sequences; with TEXT format, returns one
+            TextWriterPool for all of them instead of a single-reference writer
+        collapse: Wrap the writer in a CollapsingWriter, so reads with the
+            same bit vector are written once with a count (once per flush
+            of its bounded group table)
 
     Returns:
         BitVectorStorageWriter instance
     """
+    if collapse:
+        writer = create_storage_writer(
+            format_type, path, name, sequence, data_type, start, end,
+            references, ref_seqs,
+        )
+        return CollapsingWriter(writer, path)
     if format_type == StorageFormat.TEXT:
+        if ref_seqs is not None:
+            return TextWriterPool(path, ref_seqs, data_type)
         return TextStorageWriter(path, name, sequence, data_type, start, end)
     elif format_type == StorageFormat.JSON:
         return JsonStorageWriter(path)
+    elif format_type == StorageFormat.COLUMNAR:
+        from rna_map.io.columnar_storage import ColumnarStorageWriter
+
+        return ColumnarStorageWriter(path, references or [])
     else:
         raise ValueError(f"Unknown storage format: {format_type}")
 
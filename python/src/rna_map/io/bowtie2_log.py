@@ -0,0 +1,60 @@
+"""Parse the alignment summary bowtie2 prints to stderr."""
+
+import re
+
+# (key, pattern) pairs; patterns with two groups also store a "_percent" value
+_SUMMARY_PATTERNS = [
+    ("total_reads", r"(\d+) reads; of these:"),
+    ("unaligned", r"(\d+) \(([\d.]+)%\) aligned 0 times"),
+    ("unique", r"(\d+) \(([\d.]+)%\) aligned exactly 1 time"),
+    ("multiple", r"(\d+) \(([\d.]+)%\) aligned >1 times"),
+]
+_PAIRED_PATTERNS = [
+    ("concordant_0", r"(\d+) \(([\d.]+)%\) aligned concordantly 0 times"),
+    ("concordant_1", r"(\d+) \(([\d.]+)%\) aligned concordantly exactly 1 time"),
+    ("concordant_multiple", r"(\d+) \(([\d.]+)%\) aligned concordantly >1 times"),
+    ("discordant", r"(\d+) \(([\d.]+)%\) aligned discordantly 1 time"),
+]
+# Output keys, matching the alignment_stats.json written by BOWTIE2_ALIGN
+_KEYS = {
+    "unaligned": ("unaligned_count", "unaligned_percent"),
+    "unique": ("unique_alignments", "unique_percent"),
+    "multiple": ("multiple_alignments", "multiple_percent"),
+    "concordant_0": ("concordant_0_times", "concordant_0_percent"),
+    "concordant_1": ("concordant_1_time", "concordant_1_percent"),
+    "concordant_multiple": ("concordant_multiple", "concordant_multiple_percent"),
+    "discordant": ("discordant_alignments", "discordant_percent"),
+}
+
+
+def parse_bowtie2_log(text: str, is_paired: bool) -> dict:
+    """Parse bowtie2's alignment summary.
+
+    Args:
+        text: bowtie2 stderr output
+        is_paired: Whether the reads are paired-end
+
+    Returns:
+        Alignment statistics, with the same keys as alignment_stats.json
+    """
+    stats: dict = {}
+    patterns = _SUMMARY_PATTERNS + (_PAIRED_PATTERNS if is_paired else [])
+    for name, pattern in patterns:
+        match = re.search(pattern, text)
+        if not match:
+            continue
+        if name == "total_reads":
+            stats["total_reads"] = int(match.group(1))
+            continue
+        count_key, percent_key = _KEYS[name]
+        stats[count_key] = int(match.group(1))
+        stats[percent_key] = float(match.group(2))
+    overall = re.search(r"([\d.]+)% overall alignment rate", text)
+    if overall:
+        stats["overall_alignment_rate"] = float(overall.group(1))
+    if "total_reads" in stats and "unaligned_count" in stats:
+        total = stats["total_reads"]
+        stats["aligned_count"] = total - stats["unaligned_count"]
+        if total > 0:
+            stats["aligned_percent"] = stats["aligned_count"] / total * 100
+    return stats
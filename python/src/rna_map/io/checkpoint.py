@@ -0,0 +1,121 @@
+"""Checkpoints of bit vector generation.
+
+A checkpoint holds the mutation histograms after the first ``records``
+SAM records (reads or mate pairs) of a file. A rerun with resume enabled
+loads the histograms and continues with the next record, so a preempted
+job only redoes the records since its last checkpoint.
+
+The histograms of each checkpoint go to a file named by its record count,
+and the JSON file naming that histogram file and the record count is
+renamed into place last. A job killed at any point leaves a JSON file that
+matches its histograms, and older histogram files are only removed once the
+new JSON file is in place.
+"""
+
+import json
+import os
+from pathlib import Path
+import re
+
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.io.histogram_binary import read_histogram_file, write_histogram_file
+from rna_map.logger import get_logger
+
+log = get_logger("IO.CHECKPOINT")
+
+CHECKPOINT_FILE_NAME = "bit_vector_checkpoint.json"
+# Histograms of the checkpoint after N records: bit_vector_checkpoint.N.rmh
+CHECKPOINT_HISTO_PATTERN = re.compile(r"^bit_vector_checkpoint\.\d+\.rmh$")
+
+
+def _histo_file_name(records: int) -> str:
+    return f"bit_vector_checkpoint.{records}.rmh"
+
+
+def _remove_histo_files(out_dir: Path, keep: str | None = None) -> None:
+    for path in out_dir.iterdir():
+        if CHECKPOINT_HISTO_PATTERN.match(path.name) and path.name != keep:
+            path.unlink(missing_ok=True)
+
+
+def get_sam_signature(sam_path: Path | str) -> dict | None:
+    """Identify a SAM file for matching checkpoints against it.
+
+    Args:
+        sam_path: Path to SAM or BAM file
+
+    Returns:
+        Resolved path and size, or None if the input is not a regular file
+        (e.g. a pipe) and cannot be resumed
+    """
+    path = Path(sam_path)
+    if not path.is_file():
+        return None
+    return {"sam": str(path.resolve()), "size": path.stat().st_size}
+
+
+def write_checkpoint(
+    out_dir: Path | str,
+    mut_histos: dict[str, MutationHistogram],
+    signature: dict,
+    records: int,
+) -> None:
+    """Write a checkpoint, replacing the previous one.
+
+    Args:
+        out_dir: Output directory
+        mut_histos: Histograms of the first records SAM records
+        signature: SAM signature from get_sam_signature
+        records: Number of SAM records in the histograms
+    """
+    out_dir = Path(out_dir)
+    histo_name = _histo_file_name(records)
+    write_histogram_file(mut_histos, str(out_dir / histo_name))
+    json_path = out_dir / CHECKPOINT_FILE_NAME
+    tmp_json_path = json_path.with_name(json_path.name + ".tmp")
+    with open(tmp_json_path, "w") as f:
+        json.dump({**signature, "records": records, "histograms": histo_name}, f)
+    os.replace(tmp_json_path, json_path)
+    _remove_histo_files(out_dir, keep=histo_name)
+
+
+def read_checkpoint(
+    out_dir: Path | str, signature: dict
+) -> tuple[dict[str, MutationHistogram], int] | None:
+    """Read the checkpoint of a SAM file.
+
+    Args:
+        out_dir: Output directory
+        signature: SAM signature from get_sam_signature
+
+    Returns:
+        Histograms and the number of SAM records they hold, or None if there
+        is no checkpoint for this SAM file
+    """
+    out_dir = Path(out_dir)
+    json_path = out_dir / CHECKPOINT_FILE_NAME
+    if not json_path.is_file():
+        return None
+    with open(json_path) as f:
+        checkpoint = json.load(f)
+    records = checkpoint.pop("records")
+    histo_name = checkpoint.pop("histograms")
+    if checkpoint != signature:
+        log.warning(
+            f"checkpoint in {out_dir} is for {checkpoint.get('sam')}, not "
+            f"{signature['sam']}; starting from the first read"
+        )
+        return None
+    return read_histogram_file(str(out_dir / histo_name)), records
+
+
+def remove_checkpoint(out_dir: Path | str) -> None:
+    """Remove the checkpoint files of a finished run.
+
+    Args:
+        out_dir: Output directory
+    """
+    out_dir = Path(out_dir)
+    (out_dir / CHECKPOINT_FILE_NAME).unlink(missing_ok=True)
+    if out_dir.is_dir():
+        _remove_histo_files(out_dir)
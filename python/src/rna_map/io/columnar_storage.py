@@ -0,0 +1,456 @@
+"""Chunked columnar binary bit vector store.
+
+File layout (all integers little-endian)::
+
+    "RMBV" uint32 version
+    chunk 0 .. chunk k-1
+    footer (JSON: references, chunk offsets, per-reference index)
+    uint64 footer_offset  uint32 footer_length  "RMBV"
+
+Each chunk holds up to ``chunk_size`` reads as a row group of columns:
+per-read rname id, mapq of both mates, read lengths and a CSR block of
+sparse positions (mutations, deletions, ambiguous bases) with their
+symbols, plus the read names. Every column starts on an 8-byte boundary,
+so a reader can map the file and view each column as a numpy array
+without copying. Chunk files of one sample can be concatenated by
+appending their row groups and rewriting the footer.
+"""
+
+from array import array
+from dataclasses import dataclass
+import json
+import mmap
+from pathlib import Path
+import struct
+from typing import Any, Iterator
+
+import numpy as np
+
+from rna_map.io.bit_vector_storage import BitVectorStorageWriter
+from rna_map.logger import get_logger
+
+log = get_logger("IO.COLUMNAR_STORAGE")
+
+MAGIC = b"RMBV"
+CHUNK_MAGIC = b"RMCK"
+VERSION = 1
+DEFAULT_CHUNK_SIZE = 65536
+COLUMNAR_FILE_NAME = "columnar_bitvectors.rmbv"
+
+_FILE_HEADER = struct.Struct("<4sI")
+_CHUNK_HEADER = struct.Struct("<4sIQQ")
+_TRAILER = struct.Struct("<QI4s")
+_ALIGN = 8
+
+# (column name, dtype, length) where length is in terms of the chunk header
+CHUNK_COLUMNS = [
+    ("rname_id", "<u4", "n_reads"),
+    ("mapq1", "u1", "n_reads"),
+    ("mapq2", "u1", "n_reads"),
+    ("read_len1", "<u4", "n_reads"),
+    ("read_len2", "<u4", "n_reads"),
+    ("offsets", "<u8", "n_reads+1"),
+    ("positions", "<u4", "n_entries"),
+    ("symbols", "u1", "n_entries"),
+    ("qname_offsets", "<u8", "n_reads+1"),
+    ("qnames", "u1", "qname_bytes"),
+]
+
+# Symbols kept in the sparse block, matching the JSON format
+_STORED_SYMBOLS = ("A", "C", "G", "T", "1", "?")
+
+
+def _column_length(key: str, n_reads: int, n_entries: int, qname_bytes: int) -> int:
+    """Get the number of elements of a chunk column."""
+    return {
+        "n_reads": n_reads,
+        "n_reads+1": n_reads + 1,
+        "n_entries": n_entries,
+        "qname_bytes": qname_bytes,
+    }[key]
+
+
+def _padding(size: int) -> bytes:
+    """Get the zero padding that aligns size to the column boundary."""
+    return b"\0" * (-size % _ALIGN)
+
+
+def encode_chunk(columns: dict[str, np.ndarray]) -> bytes:
+    """Encode the columns of one row group.
+
+    Args:
+        columns: Column arrays by name (see CHUNK_COLUMNS)
+
+    Returns:
+        Encoded chunk bytes
+    """
+    n_reads = len(columns["rname_id"])
+    parts = [
+        _CHUNK_HEADER.pack(
+            CHUNK_MAGIC, n_reads, len(columns["positions"]), len(columns["qnames"])
+        )
+    ]
+    size = _CHUNK_HEADER.size
+    parts.append(_padding(size))
+    size += len(parts[-1])
+    for name, dtype, _ in CHUNK_COLUMNS:
+        data = np.ascontiguousarray(columns[name], dtype=dtype).tobytes()
+        parts.append(data)
+        parts.append(_padding(len(data)))
+        size += len(data) + len(parts[-1])
+    return b"".join(parts)
+
+
+def decode_chunk(buffer: Any, offset: int) -> dict[str, np.ndarray]:
+    """View the columns of one row group without copying.
+
+    Args:
+        buffer: Object supporting the buffer protocol (e.g. an mmap)
+        offset: Byte offset of the chunk
+
+    Returns:
+        Column arrays by name
+
+    Raises:
+        ValueError: If the chunk header is corrupt
+    """
+    magic, n_reads, n_entries, qname_bytes = _CHUNK_HEADER.unpack_from(buffer, offset)
+    if magic != CHUNK_MAGIC:
+        raise ValueError(f"corrupt columnar chunk at offset {offset}")
+    pos = offset + _CHUNK_HEADER.size
+    pos += -pos % _ALIGN
+    columns = {}
+    for name, dtype, key in CHUNK_COLUMNS:
+        count = _column_length(key, n_reads, n_entries, qname_bytes)
+        columns[name] = np.frombuffer(buffer, dtype=dtype, count=count, offset=pos)
+        pos += count * np.dtype(dtype).itemsize
+        pos += -pos % _ALIGN
+    return columns
+
+
+def _chunk_info(offset: int, size: int, columns: dict[str, np.ndarray], num_refs: int):
+    """Build the footer entry of a chunk."""
+    counts = np.bincount(columns["rname_id"], minlength=num_refs)
+    return {
+        "offset": offset,
+        "size": size,
+        "n_reads": int(len(columns["rname_id"])),
+        "n_entries": int(len(columns["positions"])),
+        "reads_per_reference": {
+            str(ref_id): int(count) for ref_id, count in enumerate(counts) if count
+        },
+    }
+
+
+class _ColumnarFile:
+    """Append row groups to a columnar file and write its footer."""
+
+    def __init__(self, path: Path, references: list[str]) -> None:
+        self.references = list(references)
+        self.chunks: list[dict] = []
+        self.f = open(path, "wb")
+        self.f.write(_FILE_HEADER.pack(MAGIC, VERSION))
+        self.f.write(_padding(_FILE_HEADER.size))
+
+    def append_chunk(self, data: bytes, columns: dict[str, np.ndarray]) -> None:
+        offset = self.f.tell()
+        self.f.write(data)
+        self.chunks.append(
+            _chunk_info(offset, len(data), columns, len(self.references))
+        )
+
+    def close(self) -> None:
+        reference_index: dict[str, list[list[int]]] = {}
+        for chunk_id, chunk in enumerate(self.chunks):
+            for ref_id, count in chunk["reads_per_reference"].items():
+                name = self.references[int(ref_id)]
+                reference_index.setdefault(name, []).append([chunk_id, count])
+        footer = json.dumps(
+            {
+                "version": VERSION,
+                "references": self.references,
+                "chunks": self.chunks,
+                "reference_index": reference_index,
+            }
+        ).encode()
+        footer_offset = self.f.tell()
+        self.f.write(footer)
+        self.f.write(_TRAILER.pack(footer_offset, len(footer), MAGIC))
+        self.f.close()
+
+
+class ColumnarStorageWriter(BitVectorStorageWriter):
+    """Columnar binary storage writer (one file for all references)."""
+
+    def __init__(
+        self,
+        path: Path,
+        references: list[str],
+        chunk_size: int = DEFAULT_CHUNK_SIZE,
+    ) -> None:
+        """Initialize columnar storage writer.
+
+        Args:
+            path: Output directory path
+            references: Reference names, in FASTA order
+            chunk_size: Number of reads per row group
+        """
+        self.file_path = path / COLUMNAR_FILE_NAME
+        self.chunk_size = chunk_size
+        self._ref_ids = {name: i for i, name in enumerate(references)}
+        self._file = _ColumnarFile(self.file_path, references)
+        self._reset()
+
+    def _reset(self) -> None:
+        """Start a new row group."""
+        self._rname_id = array("I")
+        self._mapq1 = bytearray()
+        self._mapq2 = bytearray()
+        self._read_len1 = array("I")
+        self._read_len2 = array("I")
+        self._offsets = array("Q", [0])
+        self._positions = array("I")
+        self._symbols = bytearray()
+        self._qname_offsets = array("Q", [0])
+        self._qnames = bytearray()
+
+    def write_bit_vector(
+        self, q_name: str, bit_vector: dict[int, str], reads: list[Any]
+    ) -> None:
+        """Write bit vector in columnar format.
+
+        Args:
+            q_name: Query name
+            bit_vector: Bit vector dictionary or DenseBitVector
+            reads: List of aligned reads (for metadata)
+        """
+        # Lazy import to avoid circular dependency (core.config imports storage)
+        from rna_map.core import dense_bit_vector as dense
+
+        read1 = reads[0]
+        read2 = reads[1] if len(reads) > 1 else None
+        self._rname_id.append(self._ref_ids[read1.rname])
+        self._mapq1.append(min(read1.mapq, 255))
+        self._mapq2.append(min(read2.mapq, 255) if read2 else 0)
+        self._read_len1.append(len(read1.seq))
+        self._read_len2.append(len(read2.seq) if read2 else 0)
+        if isinstance(bit_vector, dense.DenseBitVector):
+            codes = bit_vector.codes
+            keep = np.flatnonzero(
+                dense.is_mutation(codes) | (codes == dense.DEL) | (codes == dense.AMBIG)
+            )
+            self._positions.extend((keep + bit_vector.start).tolist())
+            self._symbols += dense.DECODE_TABLE[codes[keep]].tobytes()
+        else:
+            for pos in sorted(bit_vector):
+                bit = bit_vector[pos]
+                if bit in _STORED_SYMBOLS:
+                    self._positions.append(pos)
+                    self._symbols += bit.encode()
+        self._offsets.append(len(self._positions))
+        self._qnames += q_name.encode()
+        self._qname_offsets.append(len(self._qnames))
+        if len(self._rname_id) >= self.chunk_size:
+            self._flush()
+
+    def _flush(self) -> None:
+        """Write the current row group."""
+        if not self._rname_id:
+            return
+        columns = {
+            "rname_id": np.frombuffer(self._rname_id, dtype=np.uint32),
+            "mapq1": np.frombuffer(self._mapq1, dtype=np.uint8),
+            "mapq2": np.frombuffer(self._mapq2, dtype=np.uint8),
+            "read_len1": np.frombuffer(self._read_len1, dtype=np.uint32),
+            "read_len2": np.frombuffer(self._read_len2, dtype=np.uint32),
+            "offsets": np.frombuffer(self._offsets, dtype=np.uint64),
+            "positions": np.array(self._positions, dtype=np.uint32),
+            "symbols": np.array(self._symbols, dtype=np.uint8),
+            "qname_offsets": np.frombuffer(self._qname_offsets, dtype=np.uint64),
+            "qnames": np.array(self._qnames, dtype=np.uint8),
+        }
+        self._file.append_chunk(encode_chunk(columns), columns)
+        self._reset()
+
+    def close(self) -> None:
+        """Flush the last row group and write the footer."""
+        if self._file is None:
+            return
+        self._flush()
+        self._file.close()
+        self._file = None
+
+
+@dataclass(frozen=True)
+class ColumnarRecord:
+    """One bit vector read back from a columnar file.
+
+    Attributes:
+        qname: Query name
+        rname: Reference name
+        mapq1: Mapping quality of mate 1
+        mapq2: Mapping quality of mate 2 (0 for single-end)
+        read_len1: Length of mate 1
+        read_len2: Length of mate 2 (0 for single-end)
+        data: Stored positions (mutations, deletions, ambiguous) and symbols
+    """
+
+    qname: str
+    rname: str
+    mapq1: int
+    mapq2: int
+    read_len1: int
+    read_len2: int
+    data: dict[int, str]
+
+
+class ColumnarBitVectorReader:
+    """Memory-mapped reader for columnar bit vector files."""
+
+    def __init__(self, path: Path | str) -> None:
+        """Open a columnar bit vector file.
+
+        Args:
+            path: Path to the columnar file
+
+        Raises:
+            ValueError: If the file is not a columnar bit vector file
+        """
+        self.path = Path(path)
+        self._f = open(self.path, "rb")
+        self._mmap = mmap.mmap(self._f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version = _FILE_HEADER.unpack_from(self._mmap, 0)
+        footer_offset, footer_len, end_magic = _TRAILER.unpack_from(
+            self._mmap, len(self._mmap) - _TRAILER.size
+        )
+        if magic != MAGIC or end_magic != MAGIC:
+            raise ValueError(f"{self.path} is not a columnar bit vector file")
+        if version > VERSION:
+            raise ValueError(f"unsupported columnar bit vector version: {version}")
+        footer = json.loads(self._mmap[footer_offset : footer_offset + footer_len])
+        self.references: list[str] = footer["references"]
+        self.chunks: list[dict] = footer["chunks"]
+        self.reference_index: dict[str, list[list[int]]] = footer["reference_index"]
+
+    @property
+    def num_reads(self) -> int:
+        """Get the total number of reads in the file."""
+        return sum(chunk["n_reads"] for chunk in self.chunks)
+
+    def read_chunk(self, chunk_id: int) -> dict[str, np.ndarray]:
+        """Get the columns of a row group as zero-copy numpy views.
+
+        Args:
+            chunk_id: Index of the row group
+
+        Returns:
+            Column arrays by name
+        """
+        return decode_chunk(self._mmap, self.chunks[chunk_id]["offset"])
+
+    def raw_chunk(self, chunk_id: int) -> bytes:
+        """Get the encoded bytes of a row group.
+
+        Args:
+            chunk_id: Index of the row group
+
+        Returns:
+            Encoded chunk bytes
+        """
+        chunk = self.chunks[chunk_id]
+        return self._mmap[chunk["offset"] : chunk["offset"] + chunk["size"]]
+
+    def __iter__(self) -> Iterator[ColumnarRecord]:
+        """Iterate over all records in file order."""
+        for chunk_id in range(len(self.chunks)):
+            yield from self._iter_chunk(chunk_id)
+
+    def iter_reference(self, name: str) -> Iterator[ColumnarRecord]:
+        """Iterate over the records of one reference, skipping other chunks.
+
+        Args:
+            name: Reference name
+
+        Yields:
+            Records aligned to the reference
+        """
+        if name not in self.references:
+            return
+        ref_id = self.references.index(name)
+        for chunk_id, _ in self.reference_index.get(name, []):
+            yield from self._iter_chunk(chunk_id, ref_id)
+
+    def _iter_chunk(
+        self, chunk_id: int, ref_id: int | None = None
+    ) -> Iterator[ColumnarRecord]:
+        """Iterate over the records of one row group."""
+        cols = self.read_chunk(chunk_id)
+        rows = range(len(cols["rname_id"]))
+        if ref_id is not None:
+            rows = np.flatnonzero(cols["rname_id"] == ref_id).tolist()
+        for row in rows:
+            start, end = int(cols["offsets"][row]), int(cols["offsets"][row + 1])
+            q_start = int(cols["qname_offsets"][row])
+            q_end = int(cols["qname_offsets"][row + 1])
+            symbols = cols["symbols"][start:end].tobytes().decode()
+            yield ColumnarRecord(
+                qname=cols["qnames"][q_start:q_end].tobytes().decode(),
+                rname=self.references[int(cols["rname_id"][row])],
+                mapq1=int(cols["mapq1"][row]),
+                mapq2=int(cols["mapq2"][row]),
+                read_len1=int(cols["read_len1"][row]),
+                read_len2=int(cols["read_len2"][row]),
+                data=dict(zip(cols["positions"][start:end].tolist(), symbols)),
+            )
+
+    def close(self) -> None:
+        """Close the file mapping."""
+        try:
+            self._mmap.close()
+        except BufferError:
+            # numpy views handed out by read_chunk still reference the map
+            pass
+        self._f.close()
+
+    def __enter__(self):
+        """Context manager entry."""
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        """Context manager exit."""
+        self.close()
+
+
+def concatenate_columnar_files(paths: list[Path | str], output: Path | str) -> None:
+    """Concatenate columnar files by appending their row groups.
+
+    Row groups are copied verbatim when a file uses the same reference
+    list as the output; otherwise only the rname id column is remapped.
+
+    Args:
+        paths: Columnar files, in the order their reads should appear
+        output: Output file path
+    """
+    readers = [ColumnarBitVectorReader(path) for path in paths]
+    references: list[str] = []
+    for reader in readers:
+        references.extend(name for name in reader.references if name not in references)
+    out = _ColumnarFile(Path(output), references)
+    try:
+        for reader in readers:
+            remap = np.array(
+                [references.index(name) for name in reader.references], dtype=np.uint32
+            )
+            identity = reader.references == references
+            for chunk_id in range(len(reader.chunks)):
+                columns = reader.read_chunk(chunk_id)
+                if identity:
+                    out.append_chunk(reader.raw_chunk(chunk_id), columns)
+                    continue
+                columns = dict(columns)
+                columns["rname_id"] = remap[columns["rname_id"]]
+                out.append_chunk(encode_chunk(columns), columns)
+    finally:
+        out.close()
+        for reader in readers:
+            reader.close()
@@ -12,21 +12,23 @@ log = get_logger("IO.FASTA")
 def fasta_to_dict(fasta_file: str | Path) -> dict[str, str]:
     """Parse a FASTA file into a dictionary.
 
+    The file is streamed and the lines of each sequence are joined once, so
+    large multi-line references load in linear time.
+
     Args:
         fasta_file: Path to FASTA file
 
     Returns:
         Dictionary mapping sequence names to sequences
     """
-    refs_seq: dict[str, str] = {}
+    chunks: dict[str, list[str]] = {}
     with open(fasta_file) as handle:
-        for line in handle.readlines():
+        for line in handle:
             if line[0] == ">":
-                ref_name = line[1:].strip()
-                refs_seq[ref_name] = ""
+                lines = chunks[line[1:].strip()] = []
             else:
-                refs_seq[ref_name] += line.strip()
-    return refs_seq
+                lines.append(line.strip())
+    return {name: "".join(lines) for name, lines in chunks.items()}
 
 
 def validate_fasta_file(fa: str | Path) -> bool:
@@ -43,11 +45,6 @@ def validate_fasta_file(fa: str | Path) -> bool:
     """
     with open(fa, encoding="utf8") as f:
         lines = f.readlines()
-    if len(lines) > 2000:
-        log.warning(
-            "fasta file contains more than 1000 sequences, this may lead"
-            " to file generation issues. Its recommended to use --summary-output-only "
-        )
     num = 0
     for i, line in enumerate(lines):
         line = line.rstrip()
@@ -0,0 +1,380 @@
+"""Split FASTQ files into chunks of whole records.
+
+Input is read in large binary blocks and cut on record boundaries, so no
+per-line Python work is done. Gzipped files are decompressed and chunks
+compressed with pigz when it is installed (multithreaded compression), and
+with the gzip module otherwise. Paired files are read in lockstep, so chunk N
+of R1 and R2 always hold the same reads::
+
+    python -m rna_map.io.fastq_splitter --fastq1 r1.fq.gz --fastq2 r2.fq.gz \\
+        --chunk-size 1000000 --output-dir chunks --threads 4
+
+With ``--chunk-size auto`` the chunk size is derived from the number of reads
+(estimated from the file size), the executors available to run chunks and a
+target runtime per chunk task; see adaptive_chunk_size.
+"""
+
+import argparse
+import gzip
+from pathlib import Path
+import shutil
+import subprocess
+from typing import BinaryIO
+
+from rna_map.logger import get_logger
+
+log = get_logger("IO.FASTQ_SPLITTER")
+
+BLOCK_SIZE = 4 * 2**20
+# Records moved per read/write call; bounds memory independently of chunk size
+BATCH_RECORDS = 65536
+# Intermediate chunks are read once by the aligner, so favour speed
+DEFAULT_COMPRESS_LEVEL = 1
+# Uncompressed bytes read from the start of a file to estimate its reads
+ESTIMATE_SAMPLE_BYTES = 4 * 2**20
+# Adaptive chunking: target runtime of a chunk task, and the reads per second a
+# task aligns and turns into bit vectors
+DEFAULT_TARGET_SECONDS = 600
+DEFAULT_READS_PER_SECOND = 20000
+# Adaptive chunks are never smaller, so small samples are not split up
+DEFAULT_MIN_CHUNK_SIZE = 250000
+
+
+def _has_pigz() -> bool:
+    return shutil.which("pigz") is not None
+
+
+class _Decompressor:
+    """Binary stream of a (possibly gzipped) FASTQ file."""
+
+    def __init__(self, path: Path) -> None:
+        self.__proc = None
+        if path.suffix != ".gz":
+            self.stream: BinaryIO = open(path, "rb")
+        elif _has_pigz():
+            # pigz reads, decompresses and checksums on separate threads
+            self.__proc = subprocess.Popen(
+                ["pigz", "-dc", str(path)], stdout=subprocess.PIPE, bufsize=BLOCK_SIZE
+            )
+            self.stream = self.__proc.stdout
+        else:
+            self.stream = gzip.open(path, "rb")
+
+    def close(self) -> None:
+        self.stream.close()
+        if self.__proc is not None and self.__proc.wait() != 0:
+            raise RuntimeError(f"pigz exited with status {self.__proc.returncode}")
+
+
+class _Compressor:
+    """Binary sink of a chunk file, gzipped when the path ends in .gz."""
+
+    def __init__(self, path: Path, level: int, threads: int) -> None:
+        self.__proc = None
+        self.__file = None
+        if path.suffix != ".gz":
+            self.stream: BinaryIO = open(path, "wb")
+        elif _has_pigz():
+            self.__file = open(path, "wb")
+            self.__proc = subprocess.Popen(
+                ["pigz", f"-{level}", "-p", str(threads), "-c"],
+                stdin=subprocess.PIPE,
+                stdout=self.__file,
+                bufsize=BLOCK_SIZE,
+            )
+            self.stream = self.__proc.stdin
+        else:
+            self.stream = gzip.open(path, "wb", compresslevel=level)
+
+    def close(self) -> None:
+        self.stream.close()
+        if self.__proc is not None:
+            status = self.__proc.wait()
+            self.__file.close()
+            if status != 0:
+                raise RuntimeError(f"pigz exited with status {status}")
+
+
+class FastqRecordReader:
+    """Read whole FASTQ records from a binary stream in bulk."""
+
+    def __init__(self, stream: BinaryIO, block_size: int = BLOCK_SIZE) -> None:
+        """Initialize FastqRecordReader.
+
+        Args:
+            stream: Binary stream of uncompressed FASTQ
+            block_size: Bytes read from the stream at a time
+        """
+        self.__stream = stream
+        self.__block_size = block_size
+        # Complete lines not handed out yet, plus the trailing partial line
+        self.__lines: list[bytes] = []
+        self.__partial = b""
+        self.__eof = False
+
+    def __fill(self, num_lines: int) -> None:
+        while len(self.__lines) < num_lines and not self.__eof:
+            block = self.__stream.read(self.__block_size)
+            if not block:
+                self.__eof = True
+                if self.__partial:
+                    self.__lines.append(self.__partial)
+                    self.__partial = b""
+                break
+            lines = (self.__partial + block).split(b"\n")
+            self.__partial = lines.pop()
+            self.__lines.extend(lines)
+
+    def read_records(self, max_records: int) -> tuple[bytes, int]:
+        """Read up to max_records records.
+
+        Args:
+            max_records: Maximum number of records to return
+
+        Returns:
+            Newline-terminated records and the number of records
+
+        Raises:
+            ValueError: If the file is truncated or not FASTQ
+        """
+        self.__fill(max_records * 4)
+        available = len(self.__lines)
+        if self.__eof and available % 4:
+            # Tolerate blank trailing lines, nothing else
+            while self.__lines and not self.__lines[-1]:
+                self.__lines.pop()
+            available = len(self.__lines)
+            if available % 4:
+                raise ValueError("FASTQ file ends with an incomplete record")
+        num_records = min(max_records, available // 4)
+        if num_records == 0:
+            return b"", 0
+        if not self.__lines[0].startswith(b"@"):
+            raise ValueError(f"Expected a FASTQ header, got: {self.__lines[0][:50]!r}")
+        end = num_records * 4
+        data = b"\n".join(self.__lines[:end]) + b"\n"
+        del self.__lines[:end]
+        return data, num_records
+
+
+def chunk_path(output_dir: Path, chunk_num: int, mate: int | None, gz: bool) -> Path:
+    """Get the path of a chunk file.
+
+    Args:
+        output_dir: Directory of the chunks
+        chunk_num: Chunk number, starting at 0
+        mate: 1 or 2 for paired-end reads, None for single-end reads
+        gz: Whether the chunk is gzipped
+
+    Returns:
+        Path like chunks/chunk_0_1.fastq.gz
+    """
+    suffix = ".fastq.gz" if gz else ".fastq"
+    mate_part = f"_{mate}" if mate else ""
+    return output_dir / f"chunk_{chunk_num}{mate_part}{suffix}"
+
+
+def estimate_num_reads(path: Path) -> int:
+    """Estimate the number of reads of a FASTQ file from its size.
+
+    Reads the first ESTIMATE_SAMPLE_BYTES (uncompressed) and scales the
+    reads in them by the file size over the bytes they took on disk.
+
+    Args:
+        path: Path to a (possibly gzipped) FASTQ file
+
+    Returns:
+        Estimated number of reads, exact for files smaller than the sample
+    """
+    size = path.stat().st_size
+    if size == 0:
+        return 0
+    with open(path, "rb") as raw:
+        stream = gzip.GzipFile(fileobj=raw) if path.suffix == ".gz" else raw
+        sample = stream.read(ESTIMATE_SAMPLE_BYTES)
+        consumed = raw.tell()
+        exhausted = not stream.read(1)
+    num_lines = sample.count(b"\n") + (not sample.endswith(b"\n"))
+    if exhausted:
+        return num_lines // 4
+    return int(num_lines / 4 * size / consumed)
+
+
+def adaptive_chunk_size(
+    num_reads: int,
+    num_executors: int,
+    target_seconds: float = DEFAULT_TARGET_SECONDS,
+    reads_per_second: float = DEFAULT_READS_PER_SECOND,
+    min_chunk_size: int = DEFAULT_MIN_CHUNK_SIZE,
+) -> int:
+    """Get a chunk size that keeps every executor busy without stragglers.
+
+    A chunk holds at most the reads a task processes in target_seconds, and
+    at most an even share of the reads across the executors, so small inputs
+    still spread out. Chunks are never smaller than min_chunk_size.
+
+    Args:
+        num_reads: Reads in the input
+        num_executors: Tasks that can run at the same time
+        target_seconds: Target runtime of a chunk task
+        reads_per_second: Reads a chunk task processes per second
+        min_chunk_size: Smallest chunk size
+
+    Returns:
+        Reads per chunk
+    """
+    by_runtime = max(1, int(target_seconds * reads_per_second))
+    by_executors = -(-num_reads // max(1, num_executors))
+    return max(min(by_runtime, by_executors), min_chunk_size, 1)
+
+
+def split_fastq(
+    fastq1: Path,
+    output_dir: Path,
+    chunk_size: int,
+    fastq2: Path | None = None,
+    compress_level: int = DEFAULT_COMPRESS_LEVEL,
+    threads: int = 1,
+) -> int:
+    """Split FASTQ files into chunks of chunk_size reads.
+
+    Args:
+        fastq1: Path to R1 (or single-end) FASTQ file
+        output_dir: Directory to write chunks to
+        chunk_size: Reads per chunk
+        fastq2: Path to R2 FASTQ file for paired-end reads
+        compress_level: gzip level for chunks of gzipped input, 0 writes
+            uncompressed chunks
+        threads: Compression threads per chunk file (pigz only)
+
+    Returns:
+        Number of chunks written
+
+    Raises:
+        ValueError: If chunk_size is not positive, or R1 and R2 have a
+            different number of reads
+    """
+    if chunk_size <= 0:
+        raise ValueError(f"chunk_size must be positive, got {chunk_size}")
+    output_dir.mkdir(parents=True, exist_ok=True)
+    inputs = [fastq1] + ([fastq2] if fastq2 else [])
+    mates = [1, 2] if fastq2 else [None]
+    gz = [path.suffix == ".gz" and compress_level > 0 for path in inputs]
+    sources = [_Decompressor(path) for path in inputs]
+    readers = [FastqRecordReader(source.stream) for source in sources]
+    chunk_num = 0
+    try:
+        while True:
+            # Buffer the first batch so no empty trailing chunk is created
+            first = min(BATCH_RECORDS, chunk_size)
+            batches = [reader.read_records(first) for reader in readers]
+            _check_lockstep(batches)
+            if batches[0][1] == 0:
+                break
+            sinks = [
+                _Compressor(
+                    chunk_path(output_dir, chunk_num, mate, is_gz),
+                    compress_level,
+                    threads,
+                )
+                for mate, is_gz in zip(mates, gz)
+            ]
+            written = 0
+            try:
+                while batches[0][1]:
+                    for sink, (data, _) in zip(sinks, batches):
+                        sink.stream.write(data)
+                    written += batches[0][1]
+                    if written >= chunk_size:
+                        break
+                    batches = [
+                        reader.read_records(min(BATCH_RECORDS, chunk_size - written))
+                        for reader in readers
+                    ]
+                    _check_lockstep(batches)
+            finally:
+                for sink in sinks:
+                    sink.close()
+            chunk_num += 1
+            if written < chunk_size:
+                break
+    finally:
+        for source in sources:
+            source.close()
+    # At least one (empty) chunk keeps downstream channels well-formed
+    if chunk_num == 0:
+        for mate, is_gz in zip(mates, gz):
+            path = chunk_path(output_dir, 0, mate, is_gz)
+            _Compressor(path, compress_level, threads).close()
+        chunk_num = 1
+    log.info(f"Split {fastq1.name} into {chunk_num} chunks")
+    return chunk_num
+
+
+def _check_lockstep(batches: list[tuple[bytes, int]]) -> None:
+    if len(batches) > 1 and batches[0][1] != batches[1][1]:
+        raise ValueError("R1 and R2 FASTQ files have a different number of reads")
+
+
+def _chunk_size_arg(value: str) -> int | str:
+    return value if value == "auto" else int(value)
+
+
+def main(argv: list[str] | None = None) -> None:
+    """Split FASTQ files from the command line and write chunk_count.txt."""
+    parser = argparse.ArgumentParser(description="Split FASTQ files into chunks")
+    parser.add_argument("--fastq1", type=Path, required=True)
+    parser.add_argument("--fastq2", type=Path, default=None)
+    parser.add_argument(
+        "--chunk-size", type=_chunk_size_arg, required=True,
+        help="Reads per chunk, or 'auto' to size chunks from the input",
+    )
+    parser.add_argument("--output-dir", type=Path, default=Path("chunks"))
+    parser.add_argument(
+        "--compress-level", type=int, default=DEFAULT_COMPRESS_LEVEL,
+        help="gzip level of chunks (0 = uncompressed)",
+    )
+    parser.add_argument("--threads", type=int, default=1)
+    auto = parser.add_argument_group("adaptive chunking (--chunk-size auto)")
+    auto.add_argument(
+        "--executors", type=int, default=1,
+        help="Chunk tasks that can run at the same time",
+    )
+    auto.add_argument(
+        "--target-seconds", type=float, default=DEFAULT_TARGET_SECONDS,
+        help="Target runtime of a chunk task",
+    )
+    auto.add_argument(
+        "--reads-per-second", type=float, default=DEFAULT_READS_PER_SECOND,
+        help="Reads a chunk task processes per second",
+    )
+    auto.add_argument(
+        "--min-chunk-size", type=int, default=DEFAULT_MIN_CHUNK_SIZE,
+        help="Smallest chunk size",
+    )
+    args = parser.parse_args(argv)
+    chunk_size = args.chunk_size
+    if chunk_size == "auto":
+        num_reads = estimate_num_reads(args.fastq1)
+        chunk_size = adaptive_chunk_size(
+            num_reads,
+            args.executors,
+            target_seconds=args.target_seconds,
+            reads_per_second=args.reads_per_second,
+            min_chunk_size=args.min_chunk_size,
+        )
+        log.info(f"~{num_reads} reads, chunk size {chunk_size}")
+    num_chunks = split_fastq(
+        args.fastq1,
+        args.output_dir,
+        chunk_size,
+        fastq2=args.fastq2,
+        compress_level=args.compress_level,
+        threads=args.threads,
+    )
+    Path("chunk_count.txt").write_text(str(num_chunks))
+    print(f"Split into {num_chunks} chunks")
+
+
+if __name__ == "__main__":
+    main()
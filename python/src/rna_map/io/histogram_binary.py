@@ -0,0 +1,273 @@
+"""Compact binary mutation histogram files.
+
+File layout (all integers little-endian)::
+
+    "RMHG" uint32 version uint32 num_histograms uint64 index_offset
+    histogram 0 .. histogram n-1
+    name index
+
+Each histogram is a uint32-length-prefixed JSON header (name, sequence,
+structure, data_type, start, end, num_reads, num_aligned, skips, length),
+zero padding to an 8-byte boundary and a uint32 block of
+``len(COUNT_ROWS)`` rows of ``length`` counts. The name index at
+``index_offset`` is a JSON object mapping each histogram name to the file
+offset of its header, so single histograms can be looked up without
+reading the others.
+
+Files are memory mapped and the count blocks are handed to
+MutationHistogram.from_dict without copying, so loading costs a JSON header
+per histogram. The mapping is copy-on-write: loaded histograms can be
+updated in memory without changing the file.
+"""
+
+import json
+import mmap
+import os
+from pathlib import Path
+import struct
+from typing import BinaryIO, Iterable, Iterator
+
+import numpy as np
+
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.logger import get_logger
+
+log = get_logger("IO.HISTOGRAM_BINARY")
+
+MAGIC = b"RMHG"
+VERSION = 1
+HISTO_BINARY_FILE_NAME = "mutation_histos.rmh"
+
+# Rows of the count block, in file order; all but the first are the
+# MutationHistogram count block
+COUNT_ROWS = (
+    "num_of_mutations",
+    "mut_bases",
+    "info_bases",
+    "del_bases",
+    "ins_bases",
+    "cov_bases",
+    "mod_A",
+    "mod_C",
+    "mod_G",
+    "mod_T",
+)
+
+_MAGIC_VERSION = struct.Struct("<4sI")
+_FILE_HEADER = struct.Struct("<4sIIQ")
+_U32 = struct.Struct("<I")
+_COUNT_DTYPE = "<u4"
+_ALIGNMENT = 8
+_META_KEYS = (
+    "name",
+    "sequence",
+    "structure",
+    "data_type",
+    "start",
+    "end",
+    "num_reads",
+    "num_aligned",
+    "skips",
+)
+
+
+def _write_histogram(f: BinaryIO, mh: MutationHistogram) -> None:
+    length = len(mh.sequence) + 1
+    meta = {key: getattr(mh, key) for key in _META_KEYS}
+    meta["length"] = length
+    meta_bytes = json.dumps(meta).encode()
+    f.write(_U32.pack(len(meta_bytes)))
+    f.write(meta_bytes)
+    f.write(bytes(-f.tell() % _ALIGNMENT))
+    if not mh.allocated and not mh.num_aligned:
+        # Never hit: skip allocating counts only to write zeros
+        f.write(bytes(len(COUNT_ROWS) * length * 4))
+        return
+    if len(mh.num_of_mutations) != length:
+        raise ValueError(f"{mh.name}: histogram rows have different lengths")
+    f.write(np.asarray(mh.num_of_mutations, dtype=_COUNT_DTYPE).tobytes())
+    f.write(np.ascontiguousarray(mh.counts, dtype=_COUNT_DTYPE).tobytes())
+
+
+def write_histogram_file(
+    mut_histos: dict[str, MutationHistogram], path: Path | str
+) -> None:
+    """Write mutation histograms to a binary file.
+
+    The file is written next to path and then renamed over it, so histograms
+    still mapped from an older file at path stay valid.
+
+    Args:
+        mut_histos: Dictionary of mutation histograms
+        path: Output path
+    """
+    index = {}
+    tmp_path = Path(f"{path}.tmp")
+    with open(tmp_path, "wb") as f:
+        f.write(_FILE_HEADER.pack(MAGIC, VERSION, len(mut_histos), 0))
+        for name, mh in mut_histos.items():
+            index[name] = f.tell()
+            _write_histogram(f, mh)
+        index_offset = f.tell()
+        f.write(json.dumps(index).encode())
+        f.seek(0)
+        f.write(_FILE_HEADER.pack(MAGIC, VERSION, len(mut_histos), index_offset))
+    os.replace(tmp_path, path)
+
+
+class HistogramFile:
+    """Memory-mapped binary histogram file with lookup by name.
+
+    Attributes:
+        path: Path of the file
+        index: File offset of each histogram by name, in file order
+    """
+
+    def __init__(self, path: Path | str) -> None:
+        """Open a binary histogram file.
+
+        Args:
+            path: Path to a file written by write_histogram_file
+
+        Raises:
+            ValueError: If the file is not a mutation histogram file or truncated
+        """
+        self.path = Path(path)
+        with open(path, "rb") as f:
+            if not f.read(1):
+                raise ValueError(f"{path} is not a binary mutation histogram file")
+            # Copy-on-write, so arrays over the mapping are writable
+            self.__buffer = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_COPY)
+        _check_header(self.__buffer[: _MAGIC_VERSION.size], path)
+        if len(self.__buffer) < _FILE_HEADER.size:
+            raise ValueError("truncated mutation histogram file")
+        _, _, count, index_offset = _FILE_HEADER.unpack_from(self.__buffer)
+        try:
+            self.index: dict[str, int] = json.loads(self.__buffer[index_offset:])
+        except ValueError as e:
+            raise ValueError("truncated mutation histogram file") from e
+        if len(self.index) != count:
+            raise ValueError("truncated mutation histogram file")
+
+    def __len__(self) -> int:
+        return len(self.index)
+
+    def __contains__(self, name: str) -> bool:
+        return name in self.index
+
+    @property
+    def names(self) -> list[str]:
+        """Histogram names in file order."""
+        return list(self.index)
+
+    def get(self, name: str, copy: bool = False) -> MutationHistogram:
+        """Load one histogram.
+
+        Args:
+            name: Histogram name
+            copy: Copy the counts out of the file instead of viewing them
+
+        Returns:
+            MutationHistogram whose counts view the mapped file unless copied
+
+        Raises:
+            KeyError: If the file has no histogram of that name
+            ValueError: If the histogram is truncated
+        """
+        buffer = self.__buffer
+        offset = self.index[name]
+        (meta_len,) = _U32.unpack_from(buffer, offset)
+        start = offset + _U32.size
+        d = json.loads(buffer[start : start + meta_len])
+        length = d.pop("length")
+        data_offset = start + meta_len
+        data_offset += -data_offset % _ALIGNMENT
+        size = len(COUNT_ROWS) * length
+        if data_offset + size * 4 > len(buffer):
+            raise ValueError("truncated mutation histogram file")
+        rows = np.frombuffer(
+            buffer, dtype=_COUNT_DTYPE, count=size, offset=data_offset
+        ).reshape(len(COUNT_ROWS), length)
+        d["num_of_mutations"] = rows[0].tolist()
+        d["counts"] = rows[1:].copy() if copy else rows[1:]
+        return MutationHistogram.from_dict(d)
+
+    def __iter__(self) -> Iterator[MutationHistogram]:
+        for name in self.index:
+            yield self.get(name)
+
+
+def _check_header(header: bytes, path: Path | str) -> None:
+    if len(header) < _MAGIC_VERSION.size:
+        raise ValueError("truncated mutation histogram file")
+    magic, version = _MAGIC_VERSION.unpack(header)
+    if magic != MAGIC:
+        raise ValueError(f"{path} is not a binary mutation histogram file")
+    if version != VERSION:
+        raise ValueError(f"unsupported mutation histogram file version {version}")
+
+
+def iter_histogram_file(
+    path: Path | str, copy: bool = False
+) -> Iterator[MutationHistogram]:
+    """Read mutation histograms from a binary file one at a time.
+
+    Args:
+        path: Path to a file written by write_histogram_file
+        copy: Copy the counts out of the file instead of viewing them
+
+    Yields:
+        MutationHistogram objects in file order
+
+    Raises:
+        ValueError: If the file is not a mutation histogram file or truncated
+    """
+    histo_file = HistogramFile(path)
+    for name in histo_file.index:
+        yield histo_file.get(name, copy=copy)
+
+
+def read_histogram_file(path: Path | str) -> dict[str, MutationHistogram]:
+    """Read all mutation histograms of a binary file.
+
+    Args:
+        path: Path to a file written by write_histogram_file
+
+    Returns:
+        Dictionary of mutation histograms
+    """
+    return {mh.name: mh for mh in iter_histogram_file(path)}
+
+
+def merge_histogram_files(paths: Iterable[Path | str]) -> dict[str, MutationHistogram]:
+    """Sum the mutation histograms of several binary files.
+
+    The files are streamed, so memory use is the merged result plus one
+    histogram regardless of the number of files.
+
+    Args:
+        paths: Binary histogram files, e.g. one per chunk
+
+    Returns:
+        Merged dictionary of mutation histograms
+
+    Raises:
+        ValueError: If histograms of the same name cannot be merged
+    """
+    merged: dict[str, MutationHistogram] = {}
+    num_files = 0
+    for path in paths:
+        num_files += 1
+        histo_file = HistogramFile(path)
+        # New names are copied so the merged result keeps no file open
+        histos = (
+            histo_file.get(name, copy=name not in merged)
+            for name in histo_file.index
+        )
+        for mh in histos:
+            if mh.name in merged:
+                merged[mh.name].merge(mh)
+            else:
+                merged[mh.name] = mh
+    log.info(f"merged {len(merged)} mutation histograms from {num_files} files")
+    return merged
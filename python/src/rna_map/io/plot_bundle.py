@@ -0,0 +1,108 @@
+"""Population average data bundle and plot modes.
+
+pop_avg.json holds the per-reference population average arrays behind the
+pop_avg plots, so plots can be rendered after the run (see
+rna_map.visualization.plot_scheduler.render_bundle) instead of on the
+critical path. Plot modes:
+
+- ``all``: plot every reference with enough aligned reads (default)
+- ``top``: plot only the references with the most aligned reads
+- ``none``: write the bundle only, plots are rendered on demand
+"""
+
+from enum import Enum
+import json
+from pathlib import Path
+
+PLOT_BUNDLE_FILE_NAME = "pop_avg.json"
+# References plotted in TOP mode
+DEFAULT_PLOT_TOP_N = 100
+
+
+class PlotMode(str, Enum):
+    """Which references are plotted after bit vector generation."""
+
+    ALL = "all"
+    TOP = "top"
+    NONE = "none"
+
+    @classmethod
+    def parse(cls, value: str) -> "PlotMode":
+        """Parse a plot mode name, falling back to ALL.
+
+        Args:
+            value: Mode name (case-insensitive)
+
+        Returns:
+            PlotMode member
+        """
+        try:
+            return cls(value.lower())
+        except ValueError:
+            return cls.ALL
+
+
+def _null_nan(values: list[float]) -> list[float | None]:
+    """Replace NaN (positions without informative reads) with None."""
+    return [None if value != value else value for value in values]
+
+
+def get_bundle_entries(mut_histos) -> dict[str, dict]:
+    """Get the population average data of mutation histograms.
+
+    The averages of all histograms are computed at once with HistogramStats,
+    without allocating counts for references that never got a read. Their
+    mismatches and mismatch_del are None at every position, as are positions
+    without informative reads, so the bundle stays valid JSON.
+
+    Args:
+        mut_histos: MutationHistograms
+
+    Returns:
+        JSON-serializable dicts with start, end, sequence, structure,
+        num_aligned, mismatches and mismatch_del, by reference name
+    """
+    # Lazy import to avoid circular dependency (core.config imports this module)
+    from rna_map.analysis.statistics import HistogramStats
+
+    stats = HistogramStats(mut_histos)
+    entries = {}
+    for mh, mismatches, mismatch_del in zip(
+        stats.mut_histos, stats.pop_avg(inc_del=False), stats.pop_avg(inc_del=True)
+    ):
+        if mh.num_aligned == 0:
+            mismatches = mismatch_del = [None] * len(mismatches)
+        entries[mh.name] = {
+            "start": mh.start,
+            "end": mh.end,
+            "sequence": mh.sequence,
+            "structure": mh.structure,
+            "num_aligned": mh.num_aligned,
+            "mismatches": _null_nan(mismatches),
+            "mismatch_del": _null_nan(mismatch_del),
+        }
+    return entries
+
+
+def write_plot_bundle(entries: dict[str, dict], path: Path | str) -> None:
+    """Write population average data by reference name.
+
+    Args:
+        entries: Bundle entries (see get_bundle_entries) by reference name
+        path: Output JSON path
+    """
+    with open(path, "w") as f:
+        json.dump(entries, f, allow_nan=False)
+
+
+def read_plot_bundle(path: Path | str) -> dict[str, dict]:
+    """Read population average data written by write_plot_bundle.
+
+    Args:
+        path: Bundle JSON path
+
+    Returns:
+        Bundle entries by reference name
+    """
+    with open(path) as f:
+        return json.load(f)
@@ -0,0 +1,190 @@
+"""Log of reads rejected by the bit vector filters.
+
+Libraries dominated by low-MAPQ reads reject more reads than they accept,
+so the log must not cost more per read than the accepted path. Modes:
+
+- ``off``: no log file
+- ``counts``: only rejected_counts.csv with the number of rejects per
+  reference and reason, taken from the histogram skip counters
+- ``sampled``: every Nth rejected read is written to rejected_bvs.csv
+- ``full``: every rejected read is written to rejected_bvs.csv (default)
+
+In the two row modes, rows are collected in memory and handed to a
+background thread in large blocks. The thread writes them to the file,
+gzip-compressed if requested, while reads keep being processed. The other
+modes cost nothing per rejected read.
+"""
+
+from enum import Enum
+import gzip
+from pathlib import Path
+import queue
+import threading
+from typing import TextIO
+
+from rna_map.core.dense_bit_vector import get_bit_string
+
+REJECTED_LOG_FILE_NAME = "rejected_bvs.csv"
+REJECTED_COUNTS_FILE_NAME = "rejected_counts.csv"
+HEADER = "qname,rname,reason,read1,read2,bitvector\n"
+
+# Rows are handed to the writer thread in blocks of about this many bytes
+DEFAULT_BUFFER_BYTES = 8 * 1024 * 1024
+# Blocks waiting for the writer thread before the caller blocks
+QUEUE_DEPTH = 2
+DEFAULT_SAMPLE_EVERY = 100
+
+
+class RejectedLogMode(str, Enum):
+    """Rejected read log modes."""
+
+    OFF = "off"
+    COUNTS = "counts"
+    SAMPLED = "sampled"
+    FULL = "full"
+
+    @classmethod
+    def parse(cls, value: str) -> "RejectedLogMode":
+        """Parse a rejected log mode name, falling back to FULL.
+
+        Args:
+            value: Mode name (case-insensitive)
+
+        Returns:
+            RejectedLogMode member
+        """
+        try:
+            return cls(value.lower())
+        except ValueError:
+            return cls.FULL
+
+    @property
+    def writes_rows(self) -> bool:
+        """Whether rejected reads are written to rejected_bvs.csv."""
+        return self in (RejectedLogMode.SAMPLED, RejectedLogMode.FULL)
+
+
+def write_rejected_counts(skips: dict[str, dict[str, int]], path: Path | str) -> None:
+    """Write the number of rejected reads per reference and reason.
+
+    Args:
+        skips: Skip counters (MutationHistogram.skips) by reference name
+        path: Output CSV path
+    """
+    with open(path, "w") as f:
+        f.write("rname,reason,count\n")
+        for name, counts in skips.items():
+            for reason, count in counts.items():
+                if count:
+                    f.write(f"{name},{reason},{count}\n")
+
+
+class RejectedLog:
+    """Writes rejected reads to rejected_bvs.csv in SAMPLED or FULL mode.
+
+    Attributes:
+        path: Path of the rejected read file
+        sample_every: One row is written per this many rejected reads
+        num_rejected: Number of rejected reads seen
+        num_written: Number of rejected reads written
+    """
+
+    def __init__(
+        self,
+        out_dir: Path | str,
+        sample_every: int = 1,
+        compress: bool = False,
+        buffer_bytes: int = DEFAULT_BUFFER_BYTES,
+    ) -> None:
+        """Initialize RejectedLog and open its output file.
+
+        Args:
+            out_dir: Output directory
+            sample_every: Write the first of every this many rejected reads
+                (1 writes all of them)
+            compress: Write rejected_bvs.csv.gz instead of rejected_bvs.csv
+            buffer_bytes: Size of the row blocks handed to the writer thread
+
+        Raises:
+            ValueError: If sample_every is smaller than 1
+        """
+        if sample_every < 1:
+            raise ValueError("sample_every must be at least 1")
+        self.sample_every = sample_every
+        self.num_rejected = 0
+        self.num_written = 0
+        self.__buffer_bytes = buffer_bytes
+        self.__rows: list[str] = []
+        self.__size = 0
+        self.__error: BaseException | None = None
+        self.__closed = False
+        name = REJECTED_LOG_FILE_NAME + (".gz" if compress else "")
+        self.path = Path(out_dir) / name
+        out: TextIO
+        if compress:
+            out = gzip.open(self.path, "wt", compresslevel=1)
+        else:
+            out = open(self.path, "w")
+        out.write(HEADER)
+        self.__blocks: queue.Queue = queue.Queue(maxsize=QUEUE_DEPTH)
+        self.__writer = threading.Thread(target=self.__write_blocks, args=(out,))
+        self.__writer.daemon = True
+        self.__writer.start()
+
+    def __write_blocks(self, out: TextIO) -> None:
+        try:
+            while True:
+                block = self.__blocks.get()
+                if block is None:
+                    break
+                if self.__error is None:
+                    out.write(block)
+        except BaseException as exc:  # re-raised by the caller
+            self.__error = exc
+        finally:
+            out.close()
+
+    def add(self, bit_vector, reason: str, start: int, end: int) -> None:
+        """Log a rejected bit vector.
+
+        Args:
+            bit_vector: Rejected BitVector
+            reason: Rejection reason
+            start: First reference position of the bit string (1-based)
+            end: Last reference position of the bit string (1-based)
+        """
+        index = self.num_rejected
+        self.num_rejected += 1
+        if index % self.sample_every:
+            return
+        read1 = bit_vector.reads[0]
+        read2_seq = bit_vector.reads[1].seq if len(bit_vector.reads) == 2 else ""
+        bit_string = get_bit_string(bit_vector.data, start, end)
+        row = (
+            f"{read1.qname},{read1.rname},{reason},{read1.seq},{read2_seq},"
+            f"{bit_string}\n"
+        )
+        self.__rows.append(row)
+        self.__size += len(row)
+        self.num_written += 1
+        if self.__size >= self.__buffer_bytes:
+            self.__flush()
+
+    def __flush(self) -> None:
+        if self.__error is not None:
+            raise self.__error
+        if self.__rows:
+            self.__blocks.put("".join(self.__rows))
+            self.__rows = []
+            self.__size = 0
+
+    def close(self) -> None:
+        """Write the remaining rows and close the file."""
+        if self.__closed:
+            return
+        self.__closed = True
+        self.__flush()
+        self.__blocks.put(None)
+        self.__writer.join()
+        if self.__error is not None:
+            raise self.__error
@@ -5,8 +5,9 @@ Supports two parsing backends:
 2. pysam (optional) - Faster, more robust SAM/BAM parsing using pysam library
 """
 
-from dataclasses import dataclass
-from typing import Optional
+from dataclasses import dataclass, field
+import itertools
+from typing import Iterator, Optional, TextIO
 
 from rna_map.logger import get_logger
 
@@ -37,6 +38,57 @@ class AlignedRead:
     seq: str
     qual: str
     md_string: str
+    # Packed CIGAR operations (rna_map.core.cigar) when read from BAM records
+    cigar_ops: Optional[tuple[int, ...]] = field(
+        default=None, compare=False, repr=False
+    )
+
+
+def _pysam_cigar_ops(pysam_read) -> tuple[int, ...]:
+    """Pack the binary CIGAR of a pysam read.
+
+    Args:
+        pysam_read: pysam AlignedSegment
+
+    Returns:
+        Packed CIGAR operations
+    """
+    # rna_map.core imports this module
+    from rna_map.core.cigar import pack_cigartuples
+
+    return pack_cigartuples(pysam_read.cigartuples)
+
+
+def skip_sam_header(handle: TextIO) -> Iterator[str]:
+    """Skip the header of an open SAM file.
+
+    Works on pipes as well as files, nothing is read twice.
+
+    Args:
+        handle: SAM file opened in text mode at its start
+
+    Returns:
+        Iterator over the lines from the first alignment record on
+    """
+    for line in handle:
+        if not line.startswith("@"):
+            return itertools.chain((line,), handle)
+    return iter(())
+
+
+def get_md_tag(fields: list[str]) -> str:
+    """Get the MD tag value from the optional SAM fields.
+
+    Args:
+        fields: Split SAM line
+
+    Returns:
+        MD string, or empty string if the read has no MD tag
+    """
+    for tag in fields[11:]:
+        if tag.startswith("MD:Z:"):
+            return tag[5:]
+    return ""
 
 
 def get_aligned_read_from_line(line: str) -> AlignedRead:
@@ -66,7 +118,7 @@ def get_aligned_read_from_line(line: str) -> AlignedRead:
         int(spl[8]),
         spl[9],
         spl[10],
-        spl[11].split(":")[2],
+        get_md_tag(spl),
     )
 
 
@@ -119,9 +171,7 @@ class SingleSamIterator:
             self._iter = iter(self._samfile)
         else:
             self._f = open(samfile_path)
-            ignore_lines = len(ref_seqs.keys()) + 2
-            for _ in range(ignore_lines):  # Ignore header lines
-                self._f.readline()
+            self._lines = skip_sam_header(self._f)
             self._read_1_line = ""
             self._read_1: AlignedRead | None = None
 
@@ -165,13 +215,14 @@ class SingleSamIterator:
                     seq=pysam_read.query_sequence or "",
                     qual=pysam_read.qual if pysam_read.qual else "",
                     md_string=md_string,
+                    cigar_ops=_pysam_cigar_ops(pysam_read),
                 )
                 return [aligned_read]
             except StopIteration:
                 self._samfile.close()
                 raise
         else:
-            self._read_1_line = self._f.readline().strip()
+            self._read_1_line = next(self._lines, "").strip()
             if len(self._read_1_line) == 0:
                 self._f.close()
                 raise StopIteration
@@ -221,9 +272,7 @@ class PairedSamIterator:
             self._pending_read: Optional[AlignedRead] = None
         else:
             self._f = open(samfile_path)
-            ignore_lines = len(ref_seqs.keys()) + 2
-            for _ in range(ignore_lines):  # Ignore header lines
-                self._f.readline()
+            self._lines = skip_sam_header(self._f)
             self._read_1_line = ""
             self._read_2_line = ""
             self._read_1: AlignedRead | None = None
@@ -276,6 +325,7 @@ class PairedSamIterator:
                         seq=pysam_read.query_sequence or "",
                         qual=pysam_read.qual if pysam_read.qual else "",
                         md_string=md_string,
+                        cigar_ops=_pysam_cigar_ops(pysam_read),
                     )
                     
                     # Check if this is the first or second read of a pair
@@ -317,46 +367,34 @@ class PairedSamIterator:
                     return reads
                 raise
         else:
-            self._read_1_line = self._f.readline().strip()
-            self._read_2_line = self._f.readline().strip()
+            self._read_1_line = next(self._lines, "").strip()
+            self._read_2_line = next(self._lines, "").strip()
             if len(self._read_1_line) == 0 or len(self._read_2_line) == 0:
                 self._f.close()
                 raise StopIteration
             self._read_1 = get_aligned_read_from_line(self._read_1_line)
             self._read_2 = get_aligned_read_from_line(self._read_2_line)
 
-            # check if reads are paired - use a loop to avoid infinite recursion
-            max_retries = 100  # Prevent infinite loops
-            retries = 0
-            while retries < max_retries:
-                retries += 1
-                # Check if reads are properly paired
-                if (
-                    self._read_1.pnext == self._read_2.pos
-                    and self._read_1.rname == self._read_2.rname
-                    and self._read_1.rnext == "="
-                    and self._read_1.qname == self._read_2.qname
-                    and self._read_1.mapq == self._read_2.mapq
-                ):
-                    # Reads are properly paired, break out of loop
-                    break
-                
-                # Reads are inconsistent, skip and try next pair
+            # Skip inconsistent pairs until a proper pair or the end of the
+            # file, as iter_sam_fields does for the parallel engine
+            while not (
+                self._read_1.pnext == self._read_2.pos
+                and self._read_1.rname == self._read_2.rname
+                and self._read_1.rnext == "="
+                and self._read_1.qname == self._read_2.qname
+                and self._read_1.mapq == self._read_2.mapq
+            ):
                 log.warning(
                     "mate_2 is inconsistent with mate_1 for read: "
                     f"{self._read_1.qname} SKIPPING!"
                 )
-                # Read next pair
-                self._read_1_line = self._f.readline().strip()
-                self._read_2_line = self._f.readline().strip()
+                self._read_1_line = next(self._lines, "").strip()
+                self._read_2_line = next(self._lines, "").strip()
                 if len(self._read_1_line) == 0 or len(self._read_2_line) == 0:
+                    self._f.close()
                     raise StopIteration
                 self._read_1 = get_aligned_read_from_line(self._read_1_line)
                 self._read_2 = get_aligned_read_from_line(self._read_2_line)
-            
-            if retries >= max_retries:
-                log.warning(f"Too many inconsistent read pairs, stopping iteration")
-                raise StopIteration
             return [self._read_1, self._read_2]
     
     def __del__(self):
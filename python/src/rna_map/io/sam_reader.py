@@ -0,0 +1,251 @@
+"""Lightweight SAM/BAM record streaming.
+
+Yields split SAM fields instead of ``AlignedRead`` objects so callers that
+hand reads straight to a compiled kernel never build an intermediate Python
+dataclass per read. Mate pairing follows the same rules as
+``PairedSamIterator``.
+"""
+
+from pathlib import Path
+from typing import Iterator, TextIO
+
+from rna_map.io.sam import PYSAM_AVAILABLE, AlignedRead, get_md_tag, pysam
+from rna_map.logger import get_logger
+
+log = get_logger("IO.SAM_READER")
+
+# SAM column indices
+QNAME, FLAG, RNAME, POS, MAPQ, CIGAR, RNEXT, PNEXT = 0, 1, 2, 3, 4, 5, 6, 7
+MIN_SAM_FIELDS = 11
+
+
+def is_header_line(line: str) -> bool:
+    """Check if a SAM line is a header line.
+
+    Args:
+        line: Line from a SAM file
+
+    Returns:
+        True if the line is part of the SAM header
+    """
+    return line.startswith("@")
+
+
+def is_proper_pair(fields_1: list[str], fields_2: list[str]) -> bool:
+    """Check if two SAM records are consistent mates.
+
+    Args:
+        fields_1: Split SAM line of mate 1
+        fields_2: Split SAM line of mate 2
+
+    Returns:
+        True if the records form a proper pair
+    """
+    return (
+        fields_1[PNEXT] == fields_2[POS]
+        and fields_1[RNAME] == fields_2[RNAME]
+        and fields_1[RNEXT] == "="
+        and fields_1[QNAME] == fields_2[QNAME]
+        and fields_1[MAPQ] == fields_2[MAPQ]
+    )
+
+
+def aligned_read_from_fields(fields: list[str]) -> AlignedRead:
+    """Build an AlignedRead from split SAM fields.
+
+    Args:
+        fields: Split SAM line
+
+    Returns:
+        AlignedRead object
+    """
+    return AlignedRead(
+        fields[QNAME],
+        fields[FLAG],
+        fields[RNAME],
+        int(fields[POS]),
+        int(fields[MAPQ]),
+        fields[CIGAR],
+        fields[RNEXT],
+        int(fields[PNEXT]),
+        int(fields[8]),
+        fields[9],
+        fields[10],
+        get_md_tag(fields),
+    )
+
+
+def _split_record(line: str) -> list[str]:
+    """Split a SAM alignment line into fields.
+
+    Args:
+        line: Alignment line from a SAM file
+
+    Returns:
+        Split SAM fields
+
+    Raises:
+        ValueError: If line doesn't have enough fields
+    """
+    fields = line.rstrip("\n").split("\t")
+    if len(fields) < MIN_SAM_FIELDS:
+        raise ValueError("cannot setup AlignRead object from split, its too short")
+    return fields
+
+
+def _next_record(handle: TextIO) -> list[str] | None:
+    """Read the next alignment record from an open SAM file.
+
+    Args:
+        handle: Open SAM file positioned after the header
+
+    Returns:
+        Split SAM fields, or None at end of file
+    """
+    line = handle.readline()
+    if not line.strip():
+        return None
+    return _split_record(line)
+
+
+def _first_record(handle: TextIO) -> list[str] | None:
+    """Skip the SAM header and return the first alignment record.
+
+    Args:
+        handle: Open SAM file positioned at the start
+
+    Returns:
+        Split SAM fields of the first record, or None if there are none
+    """
+    line = handle.readline()
+    while line and is_header_line(line):
+        line = handle.readline()
+    if not line.strip():
+        return None
+    return _split_record(line)
+
+
+def _iter_single(handle: TextIO) -> Iterator[list[list[str]]]:
+    """Yield single-end records from an open SAM file.
+
+    Args:
+        handle: Open SAM file positioned at the start
+
+    Yields:
+        List containing the split fields of one read
+    """
+    fields = _first_record(handle)
+    while fields is not None:
+        yield [fields]
+        fields = _next_record(handle)
+
+
+def _iter_paired(handle: TextIO) -> Iterator[list[list[str]]]:
+    """Yield mate pairs from an open SAM file, skipping inconsistent mates.
+
+    Args:
+        handle: Open SAM file positioned at the start
+
+    Yields:
+        List containing the split fields of mate 1 and mate 2
+    """
+    fields_1 = _first_record(handle)
+    fields_2 = _next_record(handle) if fields_1 else None
+    while fields_1 is not None and fields_2 is not None:
+        if is_proper_pair(fields_1, fields_2):
+            yield [fields_1, fields_2]
+        else:
+            log.warning(
+                "mate_2 is inconsistent with mate_1 for read: "
+                f"{fields_1[QNAME]} SKIPPING!"
+            )
+        fields_1 = _next_record(handle)
+        fields_2 = _next_record(handle) if fields_1 else None
+
+
+def _iter_bam_records(path: Path) -> Iterator[list[str]]:
+    """Yield mapped records from a BAM file through pysam.
+
+    Args:
+        path: Path to BAM file
+
+    Yields:
+        Split SAM fields of each mapped read
+    """
+    if not PYSAM_AVAILABLE:
+        raise ImportError("pysam is required to read BAM files: pip install pysam")
+    with pysam.AlignmentFile(str(path), "rb") as bam:
+        for read in bam:
+            if not read.is_unmapped:
+                yield read.to_string().split("\t")
+
+
+def _pair_records(records: Iterator[list[str]]) -> Iterator[list[list[str]]]:
+    """Group records into mate pairs by query name, skipping inconsistent mates.
+
+    Unmapped records are already dropped, so a mate can be missing; a record
+    whose successor has another query name is skipped on its own, so that one
+    lone mate does not shift the pairing of all later records.
+
+    Args:
+        records: Iterator over split SAM records
+
+    Yields:
+        List containing the split fields of mate 1 and mate 2
+    """
+    fields_1 = next(records, None)
+    while fields_1 is not None:
+        fields_2 = next(records, None)
+        if fields_2 is None:
+            log.warning(f"no mate_2 for read: {fields_1[QNAME]} SKIPPING!")
+            return
+        if fields_2[QNAME] != fields_1[QNAME]:
+            log.warning(f"no mate_2 for read: {fields_1[QNAME]} SKIPPING!")
+            fields_1 = fields_2
+            continue
+        if is_proper_pair(fields_1, fields_2):
+            yield [fields_1, fields_2]
+        else:
+            log.warning(
+                "mate_2 is inconsistent with mate_1 for read: "
+                f"{fields_1[QNAME]} SKIPPING!"
+            )
+        fields_1 = next(records, None)
+
+
+def _iter_bam(path: Path, paired: bool) -> Iterator[list[list[str]]]:
+    """Yield records from a BAM file through pysam.
+
+    Args:
+        path: Path to BAM file
+        paired: Whether reads are paired-end
+
+    Yields:
+        List containing the split fields of one read or one mate pair
+    """
+    records = _iter_bam_records(path)
+    if paired:
+        yield from _pair_records(records)
+    else:
+        yield from ([fields] for fields in records)
+
+
+def iter_sam_fields(path: str | Path, paired: bool) -> Iterator[list[list[str]]]:
+    """Stream split alignment records from a SAM or BAM file.
+
+    Args:
+        path: Path to SAM or BAM file
+        paired: Whether reads are paired-end
+
+    Yields:
+        List with the split fields of one read (single-end) or both mates
+    """
+    path = Path(path)
+    if path.suffix == ".bam":
+        yield from _iter_bam(path, paired)
+        return
+    with open(path) as handle:
+        if paired:
+            yield from _iter_paired(handle)
+        else:
+            yield from _iter_single(handle)
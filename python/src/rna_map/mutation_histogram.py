@@ -16,6 +16,7 @@ from rna_map.analysis.statistics import (
     merge_all_merge_mut_histo_dicts,
     merge_mut_histo_dicts,
 )
+from rna_map.io.histogram_binary import read_histogram_file, write_histogram_file
 from rna_map.visualization import (
     colors_for_sequence,
     plot_modified_bases,
@@ -34,6 +35,8 @@ __all__ = [
     "write_mut_histos_to_pickle_file",
     "get_mut_histos_from_json_file",
     "get_mut_histos_from_pickle_file",
+    "write_mut_histos_to_binary_file",
+    "get_mut_histos_from_binary_file",
     "convert_dreem_mut_histos_to_mutation_histogram",
     "colors_for_sequence",
     "plot_read_coverage",
@@ -128,6 +131,30 @@ def get_mut_histos_from_pickle_file(fname: str) -> dict[str, MutationHistogram]:
     return data
 
 
+def write_mut_histos_to_binary_file(
+    mut_histos: dict[str, MutationHistogram], fname: str
+) -> None:
+    """Write mutation histograms to a compact binary file.
+
+    Args:
+        mut_histos: Dictionary of mutation histograms
+        fname: Output file path
+    """
+    write_histogram_file(mut_histos, fname)
+
+
+def get_mut_histos_from_binary_file(fname: str) -> dict[str, MutationHistogram]:
+    """Load mutation histograms from a compact binary file.
+
+    Args:
+        fname: Input file path
+
+    Returns:
+        Dictionary of mutation histograms
+    """
+    return read_histogram_file(fname)
+
+
 def merge_mut_histo_files(mh_files, outdir, kind="pickle") -> None:
     """Merge mutation histogram files.
 
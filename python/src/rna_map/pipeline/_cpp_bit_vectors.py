@@ -1,6 +1,7 @@
 """C++ implementation wrapper for bit vector generation."""
 
 import sys
+import time
 from pathlib import Path
 from typing import Optional
 
@@ -63,15 +64,46 @@ try:
 except Exception as e:
     CPP_AVAILABLE = False
 
-from rna_map.io.sam import AlignedRead
+from rna_map.analysis.stage_stats import StageStats
 from rna_map.io.fasta import fasta_to_dict
 from rna_map.io.fastq import parse_phred_qscore_file
+from rna_map.io.sam_reader import get_md_tag
 from rna_map import settings
 from rna_map.logger import get_logger
+from rna_map.pipeline.parallel_bit_vectors import (
+    DEFAULT_BATCH_SIZE,
+    iter_record_batches,
+)
+from rna_map.pipeline.streaming import DEFAULT_QUEUE_DEPTH, iter_bounded, plan_window
 
 log = get_logger("PIPELINE.BIT_VECTOR_CPP")
 
 
+def _cpp_read_from_fields(fields: list[str]):
+    """Build a C++ AlignedRead directly from split SAM fields.
+
+    Args:
+        fields: Split SAM line
+
+    Returns:
+        bit_vector_cpp.AlignedRead instance
+    """
+    read = bit_vector_cpp.AlignedRead()
+    read.qname = fields[0]
+    read.flag = fields[1]
+    read.rname = fields[2]
+    read.pos = int(fields[3])
+    read.mapq = int(fields[4])
+    read.cigar = fields[5]
+    read.rnext = fields[6]
+    read.pnext = int(fields[7])
+    read.tlen = int(fields[8])
+    read.seq = fields[9]
+    read.qual = fields[10]
+    read.md_string = get_md_tag(fields)
+    return read
+
+
 def generate_bit_vectors_cpp(
     sam_path: Path,
     fasta: Path,
@@ -90,7 +122,7 @@ def generate_bit_vectors_cpp(
         config: BitVectorConfig object
         csv_file: Optional CSV file (not used in C++ version yet)
         paired: Whether reads are paired-end
-        use_stricter_constraints: Whether to use stricter constraints (not used in C++ yet)
+        use_stricter_constraints: Whether to use stricter constraints
     
     Returns:
         BitVectorResult object
@@ -106,8 +138,7 @@ def generate_bit_vectors_cpp(
         settings.get_py_path() / "resources" / "phred_ascii.txt"
     )
     
-    # Convert to C++ format
-    ref_seqs_cpp = {str(k): str(v) for k, v in ref_seqs.items()}
+    # Convert to C++ format (reference sequences are already str -> str)
     phred_qscores_cpp = {k: v for k, v in phred_qscores.items()}
     
     # Auto-detect paired-end if not specified
@@ -135,8 +166,6 @@ def generate_bit_vectors_cpp(
         num_of_surbases=config.num_of_surbases
     )
     
-    # Use Python SAM iterator directly (avoid BitVectorIterator which has recursion bug)
-    from rna_map.io.sam import SingleSamIterator, PairedSamIterator
     from rna_map.core.bit_vector import BitVector
     from rna_map.core.results import BitVectorResult
     from rna_map.analysis.mutation_histogram import MutationHistogram
@@ -149,141 +178,83 @@ def generate_bit_vectors_cpp(
     os.makedirs(output_dir, exist_ok=True)
     os.makedirs(bv_dir, exist_ok=True)
     
-    # Use Python SAM iterator directly
-    if paired:
-        sam_iterator = PairedSamIterator(str(sam_path), ref_seqs)
-    else:
-        sam_iterator = SingleSamIterator(str(sam_path), ref_seqs)
-    
-    # Generate bit vectors using C++
-    bit_vectors = []
-    try:
-        for reads in sam_iterator:
-            if not reads:
-                continue
-            
-            # Convert Python AlignedRead to C++ AlignedRead
-            read1_cpp = bit_vector_cpp.AlignedRead()
-            read1_cpp.qname = reads[0].qname
-            read1_cpp.flag = reads[0].flag
-            read1_cpp.rname = reads[0].rname
-            read1_cpp.pos = reads[0].pos
-            read1_cpp.mapq = reads[0].mapq
-            read1_cpp.cigar = reads[0].cigar
-            read1_cpp.rnext = reads[0].rnext
-            read1_cpp.pnext = reads[0].pnext
-            read1_cpp.tlen = reads[0].tlen
-            read1_cpp.seq = reads[0].seq
-            read1_cpp.qual = reads[0].qual
-            read1_cpp.md_string = reads[0].md_string
-            
-            ref_seq = ref_seqs[reads[0].rname]
-            
-            if paired and len(reads) > 1:
-                read2_cpp = bit_vector_cpp.AlignedRead()
-                read2_cpp.qname = reads[1].qname
-                read2_cpp.flag = reads[1].flag
-                read2_cpp.rname = reads[1].rname
-                read2_cpp.pos = reads[1].pos
-                read2_cpp.mapq = reads[1].mapq
-                read2_cpp.cigar = reads[1].cigar
-                read2_cpp.rnext = reads[1].rnext
-                read2_cpp.pnext = reads[1].pnext
-                read2_cpp.tlen = reads[1].tlen
-                read2_cpp.seq = reads[1].seq
-                read2_cpp.qual = reads[1].qual
-                read2_cpp.md_string = reads[1].md_string
-                
-                # Generate bit vector using C++
-                data_cpp = generator.generate_paired(read1_cpp, read2_cpp, ref_seq, phred_qscores_cpp)
-            else:
-                # Generate bit vector using C++
-                data_cpp = generator.generate_single(read1_cpp, ref_seq, phred_qscores_cpp)
-            
-            # Convert back to Python format
-            data_py = {int(k): str(v) for k, v in data_cpp.items()}
-            bv = BitVector(reads=reads, data=data_py)
-            bit_vectors.append(bv)
-    except StopIteration:
-        pass
-    
-    # Now process bit vectors through Python pipeline for histograms
-    
-    # Generate mutation histograms (reuse Python code for this)
+    batch_size, queue_depth = plan_window(
+        config.max_memory_mb, DEFAULT_BATCH_SIZE, DEFAULT_QUEUE_DEPTH
+    )
+
+    stats = StageStats("cpp")
+    stats.count_input_bytes(sam_path)
+
+    def iter_cpp_bit_vectors():
+        # SAM parsing runs on a reader thread at most queue_depth batches
+        # ahead; split fields go straight into C++ reads (no Python AlignedRead)
+        batches = iter_bounded(
+            iter_record_batches(sam_path, paired, batch_size), queue_depth
+        )
+        while True:
+            start = time.perf_counter()
+            batch = next(batches, None)
+            stats.add("parse", time.perf_counter() - start)
+            if batch is None:
+                return
+            for record in batch:
+                yield _cpp_bit_vector(record)
+
+    def _cpp_bit_vector(record):
+        start = time.perf_counter()
+        reads = [_cpp_read_from_fields(fields) for fields in record]
+        parsed = time.perf_counter()
+        if reads[0].rname not in ref_seqs:
+            raise ValueError(
+                f"read {reads[0].qname} aligned to {reads[0].rname} which is "
+                "not in the reference fasta"
+            )
+        ref_seq = ref_seqs[reads[0].rname]
+        if paired and len(reads) > 1:
+            data_cpp = generator.generate_paired(
+                reads[0], reads[1], ref_seq, phred_qscores_cpp
+            )
+        else:
+            data_cpp = generator.generate_single(
+                reads[0], ref_seq, phred_qscores_cpp
+            )
+        stats.add("parse", parsed - start)
+        stats.add("kernel", time.perf_counter() - parsed)
+        # pybind11 already converts std::map to a dict with int keys
+        return BitVector(reads=reads, data=data_cpp)
+
+    # Histograms are accumulated and bit vectors written as each one is
+    # produced, so only the buffered batches are ever held in memory
     from rna_map.pipeline.bit_vector_generator import BitVectorGenerator
     mut_histos: dict[str, MutationHistogram] = {}
-    
-    # Create temporary params for BitVectorGenerator to process histograms
+
     params = {
         "dirs": {"output": str(output_dir)},
-        "bit_vector": {
-            "qscore_cutoff": config.qscore_cutoff,
-            "num_of_surbases": config.num_of_surbases,
-            "map_score_cutoff": config.map_score_cutoff,
-            "plot_sequence": config.plot_sequence,
-            "summary_output_only": config.summary_output_only,
-            "storage_format": config.storage_format.value,
-        },
+        "bit_vector": config.to_params(),
+        "overwrite": True,
         "restore_org_behavior": False,
         "stricter_bv_constraints": use_stricter_constraints,
     }
-    
-    if config.stricter_constraints:
-        params["bit_vector"]["stricter_constraints"] = {
-            "min_mut_distance": config.stricter_constraints.min_mut_distance,
-            "percent_length_cutoff": config.stricter_constraints.percent_length_cutoff,
-            "mutation_count_cutoff": config.stricter_constraints.mutation_count_cutoff,
-        }
-    
-    # Use Python BitVectorGenerator for histogram generation and output
-    # Create a custom iterator that yields our C++-generated bit vectors
-    class CppBitVectorIterator:
-        def __init__(self, bit_vectors):
-            self.bit_vectors = bit_vectors
-            self.index = 0
-        
-        def __iter__(self):
-            return self
-        
-        def __next__(self):
-            if self.index >= len(self.bit_vectors):
-                raise StopIteration
-            bv = self.bit_vectors[self.index]
-            self.index += 1
-            return bv
-    
+
     generator_py = BitVectorGenerator()
     generator_py.setup(params)
-    
-    # Replace the iterator with our C++-generated bit vectors
-    generator_py._BitVectorGenerator__bit_vec_iterator = CppBitVectorIterator(bit_vectors)
-    generator_py._BitVectorGenerator__ref_seqs = ref_seqs
-    generator_py._BitVectorGenerator__map_score_cutoff = config.map_score_cutoff
-    generator_py._BitVectorGenerator__csv_file = csv_file if csv_file else Path("")
-    generator_py._BitVectorGenerator__summary_only = config.summary_output_only
-    
-    # Initialize rejected output file if needed
-    if not hasattr(generator_py, '_BitVectorGenerator__rejected_out'):
-        rejected_file = bv_dir / "rejected_bvs.csv"
-        generator_py._BitVectorGenerator__rejected_out = open(rejected_file, "w")
-        generator_py._BitVectorGenerator__rejected_out.write("qname,rname,reason,read1,read2,bitvector\n")
-    
-    # Process bit vectors to generate histograms
-    # Note: Single underscore methods don't get name-mangled, double underscore attributes do
-    generator_py._BitVectorGenerator__mut_histos = {}
-    generator_py._initialize_mutation_histograms()  # Single underscore, no mangling
-    generator_py._load_structure_from_csv()  # Single underscore, no mangling
-    generator_py._process_all_bit_vectors()  # Single underscore, no mangling
-    generator_py._close_writers()  # Single underscore, no mangling
-    pickle_file = bv_dir / "mutation_histos.p"
-    generator_py._save_mutation_histograms(pickle_file)  # Single underscore, no mangling
-    generator_py._BitVectorGenerator__generate_plots()  # Double underscore, needs mangling
-    generator_py._BitVectorGenerator__get_skip_summary()  # Double underscore, needs mangling
-    generator_py._BitVectorGenerator__write_summary_csv()  # Double underscore, needs mangling
-    
-    # Load mutation histograms
+    generator_py.run_on_bit_vectors(
+        iter_cpp_bit_vectors(),
+        ref_seqs,
+        csv_file if csv_file else Path(""),
+        stats=stats,
+        sam_path=sam_path,
+    )
+
+    # Load mutation histograms; the binary file is memory mapped, the pickle
+    # is only read for older outputs
+    from rna_map.io.histogram_binary import HISTO_BINARY_FILE_NAME, read_histogram_file
+
+    binary_file = bv_dir / HISTO_BINARY_FILE_NAME
     pickle_file = bv_dir / "mutation_histos.p"
-    if pickle_file.exists():
+    if binary_file.exists():
+        mut_histos = read_histogram_file(binary_file)
+    elif pickle_file.exists():
         with open(pickle_file, "rb") as f:
             mut_histos = pickle.load(f)
     
@@ -1,46 +1,105 @@
 """Bit vector generator for mutation analysis."""
 
+import itertools
 import os
 from pathlib import Path
 import pickle
+import time
+from typing import Iterable
 
 import pandas as pd
 from tabulate import tabulate
 
-from rna_map.analysis.mutation_histogram import MutationHistogram
-from rna_map.analysis.statistics import get_dataframe
-from rna_map.core.bit_vector import BitVectorSymbols
+from rna_map.analysis.bit_vector_cache import BitVectorCache
+from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import HistogramStore, MutationHistogram
+from rna_map.analysis.stage_stats import STATS_FILE_NAME, StageStats
+from rna_map.analysis.statistics import SUMMARY_COLUMNS, write_summary_csv
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import StricterConstraints
 from rna_map.io.bit_vector_storage import (
     StorageFormat,
     create_storage_writer,
     BitVectorStorageWriter,
 )
+from rna_map.io.checkpoint import (
+    get_sam_signature,
+    read_checkpoint,
+    remove_checkpoint,
+    write_checkpoint,
+)
 from rna_map.io.fasta import fasta_to_dict
+from rna_map.io.histogram_binary import HISTO_BINARY_FILE_NAME
+from rna_map.io.plot_bundle import (
+    DEFAULT_PLOT_TOP_N,
+    PLOT_BUNDLE_FILE_NAME,
+    PlotMode,
+    get_bundle_entries,
+    write_plot_bundle,
+)
+from rna_map.io.rejected_log import (
+    DEFAULT_SAMPLE_EVERY,
+    REJECTED_COUNTS_FILE_NAME,
+    RejectedLog,
+    RejectedLogMode,
+    write_rejected_counts,
+)
 from rna_map.logger import get_logger
 from rna_map.mutation_histogram import (
+    get_mut_histos_from_binary_file,
+    write_mut_histos_to_binary_file,
     write_mut_histos_to_json_file,
     write_mut_histos_to_pickle_file,
 )
+from rna_map.pipeline.parallel_bit_vectors import iter_batch_results, merge_shards
 from rna_map.visualization import (
     plot_modified_bases,
     plot_mutation_histogram,
-    plot_population_avg,
     plot_read_coverage,
 )
+from rna_map.visualization.plot_scheduler import (
+    pop_avg_task,
+    render_tasks,
+    select_references,
+)
 
 # Import BitVectorIterator from analysis module
 # Lazy import to avoid circular dependency - import inside run() method
 
 log = get_logger("PIPELINE.BIT_VECTOR_GENERATOR")
 
+# References shown in the MUTATION SUMMARY and REMOVED READS log tables; the
+# rest are only in summary.csv
+MAX_LOG_TABLE_ROWS = 100
+
+
+def _log_table(rows: list[list], columns: list[str], total: int) -> str:
+    """Format the first MAX_LOG_TABLE_ROWS rows of a log table.
+
+    Args:
+        rows: Table rows (at least the first MAX_LOG_TABLE_ROWS)
+        columns: Column names
+        total: Number of rows of the full table
+
+    Returns:
+        github-format table, noting the rows left out
+    """
+    table = tabulate(rows[:MAX_LOG_TABLE_ROWS], columns, tablefmt="github")
+    if total > MAX_LOG_TABLE_ROWS:
+        table += (
+            f"\n... {total - MAX_LOG_TABLE_ROWS} more references not shown"
+            " (see summary.csv)"
+        )
+    return table
+
 
 class BitVectorGenerator:
     """Generates bit vectors from aligned reads and performs mutation analysis."""
 
     def __init__(self):
         """Initialize BitVectorGenerator."""
-        self.__bases = ["A", "C", "G", "T"]
-        self.__bts = BitVectorSymbols()
+        self.__params: dict = {}
 
     def setup(self, params: dict) -> None:
         """Setup generator with parameters.
@@ -54,7 +113,13 @@ class BitVectorGenerator:
         os.makedirs(self.__out_dir, exist_ok=True)
 
     def run(
-        self, sam_path: Path, fasta: str | Path, paired: bool, csv_file: str | Path
+        self,
+        sam_path: Path,
+        fasta: str | Path,
+        paired: bool,
+        csv_file: str | Path,
+        ref_seqs: dict[str, str] | None = None,
+        ambig_index: DeletionAmbiguityIndex | None = None,
     ) -> None:
         """Run bit vector generation and analysis.
 
@@ -63,47 +128,168 @@ class BitVectorGenerator:
             fasta: Path to FASTA file
             paired: Whether reads are paired-end
             csv_file: Path to CSV file with structure info (optional)
+            ref_seqs: Already loaded sequences of fasta, to skip parsing it
+            ambig_index: Deletion ambiguity cache to reuse (single worker only)
         """
         log.info("starting bitvector generation")
-        self.__ref_seqs = fasta_to_dict(fasta)
+        if ref_seqs is None:
+            ref_seqs = fasta_to_dict(fasta)
+        num_workers = self.__params["bit_vector"].get("num_workers", 1)
+        self.__sam_path = sam_path
+        stats = StageStats("parallel" if num_workers > 1 else "python")
+        stats.count_input_bytes(sam_path)
+        if num_workers > 1:
+            self.__bit_vec_iterator = None
+            self.__cache = None
+            self.__ambig_index = None
+            self.__parallel_job = (sam_path, paired, num_workers)
+            self.__stats = stats
+            self.__run_analysis(ref_seqs, csv_file)
+            return
         # Lazy import to avoid circular dependency
         from rna_map.analysis.bit_vector_iterator import BitVectorIterator
 
         use_pysam = self.__params.get("bit_vector", {}).get("use_pysam", False)
-        self.__bit_vec_iterator = BitVectorIterator(
-            sam_path, self.__ref_seqs, paired, use_pysam=use_pysam
+        dense = self.__params["bit_vector"].get("dense_bit_vectors", False)
+        bit_vec_iterator = BitVectorIterator(
+            sam_path,
+            ref_seqs,
+            paired,
+            num_of_surbases=self.__params["bit_vector"].get("num_of_surbases", 10),
+            use_pysam=use_pysam,
+            dense=dense,
+            stats=stats,
+            ambig_index=ambig_index,
+            cache_size=self.__params["bit_vector"].get("dedup_cache_size", 0),
+        )
+        self.run_on_bit_vectors(
+            bit_vec_iterator, ref_seqs, csv_file, stats=stats, sam_path=sam_path
         )
+
+    def run_on_bit_vectors(
+        self,
+        bit_vectors: Iterable[BitVector],
+        ref_seqs: dict[str, str],
+        csv_file: str | Path,
+        stats: StageStats | None = None,
+        sam_path: Path | None = None,
+    ) -> None:
+        """Run histogram generation and analysis on a stream of bit vectors.
+
+        Used by alternative bit vector engines (e.g. the C++ module). Bit
+        vectors are consumed one at a time and never buffered.
+
+        Args:
+            bit_vectors: Iterable of BitVector objects
+            ref_seqs: Dictionary of reference sequences
+            csv_file: Path to CSV file with structure info (optional)
+            stats: Stage stats the engine fills while producing bit vectors
+                (parse and kernel time, bytes read); a new one if None
+            sam_path: SAM file the bit vectors come from, one per record;
+                needed for checkpoints. On resume, iterators with a skip()
+                method skip the checkpointed records, others regenerate
+                and drop them
+        """
+        self.__sam_path = sam_path
+        self.__bit_vec_iterator = iter(bit_vectors)
+        # Set when the bit vectors come from a BitVectorIterator with a cache
+        self.__cache: BitVectorCache | None = getattr(bit_vectors, "cache", None)
+        self.__ambig_index: DeletionAmbiguityIndex | None = getattr(
+            bit_vectors, "ambig_index", None
+        )
+        self.__parallel_job = None
+        self.__stats = stats or StageStats()
+        self.__run_analysis(ref_seqs, csv_file)
+
+    def __run_analysis(self, ref_seqs: dict[str, str], csv_file: str | Path) -> None:
+        """Generate histograms, plots and summaries for the current input.
+
+        Args:
+            ref_seqs: Dictionary of reference sequences
+            csv_file: Path to CSV file with structure info (optional)
+        """
+        self.__ref_seqs = ref_seqs
         self.__mut_histos: dict[str, MutationHistogram] = {}
         self.__map_score_cutoff = self.__params["bit_vector"]["map_score_cutoff"]
         self.__csv_file = csv_file
         self.__summary_only = self.__params["bit_vector"]["summary_output_only"]
-        self.__rejected_out = open(self.__out_dir / "rejected_bvs.csv", "w")
-        self.__rejected_out.write("qname,rname,reason,read1,read2,bitvector\n")
+        self.__check_resume()
+        self.__open_rejected_log()
         self.__generate_all_bit_vectors()
-        self.__generate_plots()
-        self.__get_skip_summary()
-        self.__write_summary_csv()
+        self.__close_rejected_log()
+        with self.__stats.timed("plots"):
+            self.__generate_plots()
+        with self.__stats.timed("summary"):
+            self.__get_skip_summary()
+            self.__write_summary_csv()
+        self.__write_stats()
+
+    def __check_resume(self) -> None:
+        """Refuse to resume into outputs that would lose the checkpointed reads.
+
+        Bit vector files and the rejected read log are rewritten from the
+        first record processed, so only histogram outputs can be resumed.
+
+        Raises:
+            ValueError: If resume is set with bit vector files or rejected
+                read rows enabled
+        """
+        bv_params = self.__params["bit_vector"]
+        if not bv_params.get("resume", False):
+            return
+        rejected_mode = RejectedLogMode.parse(bv_params.get("rejected_log", "full"))
+        if not self.__summary_only or rejected_mode.writes_rows:
+            raise ValueError(
+                "resume needs summary_output_only and a rejected_log of off or "
+                "counts: bit vector files and rejected read rows written before "
+                "the checkpoint would be lost"
+            )
+
+    def __open_rejected_log(self) -> None:
+        """Open the rejected read log for the configured mode."""
+        bv_params = self.__params["bit_vector"]
+        self.__rejected_mode = RejectedLogMode.parse(
+            bv_params.get("rejected_log", "full")
+        )
+        self.__rejected_log: RejectedLog | None = None
+        if self.__rejected_mode.writes_rows:
+            every = 1
+            if self.__rejected_mode == RejectedLogMode.SAMPLED:
+                every = bv_params.get("rejected_log_every", DEFAULT_SAMPLE_EVERY)
+            self.__rejected_log = RejectedLog(
+                self.__out_dir,
+                sample_every=every,
+                compress=bv_params.get("rejected_log_compress", False),
+            )
+
+    def __close_rejected_log(self) -> None:
+        """Finish the rejected read log; counts mode writes its table here."""
+        if self.__rejected_log is not None:
+            self.__rejected_log.close()
+        if self.__rejected_mode == RejectedLogMode.COUNTS:
+            write_rejected_counts(
+                {name: mh.skips for name, mh in self.__mut_histos.items()},
+                self.__out_dir / REJECTED_COUNTS_FILE_NAME,
+            )
+
+    def __write_stats(self) -> None:
+        """Write stage timings, counters and rejects to bit_vector_stats.json."""
+        rejects: dict[str, int] = {}
+        for mh in self.__mut_histos.values():
+            for reason, n in mh.skips.items():
+                rejects[reason] = rejects.get(reason, 0) + n
+        self.__stats.write_json(self.__out_dir / STATS_FILE_NAME, rejects)
 
     def __write_summary_csv(self) -> None:
-        """Write summary CSV file."""
-        cols = [
-            "name",
-            "reads",
-            "aligned",
-            "no_mut",
-            "1_mut",
-            "2_mut",
-            "3_mut",
-            "3plus_mut",
-            "sn",
-        ]
-        df = get_dataframe(self.__mut_histos, cols)
+        """Write summary CSV file, a block of references at a time."""
+        sum_path = os.path.join(self.__out_dir, "summary.csv")
+        head = write_summary_csv(
+            self.__mut_histos.values(), sum_path, head_rows=MAX_LOG_TABLE_ROWS
+        )
         log.info(
             "MUTATION SUMMARY:\n"
-            + tabulate(df, df.columns, tablefmt="github", showindex=False)
+            + _log_table(head, list(SUMMARY_COLUMNS), len(self.__mut_histos))
         )
-        sum_path = os.path.join(self.__out_dir, "summary.csv")
-        df.to_csv(sum_path, index=False)
 
     def __get_skip_summary(self) -> None:
         """Generate summary of rejected reads."""
@@ -111,7 +297,9 @@ class BitVectorGenerator:
         cols = ["low_mapq"]
         if self.__params["stricter_bv_constraints"]:
             cols += ["short_read", "too_many_muts", "muts_too_close"]
-        for mut_histo in self.__mut_histos.values():
+        for mut_histo in itertools.islice(
+            self.__mut_histos.values(), MAX_LOG_TABLE_ROWS
+        ):
             row: list[str | float] = [mut_histo.name]
             for col in cols:
                 try:
@@ -119,51 +307,69 @@ class BitVectorGenerator:
                 except ZeroDivisionError:
                     row.append(0.0)
             data.append(row)
-        df = pd.DataFrame(data, columns=["name"] + cols)
         log.info(
             "REMOVED READS:\n"
-            + tabulate(df, df.columns, tablefmt="github", showindex=False)
+            + _log_table(data, ["name"] + cols, len(self.__mut_histos))
             + "\n"
         )
 
     def __generate_plots(self) -> None:
-        """Generate plots for each mutation histogram."""
-        for _, mh in self.__mut_histos.items():
-            fname = f"{self.__out_dir}/{mh.name}_{mh.start}_{mh.end}_"
-            if not self.__summary_only:
-                df = mh.get_pop_avg_dataframe()
-                plot_population_avg(
-                    df,
-                    mh.name,
-                    f"{fname}pop_avg.png",
-                    plot_sequence=self.__params["bit_vector"]["plot_sequence"],
-                )
-            if self.__params["restore_org_behavior"]:
-                mod_bases_list = {k: v.tolist() for k, v in mh.mod_bases.items()}
-                plot_modified_bases(
-                    mh.get_nuc_coords(), mod_bases_list, f"{fname}mutations.png"
-                )
-                plot_mutation_histogram(
-                    mh.get_nuc_coords(),
-                    mh.num_of_mutations,
-                    f"{fname}mutation_histogram.png",
-                )
-                plot_read_coverage(
-                    mh.get_nuc_coords(),
-                    mh.get_read_coverage(),
-                    f"{fname}read_coverage.png",
+        """Write the pop_avg.json bundle and render the selected plots.
+
+        The plot mode, read threshold and top-N limit select the references
+        that are plotted; all of them stay in the bundle.
+        """
+        bv_params = self.__params["bit_vector"]
+        restore = self.__params["restore_org_behavior"]
+        if self.__summary_only and not restore:
+            return
+        histos = {mh.name: mh for mh in self.__mut_histos.values()}
+        selected = select_references(
+            {name: mh.num_aligned for name, mh in histos.items()},
+            PlotMode.parse(bv_params.get("plot_mode", "all")),
+            bv_params.get("plot_top_n", DEFAULT_PLOT_TOP_N),
+            bv_params.get("plot_min_reads", 0),
+        )
+        tasks = []
+        if not self.__summary_only:
+            entries = get_bundle_entries(histos.values())
+            write_plot_bundle(entries, self.__out_dir / PLOT_BUNDLE_FILE_NAME)
+            tasks += [
+                pop_avg_task(
+                    name, entries[name], self.__out_dir, bv_params["plot_sequence"]
                 )
+                for name in selected
+            ]
+        if restore:
+            for name in selected:
+                mh = histos[name]
+                fname = f"{self.__out_dir}/{mh.name}_{mh.start}_{mh.end}_"
+                coords = mh.get_nuc_coords()
+                mod_bases = {k: v.tolist() for k, v in mh.mod_bases.items()}
+                for func, data, suffix in (
+                    (plot_modified_bases, mod_bases, "mutations"),
+                    (
+                        plot_mutation_histogram,
+                        mh.num_of_mutations,
+                        "mutation_histogram",
+                    ),
+                    (plot_read_coverage, mh.get_read_coverage(), "read_coverage"),
+                ):
+                    tasks.append((func, (coords, data, f"{fname}{suffix}.png"), {}))
+        render_tasks(tasks, bv_params.get("plot_workers", 1))
 
     def __generate_all_bit_vectors(self) -> None:
         """Generate all bit vectors from SAM file."""
-        pickle_file = self.__out_dir / "mutation_histos.p"
-        if self._should_skip_generation(pickle_file):
+        if self._should_skip_generation():
             return
         self._initialize_mutation_histograms()
+        self._restore_histograms()
+        self._initialize_accumulator()
         self._load_structure_from_csv()
         self._process_all_bit_vectors()
         self._close_writers()
-        self._save_mutation_histograms(pickle_file)
+        self._save_mutation_histograms()
+        remove_checkpoint(self.__checkpoint_dir)
 
     def _close_writers(self) -> None:
         """Close all bit vector storage writers."""
@@ -171,58 +377,153 @@ class BitVectorGenerator:
             if writer:
                 writer.close()
 
-    def _should_skip_generation(self, pickle_file: Path) -> bool:
+    def _should_skip_generation(self) -> bool:
         """Check if bit vector generation should be skipped.
 
-        Args:
-            pickle_file: Path to pickle file
+        A previous run is recognized by its binary histograms, which are
+        always written; outputs of older releases only have the pickle.
 
         Returns:
             True if should skip, False otherwise
         """
-        if os.path.isfile(pickle_file) and not self.__params["overwrite"]:
-            log.info(
-                "SKIPPING bit vector generation, it has run already! specify"
-                " -overwrite to rerun"
-            )
+        if self.__params["bit_vector"].get("append_histograms", False):
+            return False
+        if self.__params["overwrite"]:
+            return False
+        binary_file = self.__out_dir / HISTO_BINARY_FILE_NAME
+        pickle_file = self.__out_dir / "mutation_histos.p"
+        if binary_file.is_file():
+            self.__mut_histos = get_mut_histos_from_binary_file(str(binary_file))
+        elif pickle_file.is_file():
             with open(pickle_file, "rb") as handle:
                 self.__mut_histos = pickle.load(handle)
-            return True
-        return False
+        else:
+            return False
+        log.info(
+            "SKIPPING bit vector generation, it has run already! specify"
+            " -overwrite to rerun"
+        )
+        return True
 
     def _initialize_mutation_histograms(self) -> None:
         """Initialize mutation histograms and bit vector writers."""
         self._bit_vector_writers: dict[str, BitVectorStorageWriter] = {}
-        storage_format_str = self.__params["bit_vector"].get(
-            "storage_format", "text"
-        ).lower()
-        storage_format = (
-            StorageFormat.JSON
-            if storage_format_str == "json"
-            else StorageFormat.TEXT
+        self._storage_format = StorageFormat.parse(
+            self.__params["bit_vector"].get("storage_format", "text")
         )
+        self._shared_writer: BitVectorStorageWriter | None = None
 
+        # Counts of all references share one store and are allocated on first hit
+        store = HistogramStore()
         for ref_name, seq in self.__ref_seqs.items():
             self.__mut_histos[ref_name] = MutationHistogram(
-                ref_name, seq, "DMS", 1, len(seq)
+                ref_name, seq, "DMS", 1, len(seq), store=store
+            )
+        if not self.__summary_only:
+            # One writer for all references; TEXT uses a pool of per-reference
+            # files with a bounded number of open handles
+            self._shared_writer = create_storage_writer(
+                self._storage_format,
+                self.__out_dir,
+                references=list(self.__ref_seqs),
+                ref_seqs=self.__ref_seqs,
+                collapse=self.__params["bit_vector"].get("collapse_duplicates", False),
+            )
+            self._bit_vector_writers["shared_writer"] = self._shared_writer
+
+    def _restore_histograms(self) -> None:
+        """Start from the checkpoint of the SAM file, or the histograms to append to.
+
+        With resume, the histograms of a checkpoint for the same SAM file are
+        loaded and its records are skipped. With append (and no checkpoint),
+        the histograms of the previous run in the output directory are the
+        starting point for the reads of the new SAM file. Bit vector files
+        and the rejected read log only hold the reads processed by this run.
+
+        Raises:
+            ValueError: If the loaded histograms have references that are not
+                in the reference fasta
+        """
+        bv_params = self.__params["bit_vector"]
+        self.__records_done = 0
+        self.__checkpoint_every = bv_params.get("checkpoint_every", 0)
+        self.__checkpoint_dir = Path(bv_params.get("checkpoint_dir") or self.__out_dir)
+        resume = bv_params.get("resume", False)
+        self.__sam_signature = None
+        if self.__sam_path is not None:
+            self.__sam_signature = get_sam_signature(self.__sam_path)
+        if self.__sam_signature is None:
+            if self.__checkpoint_every or resume:
+                log.warning("input is not a regular file, checkpoints are disabled")
+            self.__checkpoint_every = 0
+            resume = False
+        if resume:
+            checkpoint = read_checkpoint(self.__checkpoint_dir, self.__sam_signature)
+            if checkpoint is not None:
+                shards, self.__records_done = checkpoint
+                log.info(
+                    f"resuming {self.__sam_path} after {self.__records_done} records"
+                )
+                self.__merge_restored(shards)
+                return
+        if bv_params.get("append_histograms", False):
+            binary_file = self.__out_dir / HISTO_BINARY_FILE_NAME
+            if not binary_file.is_file():
+                log.warning(f"nothing to append to, {binary_file} does not exist")
+                return
+            log.info(f"appending the reads of {self.__sam_path} to {binary_file}")
+            self.__merge_restored(get_mut_histos_from_binary_file(str(binary_file)))
+
+    def __merge_restored(self, shards: dict[str, MutationHistogram]) -> None:
+        """Add loaded histograms to the new ones.
+
+        Args:
+            shards: Loaded histograms by reference name
+
+        Raises:
+            ValueError: If a histogram's reference is not in the reference fasta
+        """
+        unknown = sorted(set(shards) - set(self.__mut_histos))
+        if unknown:
+            raise ValueError(
+                f"histograms to resume or append to have references {unknown} "
+                "which are not in the reference fasta"
+            )
+        merge_shards(self.__mut_histos, shards)
+
+    def __checkpoint(self, records: int) -> None:
+        """Write a checkpoint of the histograms after the first records records.
+
+        Args:
+            records: Number of SAM records recorded in the histograms
+        """
+        with self.__stats.timed("checkpoint"):
+            self._accumulator.flush()
+            self.__checkpoint_dir.mkdir(parents=True, exist_ok=True)
+            write_checkpoint(
+                self.__checkpoint_dir, self.__mut_histos, self.__sam_signature, records
             )
-            if not self.__summary_only:
-                if storage_format == StorageFormat.TEXT:
-                    self._bit_vector_writers[ref_name] = create_storage_writer(
-                        storage_format,
-                        self.__out_dir,
-                        name=ref_name,
-                        sequence=seq,
-                        data_type="DMS",
-                        start=1,
-                        end=len(seq),
-                    )
-                else:
-                    # JSON format uses a single writer for all references
-                    if "json_writer" not in self._bit_vector_writers:
-                        self._bit_vector_writers["json_writer"] = create_storage_writer(
-                            storage_format, self.__out_dir
-                        )
+        self.__stats.count("checkpoints")
+
+    def _initialize_accumulator(self) -> None:
+        """Create the accumulator that filters and records bit vectors."""
+        self._stricter = None
+        if self.__params["stricter_bv_constraints"]:
+            self._stricter = StricterConstraints.from_dict(
+                self.__params["bit_vector"].get("stricter_constraints", {})
+            )
+        self._accumulator = HistogramAccumulator(
+            self.__mut_histos,
+            self.__ref_seqs,
+            self.__map_score_cutoff,
+            stricter=self._stricter,
+            on_reject=(
+                self.__write_rejected_bit_vector
+                if self.__rejected_log is not None
+                else None
+            ),
+            count_duplicates=self.__cache is not None,
+        )
 
     def _load_structure_from_csv(self) -> None:
         """Load structure information from CSV file."""
@@ -234,162 +535,114 @@ class BitVectorGenerator:
 
     def _process_all_bit_vectors(self) -> None:
         """Process all bit vectors from iterator."""
-        for bit_vector in self.__bit_vec_iterator:
+        if self.__parallel_job is not None:
+            self._process_parallel()
+            return
+        iterator = self.__bit_vec_iterator
+        records = self.__records_done
+        if records:
+            skip = getattr(iterator, "skip", None)
+            if skip is not None:
+                skip(records)
+            else:
+                for _ in itertools.islice(iterator, records):
+                    pass
+        every = self.__checkpoint_every
+        for bit_vector in iterator:
             self.__record_bit_vector(bit_vector)
-
-    def _save_mutation_histograms(self, pickle_file: Path) -> None:
-        """Save mutation histograms to files.
-
-        Args:
-            pickle_file: Path to pickle file
-        """
-        json_file = os.path.join(self.__out_dir, "mutation_histos.json")
-        write_mut_histos_to_pickle_file(self.__mut_histos, str(pickle_file))
-        write_mut_histos_to_json_file(self.__mut_histos, json_file)
-
-    def __record_bit_vector(self, bit_vector) -> None:
+            records += 1
+            if every and records % every == 0:
+                self.__checkpoint(records)
+        self._accumulator.flush()
+        if self.__cache is not None:
+            self.__cache.report(self.__stats)
+        if self.__ambig_index is not None:
+            self.__ambig_index.report(self.__stats)
+
+    def _process_parallel(self) -> None:
+        """Process the SAM file on a worker pool and merge histogram shards."""
+        sam_path, paired, num_workers = self.__parallel_job
+        results = iter_batch_results(
+            sam_path,
+            self.__ref_seqs,
+            paired,
+            num_workers,
+            self.__map_score_cutoff,
+            stricter=self._stricter,
+            keep_accepted=not self.__summary_only,
+            dense=self.__params["bit_vector"].get("dense_bit_vectors", False),
+            max_memory_mb=self.__params["bit_vector"].get("max_memory_mb"),
+            keep_rejected=self.__rejected_log is not None,
+            cache_size=self.__params["bit_vector"].get("dedup_cache_size", 0),
+            skip_records=self.__records_done,
+            num_of_surbases=self.__params["bit_vector"].get("num_of_surbases", 10),
+        )
+        records = self.__records_done
+        every = self.__checkpoint_every
+        next_checkpoint = records + every
+        for result in results:
+            merge_shards(self.__mut_histos, result.mut_histos)
+            self.__stats.merge(result.stats)
+            for bit_vector, reason in result.rejected:
+                mh = self.__mut_histos[bit_vector.reads[0].rname]
+                self.__write_rejected_bit_vector(mh, bit_vector, reason)
+            start = time.perf_counter()
+            for bit_vector in result.accepted:
+                self.__write_bit_vector(bit_vector)
+            self.__stats.add("storage", time.perf_counter() - start)
+            records += result.num_records
+            if every and records >= next_checkpoint:
+                self.__checkpoint(records)
+                next_checkpoint = records + every
+
+    def _save_mutation_histograms(self) -> None:
+        """Save mutation histograms to files."""
+        # The binary file is what JOIN_MUTATION_HISTOS and reruns read back
+        write_mut_histos_to_binary_file(
+            self.__mut_histos, str(self.__out_dir / HISTO_BINARY_FILE_NAME)
+        )
+        # Pickling every histogram is slow on large panels, as is every count
+        # as a JSON number; both are opt-in only
+        if self.__params["bit_vector"].get("histogram_pickle", False):
+            pickle_file = self.__out_dir / "mutation_histos.p"
+            write_mut_histos_to_pickle_file(self.__mut_histos, str(pickle_file))
+        if self.__params["bit_vector"].get("histogram_json", False):
+            json_file = os.path.join(self.__out_dir, "mutation_histos.json")
+            write_mut_histos_to_json_file(self.__mut_histos, json_file)
+
+    def __record_bit_vector(self, bit_vector: BitVector) -> None:
         """Record a bit vector in mutation histogram.
 
         Args:
             bit_vector: BitVector object to record
         """
-        mh = self.__mut_histos[bit_vector.reads[0].rname]
-        for read in bit_vector.reads:
-            if read.mapq < self.__map_score_cutoff:
-                self.__write_rejected_bit_vector(mh, bit_vector, "low_mapq")
-                mh.record_skip("low_mapq")
-                return
-        if self.__are_reads_to_short(mh, bit_vector):
-            return
-        if self.__too_many_mutations(mh, bit_vector):
-            return
-        if self.__muts_too_close(mh, bit_vector):
+        stats = self.__stats
+        stats.count("reads")
+        rejected_log_seconds = stats.seconds["rejected_log"]
+        start = time.perf_counter()
+        accepted = self._accumulator.add(bit_vector)
+        filtered = time.perf_counter()
+        # rejected reads are logged inside add(); keep that out of "filter"
+        stats.add(
+            "filter",
+            filtered - start - (stats.seconds["rejected_log"] - rejected_log_seconds),
+        )
+        if not accepted:
             return
-        self.__update_mut_histo(mh, bit_vector.data)
-        if not self.__params["bit_vector"]["summary_output_only"]:
-            storage_format_str = self.__params["bit_vector"].get(
-                "storage_format", "text"
-            ).lower()
-            if storage_format_str == "json":
-                writer = self._bit_vector_writers.get("json_writer")
-            else:
-                writer = self._bit_vector_writers.get(bit_vector.reads[0].rname)
-            if writer:
-                writer.write_bit_vector(
-                    bit_vector.reads[0].qname, bit_vector.data, bit_vector.reads
-                )
-
-    def __update_mut_histo(
-        self, mh: MutationHistogram, bit_vector: dict[int, str]
-    ) -> None:
-        """Update mutation histogram with bit vector data.
-
-        Args:
-            mh: MutationHistogram to update
-            bit_vector: Bit vector dictionary
-        """
-        mh.num_reads += 1
-        mh.num_aligned += 1
-        total_muts = 0
-        for pos in mh.get_nuc_coords():
-            if pos not in bit_vector:
-                continue
-            read_bit = bit_vector[pos]
-            if read_bit != self.__bts.ambig_info:
-                mh.cov_bases[pos] += 1
-            if read_bit in self.__bases:
-                total_muts += 1
-                mh.mod_bases[read_bit][pos] += 1
-                mh.mut_bases[pos] += 1
-            elif read_bit == self.__bts.del_bit:
-                mh.del_bases[pos] += 1
-            mh.info_bases[pos] += 1
-        mh.num_of_mutations[total_muts] += 1
-
-    def __are_reads_to_short(self, mh: MutationHistogram, bit_vector) -> bool:
-        """Check if reads are too short.
-
-        Args:
-            mh: MutationHistogram
-            bit_vector: BitVector object
-
-        Returns:
-            True if reads are too short
-        """
-        if not self.__params["stricter_bv_constraints"]:
-            return False
-        cutoff = self.__params["bit_vector"]["stricter_constraints"][
-            "percent_length_cutoff"
-        ]
-        ref_seq = self.__ref_seqs[bit_vector.reads[0].rname]
-        for read in bit_vector.reads:
-            per = len(read.seq) / len(ref_seq)
-            if per < cutoff:
-                self.__write_rejected_bit_vector(mh, bit_vector, "short_read")
-                mh.record_skip("short_read")
-                return True
-        return False
-
-    def __too_many_mutations(self, mh: MutationHistogram, bit_vector) -> bool:
-        """Check if bit vector has too many mutations.
-
-        Args:
-            mh: MutationHistogram
-            bit_vector: BitVector object
+        stats.count("accepted")
+        self.__write_bit_vector(bit_vector)
+        stats.add("storage", time.perf_counter() - filtered)
 
-        Returns:
-            True if too many mutations
-        """
-        if not self.__params["stricter_bv_constraints"]:
-            return False
-        cutoff = self.__params["bit_vector"]["stricter_constraints"][
-            "mutation_count_cutoff"
-        ]
-        muts = 0
-        for pos in mh.get_nuc_coords():
-            if pos not in bit_vector.data:
-                continue
-            read_bit = bit_vector.data[pos]
-            if read_bit in self.__bases:
-                muts += 1
-        if muts > cutoff:
-            self.__write_rejected_bit_vector(mh, bit_vector, "too_many_muts")
-            mh.record_skip("too_many_muts")
-            return True
-        return False
-
-    def __muts_too_close(self, mh: MutationHistogram, bit_vector) -> bool:
-        """Check if mutations are too close together.
+    def __write_bit_vector(self, bit_vector: BitVector) -> None:
+        """Write an accepted bit vector to its storage writer.
 
         Args:
-            mh: MutationHistogram
-            bit_vector: BitVector object
-
-        Returns:
-            True if mutations are too close
+            bit_vector: BitVector object to write
         """
-        if not self.__params["stricter_bv_constraints"]:
-            return False
-        cutoff = self.__params["bit_vector"]["stricter_constraints"]["min_mut_distance"]
-        start = mh.start if mh.start is not None else 1
-        end = mh.end if mh.end is not None else len(mh.sequence)
-        for pos in range(start, end + 1):
-            if pos not in bit_vector.data:
-                continue
-            read_bit = bit_vector.data[pos]
-            if read_bit in self.__bases:
-                for pos2 in range(pos - cutoff, pos + cutoff):
-                    if pos2 == pos:
-                        continue
-                    if pos2 not in bit_vector.data:
-                        continue
-                    if bit_vector.data[pos2] in self.__bases:
-                        self.__write_rejected_bit_vector(
-                            mh, bit_vector, "muts_too_close"
-                        )
-                        mh.record_skip("muts_too_close")
-                        return True
-        return False
+        if self._shared_writer is not None:
+            self._shared_writer.write_bit_vector(
+                bit_vector.reads[0].qname, bit_vector.data, bit_vector.reads
+            )
 
     def __write_rejected_bit_vector(
         self, mh: MutationHistogram, bit_vector, reason: str
@@ -401,18 +654,6 @@ class BitVectorGenerator:
             bit_vector: BitVector object
             reason: Reason for rejection
         """
-        read1 = bit_vector.reads[0]
-        if len(bit_vector.reads) == 2:
-            read2_seq = bit_vector.reads[1].seq
-        else:
-            read2_seq = ""
-        bv_vec = []
-        for nuc in mh.get_nuc_coords():
-            if nuc in bit_vector.data:
-                bv_vec.append(bit_vector.data[nuc])
-            else:
-                bv_vec.append(".")
-        self.__rejected_out.write(
-            f"{read1.qname},{read1.rname},{reason},{read1.seq},{read2_seq},"
-            f"{''.join(bv_vec)}\n"
-        )
+        start = time.perf_counter()
+        self.__rejected_log.add(bit_vector, reason, mh.start, mh.end)
+        self.__stats.add("rejected_log", time.perf_counter() - start)
@@ -0,0 +1,209 @@
+"""Generate bit vectors for many samples against one reference set.
+
+Barcoded libraries align hundreds of samples to the same references. Run
+one sample at a time and every sample parses the FASTA again and starts
+from an empty deletion ambiguity cache. A server parses the FASTA once.
+Each of its long-lived worker processes receives a copy of the reference
+set when it starts and then works through a queue of samples, so the
+worker's own ambiguity cache keeps warming up across the samples it
+processes::
+
+    python -m rna_map.pipeline.bit_vector_server --fasta ref.fa \\
+        --manifest samples.csv --output-dir out --num-workers 8
+
+The manifest is a CSV file with the columns sample_id, sam, paired and an
+optional dot_bracket. The outputs of each sample go to
+<output-dir>/<sample_id>/BitVector_Files.
+"""
+
+import argparse
+import csv
+from dataclasses import dataclass, replace
+import multiprocessing
+from pathlib import Path
+import time
+
+from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
+from rna_map.core.config import BitVectorConfig
+from rna_map.io.fasta import fasta_to_dict
+from rna_map.logger import get_logger
+from rna_map.pipeline.functions import _generate_bit_vectors_python
+from rna_map.pipeline.fused_bit_vectors import add_config_arguments, config_from_args
+
+log = get_logger("PIPELINE.BIT_VECTOR_SERVER")
+
+
+@dataclass
+class SampleJob:
+    """One sample to generate bit vectors for.
+
+    Attributes:
+        sample_id: Name of the sample's output directory
+        sam_path: Path to the sample's SAM file
+        paired: Whether reads are paired-end
+        csv_file: Optional CSV file with structure info
+    """
+
+    sample_id: str
+    sam_path: Path
+    paired: bool
+    csv_file: Path | None = None
+
+
+@dataclass
+class ReferenceSet:
+    """References and lookup tables reused across samples.
+
+    The set is pickled into every pool worker, so each worker fills its
+    own copy of the ambiguity cache; only a single-process server shares
+    one cache among all samples.
+
+    Attributes:
+        fasta: Path to the reference FASTA file
+        ref_seqs: Dictionary of reference sequences
+        ambig_index: Deletion ambiguity cache, filled as samples are processed
+    """
+
+    fasta: Path
+    ref_seqs: dict[str, str]
+    ambig_index: DeletionAmbiguityIndex
+
+    @classmethod
+    def load(cls, fasta: Path, num_of_surbases: int = 10) -> "ReferenceSet":
+        """Load a reference set from a FASTA file.
+
+        Args:
+            fasta: Path to the reference FASTA file
+            num_of_surbases: Number of surrounding bases for ambiguity check
+
+        Returns:
+            ReferenceSet with an empty ambiguity cache
+        """
+        ambig_index = DeletionAmbiguityIndex(num_of_surbases)
+        return cls(fasta, fasta_to_dict(fasta), ambig_index)
+
+
+def read_manifest(path: Path) -> list[SampleJob]:
+    """Read the samples to process from a manifest CSV file.
+
+    Args:
+        path: CSV file with columns sample_id, sam, paired, dot_bracket
+
+    Returns:
+        Sample jobs in file order
+
+    Raises:
+        ValueError: If a sample_id is missing or repeated
+    """
+    jobs = []
+    seen = set()
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            sample_id = (row.get("sample_id") or "").strip()
+            if not sample_id or sample_id in seen:
+                raise ValueError(
+                    f"{path}: missing or duplicate sample_id {sample_id!r}"
+                )
+            seen.add(sample_id)
+            dot_bracket = (row.get("dot_bracket") or "").strip()
+            paired = (row.get("paired") or "").strip().lower()
+            jobs.append(
+                SampleJob(
+                    sample_id=sample_id,
+                    sam_path=Path(row["sam"].strip()),
+                    paired=paired in ("true", "1", "yes"),
+                    csv_file=Path(dot_bracket) if dot_bracket else None,
+                )
+            )
+    return jobs
+
+
+# Per-process server state, set up once by _init_worker
+_worker: dict = {}
+
+
+def _init_worker(
+    references: ReferenceSet, config: BitVectorConfig, output_dir: Path
+) -> None:
+    _worker["references"] = references
+    # Samples are the unit of parallelism, so each one runs single-process
+    _worker["config"] = replace(config, num_workers=1, use_cpp=False)
+    _worker["output_dir"] = output_dir
+
+
+def _run_job(job: SampleJob) -> tuple[str, float]:
+    references: ReferenceSet = _worker["references"]
+    start = time.perf_counter()
+    _generate_bit_vectors_python(
+        job.sam_path,
+        references.fasta,
+        _worker["output_dir"] / job.sample_id,
+        _worker["config"],
+        csv_file=job.csv_file,
+        paired=job.paired,
+        ref_seqs=references.ref_seqs,
+        ambig_index=references.ambig_index,
+    )
+    return job.sample_id, time.perf_counter() - start
+
+
+def serve_samples(
+    jobs: list[SampleJob],
+    references: ReferenceSet,
+    config: BitVectorConfig,
+    output_dir: Path,
+    num_workers: int = 1,
+) -> list[str]:
+    """Generate bit vectors for every sample of a queue.
+
+    Args:
+        jobs: Samples to process
+        references: Reference set shared by all samples
+        config: Bit vector configuration applied to every sample
+        output_dir: Parent directory of the per-sample output directories
+        num_workers: Number of long-lived worker processes
+
+    Returns:
+        Sample ids in the order they finished
+    """
+    done = []
+    if num_workers <= 1 or len(jobs) <= 1:
+        _init_worker(references, config, output_dir)
+        for sample_id, seconds in map(_run_job, jobs):
+            log.info(f"{sample_id}: bit vectors generated in {seconds:.1f}s")
+            done.append(sample_id)
+        return done
+    with multiprocessing.Pool(
+        min(num_workers, len(jobs)),
+        initializer=_init_worker,
+        initargs=(references, config, output_dir),
+    ) as pool:
+        for sample_id, seconds in pool.imap_unordered(_run_job, jobs):
+            log.info(f"{sample_id}: bit vectors generated in {seconds:.1f}s")
+            done.append(sample_id)
+    return done
+
+
+def main(argv: list[str] | None = None) -> None:
+    """Run the bit vector server on a manifest of samples."""
+    parser = argparse.ArgumentParser(
+        description="Generate bit vectors for many samples against one reference"
+    )
+    parser.add_argument("--fasta", type=Path, required=True)
+    parser.add_argument("--manifest", type=Path, required=True)
+    parser.add_argument("--output-dir", type=Path, default=Path("."))
+    add_config_arguments(parser)
+    args = parser.parse_args(argv)
+    jobs = read_manifest(args.manifest)
+    config = config_from_args(args)
+    references = ReferenceSet.load(args.fasta, config.num_of_surbases)
+    log.info(
+        f"serving {len(jobs)} samples against {len(references.ref_seqs)} references"
+    )
+    serve_samples(
+        jobs, references, config, args.output_dir, args.num_workers
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -8,9 +8,11 @@ import os
 from pathlib import Path
 import pickle
 
+from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
 from rna_map.analysis.mutation_histogram import MutationHistogram
 from rna_map.core.config import BitVectorConfig
 from rna_map.core.results import BitVectorResult
+from rna_map.io.histogram_binary import HISTO_BINARY_FILE_NAME, read_histogram_file
 from rna_map.logger import get_logger
 from rna_map.pipeline.bit_vector_generator import BitVectorGenerator
 
@@ -56,6 +58,10 @@ def generate_bit_vectors(
         ... )
         >>> print(result.summary_path)
     """
+    # A pipe (e.g. bowtie2 stdout) can only be read once, so a failed C++
+    # run cannot fall back to Python and results cannot be compared
+    is_stream = not Path(sam_path).is_file()
+
     # Try C++ implementation if requested and available
     if config.use_cpp:
         try:
@@ -80,7 +86,7 @@ def generate_bit_vectors(
             log.info("C++ implementation completed successfully")
             
             # Compare with Python if requested
-            if compare_with_python:
+            if compare_with_python and not is_stream:
                 result_py = _generate_bit_vectors_python(
                     sam_path, fasta, output_dir, config,
                     csv_file, paired, use_stricter_constraints
@@ -91,6 +97,8 @@ def generate_bit_vectors(
         except ImportError as e:
             log.warning(f"C++ implementation requested but not available: {e}, falling back to Python")
         except Exception as e:
+            if is_stream:
+                raise
             log.warning(f"C++ implementation failed: {e}, falling back to Python")
     
     # Use Python implementation
@@ -108,8 +116,14 @@ def _generate_bit_vectors_python(
     csv_file: Path | None = None,
     paired: bool | None = None,
     use_stricter_constraints: bool = False,
+    ref_seqs: dict[str, str] | None = None,
+    ambig_index: DeletionAmbiguityIndex | None = None,
 ) -> BitVectorResult:
-    """Generate bit vectors using Python implementation (internal)."""
+    """Generate bit vectors using Python implementation (internal).
+
+    ref_seqs and ambig_index let callers that process many samples against
+    one reference (see bit_vector_server) load them only once.
+    """
     # Auto-detect paired-end if not specified
     if paired is None:
         # Simple heuristic: check if SAM has paired reads
@@ -145,25 +159,11 @@ def _generate_bit_vectors_python(
         "restore_org_behavior": False,
         "stricter_bv_constraints": use_stricter_constraints,
         "dirs": {"output": str(output_dir)},
-        "bit_vector": {
-            "qscore_cutoff": config.qscore_cutoff,
-            "num_of_surbases": config.num_of_surbases,
-            "map_score_cutoff": config.map_score_cutoff,
-            "plot_sequence": config.plot_sequence,
-            "summary_output_only": config.summary_output_only,
-            "storage_format": config.storage_format.value,
-        },
+        "bit_vector": config.to_params(),
         "restore_org_behavior": False,
         "stricter_bv_constraints": use_stricter_constraints,
     }
 
-    if config.stricter_constraints:
-        params["bit_vector"]["stricter_constraints"] = {
-            "min_mut_distance": config.stricter_constraints.min_mut_distance,
-            "percent_length_cutoff": config.stricter_constraints.percent_length_cutoff,
-            "mutation_count_cutoff": config.stricter_constraints.mutation_count_cutoff,
-        }
-
     # Use existing BitVectorGenerator class (maintains backward compatibility)
     generator = BitVectorGenerator()
     generator.setup(params)
@@ -172,12 +172,18 @@ def _generate_bit_vectors_python(
         fasta=fasta,
         paired=paired,
         csv_file=csv_file if csv_file else Path(""),
+        ref_seqs=ref_seqs,
+        ambig_index=ambig_index,
     )
 
-    # Load mutation histograms from pickle file (generated by BitVectorGenerator)
+    # Load mutation histograms written by BitVectorGenerator; the binary file
+    # is memory mapped, the pickle is only read for older outputs
+    binary_file = bv_dir / HISTO_BINARY_FILE_NAME
     pickle_file = bv_dir / "mutation_histos.p"
     mut_histos: dict[str, MutationHistogram] = {}
-    if pickle_file.exists():
+    if binary_file.exists():
+        mut_histos = read_histogram_file(binary_file)
+    elif pickle_file.exists():
         with open(pickle_file, "rb") as f:
             mut_histos = pickle.load(f)
 
@@ -0,0 +1,143 @@
+"""Generate bit vectors from an alignment stream while the aligner runs.
+
+Reads SAM from stdin (or a named pipe) so bowtie2's output never has to be
+written to disk::
+
+    bowtie2 -x ref -U reads.fq | python -m rna_map.pipeline.fused_bit_vectors \\
+        --fasta ref.fa --output-dir .
+
+``--sam`` reads a SAM file instead, so the unfused workflow runs the same
+command line on bowtie2's aligned.sam.
+
+The stream is read exactly once: pairing must be given on the command line
+and engine failures are raised instead of retried.
+"""
+
+import argparse
+import dataclasses
+import enum
+from pathlib import Path
+import shutil
+import typing
+from typing import Iterator
+
+from rna_map.core.config import BitVectorConfig
+from rna_map.logger import get_logger
+from rna_map.pipeline.functions import generate_bit_vectors
+
+log = get_logger("PIPELINE.FUSED_BIT_VECTORS")
+
+STDIN_PATH = Path("/dev/stdin")
+
+
+# BitVectorConfig fields that are not shared options: each CLI picks its engine
+# and stricter constraints are only read from config files
+_NON_CLI_FIELDS = {"use_cpp", "use_pysam", "stricter_constraints"}
+
+
+def _cli_fields() -> Iterator[tuple[str, type, object]]:
+    """Yield the name, value type and default of each shared config option."""
+    hints = typing.get_type_hints(BitVectorConfig)
+    for field in dataclasses.fields(BitVectorConfig):
+        if field.name in _NON_CLI_FIELDS:
+            continue
+        kind = hints[field.name]
+        # `int | None` takes an int on the command line
+        kind = next((t for t in typing.get_args(kind) if t is not type(None)), kind)
+        yield field.name, kind, field.default
+
+
+def add_config_arguments(parser: argparse.ArgumentParser) -> None:
+    """Add the BitVectorConfig options shared by the bit vector CLIs.
+
+    Every field becomes a flag of the same name with dashes, so a new config
+    option is available on the command line without touching this module.
+
+    Args:
+        parser: Parser to extend
+    """
+    for name, kind, default in _cli_fields():
+        flag = "--" + name.replace("_", "-")
+        if kind is bool:
+            parser.add_argument(
+                flag, action=argparse.BooleanOptionalAction, default=default
+            )
+        elif isinstance(default, enum.Enum):
+            parser.add_argument(
+                flag,
+                type=str.lower,
+                choices=[mode.value for mode in type(default)],
+                default=default.value,
+            )
+        else:
+            parser.add_argument(flag, type=kind, default=default)
+
+
+def config_from_args(
+    args: argparse.Namespace, use_cpp: bool = False
+) -> BitVectorConfig:
+    """Build a BitVectorConfig from options added by add_config_arguments.
+
+    Args:
+        args: Parsed arguments
+        use_cpp: Whether to use the C++ engine
+
+    Returns:
+        Bit vector configuration
+    """
+    values = {}
+    for name, _kind, default in _cli_fields():
+        value = getattr(args, name)
+        if isinstance(default, enum.Enum):
+            value = type(default).parse(value)
+        values[name] = value
+    return BitVectorConfig(use_cpp=use_cpp, **values)
+
+
+def parse_args(argv: list[str] | None = None) -> argparse.Namespace:
+    """Parse command line arguments."""
+    parser = argparse.ArgumentParser(
+        description="Generate bit vectors from a SAM stream"
+    )
+    parser.add_argument("--sam", default="-", help="SAM input ('-' for stdin)")
+    parser.add_argument("--fasta", type=Path, required=True)
+    parser.add_argument("--output-dir", type=Path, default=Path("."))
+    parser.add_argument("--csv", type=Path, default=None, help="Dot-bracket CSV")
+    parser.add_argument("--paired", action="store_true")
+    add_config_arguments(parser)
+    parser.add_argument(
+        "--use-cpp", action="store_true", help="Use the C++ engine if it is built"
+    )
+    parser.add_argument(
+        "--summary-copy", type=Path, default=None,
+        help="Also copy summary.csv to this path",
+    )
+    return parser.parse_args(argv)
+
+
+def main(argv: list[str] | None = None) -> None:
+    """Run bit vector generation on a SAM stream."""
+    args = parse_args(argv)
+    use_cpp = False
+    if args.use_cpp:
+        from rna_map.pipeline import _cpp_bit_vectors
+
+        use_cpp = _cpp_bit_vectors.CPP_AVAILABLE
+        if not use_cpp:
+            log.warning("C++ bit vector module not available, using Python")
+    config = config_from_args(args, use_cpp=use_cpp)
+    sam_path = STDIN_PATH if args.sam == "-" else Path(args.sam)
+    result = generate_bit_vectors(
+        sam_path=sam_path,
+        fasta=args.fasta,
+        output_dir=args.output_dir,
+        config=config,
+        csv_file=args.csv,
+        paired=args.paired,
+    )
+    if args.summary_copy:
+        shutil.copy(result.summary_path, args.summary_copy)
+
+
+if __name__ == "__main__":
+    main()
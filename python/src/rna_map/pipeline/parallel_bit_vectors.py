@@ -0,0 +1,257 @@
+"""Multi-process bit vector generation with per-batch histogram shards.
+
+The main process streams SAM records in fixed-size batches to a worker pool.
+Each worker turns its batch into bit vectors, filters them and fills a fresh
+set of mutation histogram shards. Results are collected in submission order
+and the shards are merged with ``MutationHistogram.merge`` semantics, so the
+histograms and every output file are identical for any number of workers.
+"""
+
+from collections import deque
+from dataclasses import dataclass, field
+import itertools
+import multiprocessing
+from pathlib import Path
+import time
+from typing import Iterator
+
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.analysis.stage_stats import StageStats
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import StricterConstraints
+from rna_map.io.sam_reader import aligned_read_from_fields, iter_sam_fields
+from rna_map.logger import get_logger
+from rna_map.pipeline.streaming import plan_window
+
+log = get_logger("PIPELINE.PARALLEL_BIT_VECTORS")
+
+DEFAULT_BATCH_SIZE = 5000
+
+# Per-process worker state, set up once by _init_worker
+_worker: dict = {}
+
+
+@dataclass
+class BatchResult:
+    """Output of one worker batch.
+
+    Attributes:
+        mut_histos: Histogram shards for the references seen in the batch
+        accepted: Accepted bit vectors, in input order (empty if not kept)
+        rejected: Rejected bit vectors with their rejection reason
+        stats: Time the worker spent in the parse, kernel and filter stages
+        num_records: Number of reads (or mate pairs) in the batch
+    """
+
+    mut_histos: dict[str, MutationHistogram] = field(default_factory=dict)
+    accepted: list[BitVector] = field(default_factory=list)
+    rejected: list[tuple[BitVector, str]] = field(default_factory=list)
+    stats: StageStats = field(default_factory=lambda: StageStats("parallel"))
+    num_records: int = 0
+
+
+def _init_worker(
+    ref_seqs: dict[str, str],
+    paired: bool,
+    map_score_cutoff: int,
+    stricter: StricterConstraints | None,
+    keep_accepted: bool,
+    dense: bool = False,
+    keep_rejected: bool = True,
+    cache_size: int = 0,
+    num_of_surbases: int = 10,
+) -> None:
+    """Set up the bit vector converter of a worker process.
+
+    Args:
+        ref_seqs: Reference sequences by name
+        paired: Whether reads are paired-end
+        map_score_cutoff: Minimum mapping quality for each read
+        stricter: Stricter constraints, or None to disable them
+        keep_accepted: Whether accepted bit vectors are returned for writing
+        dense: Whether to produce DenseBitVector data
+        keep_rejected: Whether rejected bit vectors are returned for logging
+        cache_size: Size of the worker's bit vector cache (0 disables it)
+        num_of_surbases: Number of surrounding bases for ambiguity check
+    """
+    _worker["converter"] = BitVectorIterator(
+        None,
+        ref_seqs,
+        paired,
+        num_of_surbases=num_of_surbases,
+        dense=dense,
+        cache_size=cache_size,
+    )
+    _worker["ref_seqs"] = ref_seqs
+    _worker["map_score_cutoff"] = map_score_cutoff
+    _worker["stricter"] = stricter
+    _worker["keep_accepted"] = keep_accepted
+    _worker["keep_rejected"] = keep_rejected
+
+
+def _process_batch(records: list[list[list[str]]]) -> BatchResult:
+    """Generate, filter and accumulate the bit vectors of one batch.
+
+    Args:
+        records: Split SAM fields of each read or mate pair
+
+    Returns:
+        BatchResult with the histogram shards of this batch
+    """
+    result = BatchResult(num_records=len(records))
+    ref_seqs = _worker["ref_seqs"]
+    cache = _worker["converter"].cache
+
+    def on_reject(mh, bit_vector, reason):
+        result.rejected.append((bit_vector, reason))
+
+    accumulator = HistogramAccumulator(
+        result.mut_histos,
+        ref_seqs,
+        _worker["map_score_cutoff"],
+        stricter=_worker["stricter"],
+        on_reject=on_reject if _worker["keep_rejected"] else None,
+        count_duplicates=cache is not None,
+    )
+    stats = result.stats
+    for record in records:
+        start = time.perf_counter()
+        reads = [aligned_read_from_fields(fields) for fields in record]
+        parsed = time.perf_counter()
+        bit_vector = _worker["converter"].get_bit_vector(reads)
+        converted = time.perf_counter()
+        rname = reads[0].rname
+        if rname not in result.mut_histos:
+            seq = ref_seqs[rname]
+            result.mut_histos[rname] = MutationHistogram(rname, seq, "DMS", 1, len(seq))
+        accepted = accumulator.add(bit_vector)
+        if accepted and _worker["keep_accepted"]:
+            result.accepted.append(bit_vector)
+        stats.add("parse", parsed - start)
+        stats.add("kernel", converted - parsed)
+        stats.add("filter", time.perf_counter() - converted)
+        stats.count("accepted", int(accepted))
+    accumulator.flush()
+    if cache is not None:
+        cache.report(stats)
+    _worker["converter"].ambig_index.report(stats)
+    stats.count("reads", len(records))
+    return result
+
+
+def iter_record_batches(
+    sam_path: Path | str,
+    paired: bool,
+    batch_size: int = DEFAULT_BATCH_SIZE,
+    skip_records: int = 0,
+) -> Iterator[list[list[list[str]]]]:
+    """Group SAM records into batches.
+
+    Args:
+        sam_path: Path to SAM or BAM file
+        paired: Whether reads are paired-end
+        batch_size: Number of reads (or mate pairs) per batch
+        skip_records: Number of leading records to leave out (e.g. the
+            records of a checkpoint)
+
+    Yields:
+        Lists of split SAM records
+    """
+    batch = []
+    records = iter_sam_fields(sam_path, paired)
+    for record in itertools.islice(records, skip_records, None):
+        batch.append(record)
+        if len(batch) == batch_size:
+            yield batch
+            batch = []
+    if batch:
+        yield batch
+
+
+def iter_batch_results(
+    sam_path: Path | str,
+    ref_seqs: dict[str, str],
+    paired: bool,
+    num_workers: int,
+    map_score_cutoff: int,
+    stricter: StricterConstraints | None = None,
+    keep_accepted: bool = True,
+    batch_size: int = DEFAULT_BATCH_SIZE,
+    dense: bool = False,
+    max_memory_mb: int | None = None,
+    keep_rejected: bool = True,
+    cache_size: int = 0,
+    skip_records: int = 0,
+    num_of_surbases: int = 10,
+) -> Iterator[BatchResult]:
+    """Process a SAM file on a worker pool and yield results in input order.
+
+    At most two batches per worker are in flight, so memory stays bounded
+    no matter how large the SAM file is. A memory ceiling lowers the batch
+    size and the number of batches in flight further.
+
+    Args:
+        sam_path: Path to SAM or BAM file
+        ref_seqs: Reference sequences by name
+        paired: Whether reads are paired-end
+        num_workers: Number of worker processes
+        map_score_cutoff: Minimum mapping quality for each read
+        stricter: Stricter constraints, or None to disable them
+        keep_accepted: Whether accepted bit vectors are returned for writing
+        batch_size: Number of reads (or mate pairs) per batch
+        dense: Whether to produce DenseBitVector data
+        max_memory_mb: Memory ceiling for batches in flight, or None
+        keep_rejected: Whether rejected bit vectors are returned for logging
+        cache_size: Size of each worker's bit vector cache (0 disables it)
+        skip_records: Number of leading records to leave out
+        num_of_surbases: Number of surrounding bases for ambiguity check
+
+    Yields:
+        BatchResult for each batch, in the order of the SAM file
+    """
+    log.info(f"generating bit vectors with {num_workers} worker processes")
+    batch_size, max_in_flight = plan_window(
+        max_memory_mb, batch_size, 2 * num_workers
+    )
+    with multiprocessing.Pool(
+        num_workers,
+        initializer=_init_worker,
+        initargs=(
+            ref_seqs,
+            paired,
+            map_score_cutoff,
+            stricter,
+            keep_accepted,
+            dense,
+            keep_rejected,
+            cache_size,
+            num_of_surbases,
+        ),
+    ) as pool:
+        pending: deque = deque()
+        for batch in iter_record_batches(
+            sam_path, paired, batch_size, skip_records
+        ):
+            pending.append(pool.apply_async(_process_batch, (batch,)))
+            if len(pending) >= max_in_flight:
+                yield pending.popleft().get()
+        while pending:
+            yield pending.popleft().get()
+
+
+def merge_shards(
+    mut_histos: dict[str, MutationHistogram],
+    shards: dict[str, MutationHistogram],
+) -> None:
+    """Merge histogram shards into the main histograms.
+
+    Args:
+        mut_histos: Main histograms by reference name (updated in place)
+        shards: Histogram shards by reference name
+    """
+    for name, shard in shards.items():
+        mh = mut_histos[name]
+        shard.structure = mh.structure
+        mh.merge(shard)
@@ -0,0 +1,111 @@
+"""Bounded producer/consumer stages for streaming bit vector generation.
+
+Each stage runs ahead of its consumer by at most a fixed number of batches,
+so the number of reads held in memory is capped no matter how large the
+SAM file is. The cap can be derived from a memory ceiling in megabytes.
+"""
+
+import queue
+import threading
+from typing import Iterable, Iterator, TypeVar
+
+from rna_map.logger import get_logger
+
+log = get_logger("PIPELINE.STREAMING")
+
+T = TypeVar("T")
+
+DEFAULT_QUEUE_DEPTH = 4
+
+# Rough resident size of one read (or mate pair) while it is buffered:
+# its split SAM fields plus the bit vector built from it
+EST_RECORD_BYTES = 16 * 1024
+
+_DONE = object()
+
+# Seconds to wait for the producer thread once the consumer stops early
+_JOIN_TIMEOUT = 1.0
+
+
+def plan_window(
+    max_memory_mb: int | None, batch_size: int, max_batches: int
+) -> tuple[int, int]:
+    """Fit the batch size and number of buffered batches to a memory ceiling.
+
+    Args:
+        max_memory_mb: Memory ceiling for buffered reads, or None for no ceiling
+        batch_size: Requested number of reads per batch
+        max_batches: Requested number of batches buffered at once
+
+    Returns:
+        Tuple of (batch_size, max_batches), never above the requested values
+    """
+    if not max_memory_mb:
+        return batch_size, max_batches
+    max_records = max(1, max_memory_mb * 2**20 // EST_RECORD_BYTES)
+    batch_size = max(1, min(batch_size, max_records // max_batches))
+    max_batches = max(1, min(max_batches, max_records // batch_size))
+    log.debug(
+        f"memory ceiling {max_memory_mb} MB: {max_batches} batches of "
+        f"{batch_size} reads"
+    )
+    return batch_size, max_batches
+
+
+def iter_bounded(items: Iterable[T], depth: int = DEFAULT_QUEUE_DEPTH) -> Iterator[T]:
+    """Produce items on a background thread through a bounded queue.
+
+    The producer blocks once ``depth`` items are waiting, so it never runs
+    more than ``depth`` items ahead of the consumer. Errors raised by the
+    producer are re-raised in the consumer.
+
+    Args:
+        items: Iterable to consume on the background thread
+        depth: Maximum number of items waiting in the queue
+
+    Yields:
+        Items in the order they were produced
+    """
+    buffer: queue.Queue = queue.Queue(maxsize=depth)
+    stop = threading.Event()
+
+    def put(item) -> bool:
+        while not stop.is_set():
+            try:
+                buffer.put(item, timeout=0.1)
+                return True
+            except queue.Full:
+                continue
+        return False
+
+    def produce() -> None:
+        try:
+            for item in items:
+                if not put(item):
+                    return
+        except BaseException as exc:  # re-raised in the consumer
+            put((_DONE, exc))
+            return
+        put((_DONE, None))
+
+    producer = threading.Thread(target=produce, daemon=True)
+    producer.start()
+    try:
+        while True:
+            item = buffer.get()
+            if isinstance(item, tuple) and len(item) == 2 and item[0] is _DONE:
+                if item[1] is not None:
+                    raise item[1]
+                return
+            yield item
+    finally:
+        # The producer may be blocked inside the source and will not see the
+        # stop flag until its next item; it is a daemon thread, so give it a
+        # moment to exit and then drop whatever it left queued
+        stop.set()
+        producer.join(timeout=_JOIN_TIMEOUT)
+        while True:
+            try:
+                buffer.get_nowait()
+            except queue.Empty:
+                break
@@ -0,0 +1,152 @@
+"""Scheduling of the per-reference plots after bit vector generation.
+
+With thousands of references, rendering every plot serially takes longer
+than generating the bit vectors. The scheduler only plots the references
+selected by the plot mode and read threshold, and renders them on a
+process pool. Plots left out can be rendered later from the pop_avg.json
+bundle with render_bundle.
+"""
+
+import multiprocessing
+from pathlib import Path
+from typing import Callable
+
+import pandas as pd
+
+from rna_map.io.plot_bundle import DEFAULT_PLOT_TOP_N, PlotMode, read_plot_bundle
+from rna_map.logger import get_logger
+from rna_map.visualization.plots import plot_population_avg
+
+log = get_logger("VISUALIZATION.PLOT_SCHEDULER")
+
+# A plot function with its positional and keyword arguments
+PlotTask = tuple[Callable, tuple, dict]
+
+
+def select_references(
+    num_aligned: dict[str, int],
+    mode: PlotMode,
+    top_n: int = DEFAULT_PLOT_TOP_N,
+    min_reads: int = 0,
+) -> list[str]:
+    """Select the references to plot.
+
+    Args:
+        num_aligned: Number of aligned reads by reference name
+        mode: Plot mode
+        top_n: In TOP mode, the number of references with the most aligned
+            reads that are plotted
+        min_reads: References with fewer aligned reads are not plotted
+
+    Returns:
+        Selected reference names, in the order of num_aligned
+    """
+    if mode == PlotMode.NONE:
+        return []
+    names = [name for name, n in num_aligned.items() if n >= min_reads]
+    if mode == PlotMode.TOP:
+        top = set(sorted(names, key=lambda name: -num_aligned[name])[:top_n])
+        names = [name for name in names if name in top]
+    return names
+
+
+def pop_avg_dataframe(entry: dict) -> pd.DataFrame:
+    """Build the population average DataFrame of a bundle entry.
+
+    Args:
+        entry: Bundle entry (see rna_map.io.plot_bundle.get_bundle_entries)
+
+    Returns:
+        DataFrame with position, mismatches, mismatch_del and nuc columns,
+        plus structure if the entry has one
+    """
+    df = pd.DataFrame(
+        {
+            "position": list(range(entry["start"], entry["end"] + 1)),
+            "mismatches": entry["mismatches"],
+            "mismatch_del": entry["mismatch_del"],
+            "nuc": list(entry["sequence"]),
+        }
+    )
+    if entry["structure"] is not None:
+        df["structure"] = list(entry["structure"])
+    return df
+
+
+def pop_avg_task(
+    name: str, entry: dict, out_dir: Path | str, plot_sequence: bool = False
+) -> PlotTask:
+    """Get the task that renders the pop_avg plot of a bundle entry.
+
+    Args:
+        name: Reference name
+        entry: Bundle entry
+        out_dir: Output directory
+        plot_sequence: Whether to plot sequence and structure on the x-axis
+
+    Returns:
+        Plot task for render_tasks
+    """
+    fname = f"{out_dir}/{name}_{entry['start']}_{entry['end']}_pop_avg.png"
+    return (
+        plot_population_avg,
+        (pop_avg_dataframe(entry), name, fname),
+        {"plot_sequence": plot_sequence},
+    )
+
+
+def _render(task: PlotTask) -> None:
+    func, args, kwargs = task
+    func(*args, **kwargs)
+
+
+def render_tasks(tasks: list[PlotTask], num_workers: int = 1) -> None:
+    """Render plots, on a process pool if there are several workers.
+
+    Args:
+        tasks: Plot tasks
+        num_workers: Number of worker processes (1 renders in this process,
+            as do pool workers)
+    """
+    num_workers = min(num_workers, len(tasks))
+    # Pool workers (e.g. bit_vector_server samples) cannot start processes
+    if num_workers <= 1 or multiprocessing.current_process().daemon:
+        for task in tasks:
+            _render(task)
+        return
+    log.info(f"rendering {len(tasks)} plots with {num_workers} worker processes")
+    with multiprocessing.Pool(num_workers) as pool:
+        for _ in pool.imap_unordered(_render, tasks):
+            pass
+
+
+def render_bundle(
+    bundle_path: Path | str,
+    out_dir: Path | str,
+    names: list[str] | None = None,
+    num_workers: int = 1,
+    plot_sequence: bool = False,
+) -> list[str]:
+    """Render pop_avg plots from a pop_avg.json bundle.
+
+    Args:
+        bundle_path: Path to the bundle
+        out_dir: Output directory of the plots
+        names: References to plot, all of the bundle if None
+        num_workers: Number of worker processes
+        plot_sequence: Whether to plot sequence and structure on the x-axis
+
+    Returns:
+        Names of the plotted references
+
+    Raises:
+        KeyError: If a requested reference is not in the bundle
+    """
+    entries = read_plot_bundle(bundle_path)
+    if names is None:
+        names = list(entries)
+    tasks = [
+        pop_avg_task(name, entries[name], out_dir, plot_sequence) for name in names
+    ]
+    render_tasks(tasks, num_workers)
+    return names
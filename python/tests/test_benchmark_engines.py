@@ -0,0 +1,34 @@
+"""
+pytest-benchmark harness for the bit vector engines
+
+Run with: pytest tests/test_benchmark_engines.py --benchmark-json=bench.json
+"""
+import pytest
+
+from rna_map.benchmark.runner import ENGINES, _engine_iterator
+from rna_map.benchmark.synthetic_sam import SyntheticSamSpec, write_synthetic_dataset
+from rna_map.io.fasta import fasta_to_dict
+
+pytest.importorskip("pytest_benchmark")
+
+
+@pytest.fixture(scope="module", params=[False, True], ids=["single", "paired"])
+def dataset(request, tmp_path_factory):
+    spec = SyntheticSamSpec(num_reads=2000, paired=request.param)
+    data = write_synthetic_dataset(spec, tmp_path_factory.mktemp("synthetic"))
+    return data, fasta_to_dict(data.fasta), spec.paired
+
+
+@pytest.mark.parametrize("engine", ENGINES)
+def test_engine_throughput(benchmark, dataset, engine):
+    data, ref_seqs, paired = dataset
+    try:
+        _engine_iterator(engine, data.sam, ref_seqs, paired)
+    except ImportError as exc:
+        pytest.skip(str(exc))
+
+    def run():
+        return sum(1 for _ in _engine_iterator(engine, data.sam, ref_seqs, paired))
+
+    benchmark.extra_info["num_bases"] = data.num_bases
+    assert benchmark(run) == 2000
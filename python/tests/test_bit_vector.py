@@ -50,3 +50,69 @@ def test_bit_vector_generator():
     )
     assert result.summary_path.exists()
     shutil.rmtree("output")
+
+
+@pytest.mark.quick
+def test_match_run_vectorized_matches_scalar():
+    """
+    test vectorized match runs give the same symbols as the scalar loop
+    """
+    from rna_map.analysis.bit_vector_iterator import MIN_VECTOR_RUN
+    from rna_map.core.dense_bit_vector import DenseBitVector
+
+    ref_seq = "ACGTACGTACGTACGTACGTACGT"
+    read_seq = "ACGAACGTNCGTACCTACGTAC"
+    q_scores = "IIII#IIIIII+IIIIIIIII5"
+    iterator = BitVectorIterator(None, {"ref": ref_seq}, False)
+    length = len(read_seq)
+    assert length >= MIN_VECTOR_RUN
+    vectorized: dict[int, str] = {}
+    assert iterator._process_match_operation(
+        vectorized, read_seq, q_scores, ref_seq, 2, 0, length
+    ) == (2 + length, length)
+    scalar: dict[int, str] = {}
+    i, j = 2, 0
+    for _ in range(length):
+        i, j = iterator._process_match_operation(
+            scalar, read_seq, q_scores, ref_seq, i, j, 1
+        )
+    assert vectorized == scalar
+    assert list(vectorized) == list(scalar)
+    dense = DenseBitVector(2, length)
+    iterator._process_match_operation(dense, read_seq, q_scores, ref_seq, 2, 0, length)
+    assert dense == scalar
+
+
+@pytest.mark.quick
+def test_md_fast_path_matches_reference_walk():
+    """
+    test reads whose MD tag shows no edits skip the reference comparison
+    """
+    from rna_map.io.sam import AlignedRead
+
+    ref_seq = "ACGTACGTACGTACGTACGTACGT"
+    ref_seqs = {"ref": ref_seq, "low": ref_seq.lower()}
+    for dense in (False, True):
+        iterator = BitVectorIterator(None, ref_seqs, False, dense=dense)
+        for length, qual in ((5, "II#II"), (20, "IIII#IIIIII+IIIIIII5")):
+            seq = ref_seq[2 : 2 + length]
+            cigar = f"{length}M"
+            walked, fast = (
+                iterator.get_bit_vector(
+                    [
+                        AlignedRead(
+                            "q", "0", "ref", 3, 40, cigar, "*", 0, 0, seq, qual, md
+                        )
+                    ]
+                )
+                for md in ("", str(length))
+            )
+            assert fast.data == walked.data
+            assert list(fast.data) == list(walked.data)
+    iterator = BitVectorIterator(None, ref_seqs, False)
+    # the MD tag is trusted over the reference for plain references ...
+    read = AlignedRead("q", "0", "ref", 1, 40, "4M", "*", 0, 0, "TTTT", "IIII", "4")
+    assert iterator.get_bit_vector([read]).data == {1: "0", 2: "0", 3: "0", 4: "0"}
+    # ... but not for references the aligner compares differently
+    read = AlignedRead("q", "0", "low", 1, 40, "4M", "*", 0, 0, "ACGT", "IIII", "4")
+    assert iterator.get_bit_vector([read]).data == {1: "A", 2: "C", 3: "G", 4: "T"}
@@ -0,0 +1,160 @@
+"""
+test the bit vector cache for identical alignments and collapsed writers
+"""
+import json
+
+import pytest
+
+from rna_map.analysis.bit_vector_cache import BitVectorCache
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.analysis.stage_stats import StageStats
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import BitVectorConfig
+from rna_map.core.dense_bit_vector import DenseBitVector
+from rna_map.io.bit_vector_storage import BitVectorStorageWriter, CollapsingWriter
+from rna_map.io.histogram_binary import read_histogram_file
+from rna_map.io.sam import AlignedRead
+from rna_map.pipeline.functions import _generate_bit_vectors_python
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def _read(qname, seq="ACGAACGTAC", qual="IIIIIIIIII", pos=1):
+    return AlignedRead(qname, "0", "ref", pos, 40, "10M", "*", 0, 0, seq, qual, "")
+
+
+def test_cache_key_bins_qualities():
+    cache = BitVectorCache(2, 33 + 25)
+    # only pass/fail against the cutoff matters
+    assert cache.key([_read("a", qual="IIII#IIIII")]) == cache.key(
+        [_read("b", qual="HHHH!HHHHH")]
+    )
+    assert cache.key([_read("a")]) != cache.key([_read("a", qual="IIII#IIIII")])
+    assert cache.key([_read("a")]) != cache.key([_read("a", pos=2)])
+    for key in ("k1", "k2", "k1", "k3"):
+        if cache.get((key,)) is None:
+            cache.put((key,), key)
+    # k2 was the least recently used
+    assert cache.get(("k2",)) is None
+    assert (cache.hits, cache.misses, cache.evictions) == (1, 4, 1)
+    assert len(cache) == 2
+    stats = StageStats()
+    cache.report(stats)
+    cache.report(stats)
+    assert stats.counters["dedup_hits"] == 1
+    assert stats.counters["dedup_misses"] == 4
+    assert stats.to_dict()["dedup_hit_rate"] == pytest.approx(0.2)
+    with pytest.raises(ValueError):
+        BitVectorCache(0, 58)
+
+
+def test_iterator_shares_cached_data():
+    iterator = BitVectorIterator(None, {"ref": REF_SEQ}, False, cache_size=8)
+    uncached = BitVectorIterator(None, {"ref": REF_SEQ}, False)
+    first = iterator.get_bit_vector([_read("a")])
+    second = iterator.get_bit_vector([_read("b", qual="HHHHHHHHHH")])
+    assert second.data is first.data
+    assert second.reads[0].qname == "b"
+    assert first.data == uncached.get_bit_vector([_read("a")]).data
+    assert (iterator.cache.hits, iterator.cache.misses) == (1, 1)
+
+
+@pytest.mark.parametrize("dense", [False, True])
+def test_weighted_record_matches_repeats(dense):
+    data = {1: "0", 2: "A", 3: "1", 4: "?", 5: "C"}
+    if dense:
+        data = DenseBitVector.from_dict(data)
+    names = ["repeated", "weighted", "pending"]
+    mut_histos = {name: MutationHistogram(name, REF_SEQ, "DMS") for name in names}
+    acc = HistogramAccumulator(mut_histos, {}, 0)
+    for _ in range(300):
+        acc.record(mut_histos["repeated"], data)
+    acc.record(mut_histos["weighted"], data, 300)
+    pending = HistogramAccumulator(
+        {"ref": mut_histos["pending"]}, {}, 0, count_duplicates=True, max_pending=1
+    )
+    other = {6: "G"}
+    for i in range(300):
+        assert pending.add(BitVector([_read(f"q{i}")], data))
+    pending.add(BitVector([_read("other")], other))
+    pending.flush()
+    acc.record(mut_histos["weighted"], other)
+    acc.record(mut_histos["repeated"], other)
+    expected = mut_histos["repeated"].get_dict()
+    for name in names[1:]:
+        got = mut_histos[name].get_dict()
+        for key in ("num_reads", "num_aligned", "num_of_mutations", "mut_bases"):
+            assert got[key] == expected[key]
+        assert got["mod_bases"] == expected["mod_bases"]
+
+
+def _write_sam(path, num_copies):
+    lines = []
+    for i in range(num_copies):
+        lines.append(
+            f"a{i}\t0\tref\t1\t40\t10M\t*\t0\t0\tACGAACGTAC\t{'I' * 10}\tAS:i:0\n"
+        )
+        lines.append(
+            f"b{i}\t0\tref\t3\t40\t4M1D5M\t*\t0\t0\tGTACTACGT\t{'I' * 9}\tAS:i:0\n"
+        )
+    lines.append(f"c\t0\tref\t2\t40\t8M\t*\t0\t0\tCGTTCGTA\t{'I' * 8}\tAS:i:0\n")
+    path.write_text(HEADER + "".join(lines))
+
+
+def test_generator_with_cache_and_collapsed_writer(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sam = tmp_path / "aligned.sam"
+    _write_sam(sam, 5)
+    runs = {
+        "plain": BitVectorConfig(),
+        "cached": BitVectorConfig(dedup_cache_size=4, collapse_duplicates=True),
+    }
+    for name, config in runs.items():
+        _generate_bit_vectors_python(sam, fasta, tmp_path / name, config, paired=False)
+    bv_dirs = {name: tmp_path / name / "BitVector_Files" for name in runs}
+    histos = {
+        name: read_histogram_file(bv_dir / "mutation_histos.rmh")["ref"].get_dict()
+        for name, bv_dir in bv_dirs.items()
+    }
+    assert histos["cached"] == histos["plain"]
+    stats = json.loads((bv_dirs["cached"] / "bit_vector_stats.json").read_text())
+    assert stats["counters"]["dedup_hits"] == 8
+    assert stats["counters"]["dedup_misses"] == 3
+    assert "dedup_hit_rate" not in json.loads(
+        (bv_dirs["plain"] / "bit_vector_stats.json").read_text()
+    )
+    plain = (bv_dirs["plain"] / "ref_bitvectors.txt").read_text().splitlines()
+    collapsed = (bv_dirs["cached"] / "ref_bitvectors.txt").read_text().splitlines()
+    assert len(plain) == 3 + 11
+    assert collapsed == plain[:3] + [plain[3], plain[4], plain[13]]
+    counts = (bv_dirs["cached"] / "collapsed_counts.csv").read_text()
+    assert counts == "qname,rname,count\na0,ref,5\nb0,ref,5\nc,ref,1\n"
+
+
+def test_collapsing_writer_flushes_bounded_groups(tmp_path):
+    written = []
+
+    class _ListWriter(BitVectorStorageWriter):
+        def write_bit_vector(self, q_name, bit_vector, reads):
+            written.append((q_name, reads))
+
+        def close(self):
+            pass
+
+    writer = CollapsingWriter(_ListWriter(), tmp_path, max_groups=2)
+    for qname, pos in [("a0", 1), ("b0", 2), ("a1", 1), ("c0", 3), ("a2", 1)]:
+        writer.write_bit_vector(qname, {pos: "0"}, [_read(qname, pos=pos)])
+    writer.write_bit_vector("a3", {1: "0"}, [_read("a3")])
+    writer.close()
+    # the table is flushed at two groups, so the bit vector of "a" repeats
+    assert writer.flushes == 2
+    assert [q_name for q_name, _ in written] == ["a0", "b0", "a1", "c0", "a2"]
+    assert not hasattr(written[0][1][0], "qual")
+    counts = (tmp_path / "collapsed_counts.csv").read_text()
+    assert counts == (
+        "qname,rname,count\na0,ref,1\nb0,ref,1\na1,ref,1\nc0,ref,1\na2,ref,2\n"
+    )
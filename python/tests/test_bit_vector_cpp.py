@@ -105,4 +105,3 @@ def test_cpp_implementation_basic():
     # Check that results were generated
     assert result.summary_path.exists(), "Summary file should be created"
     assert len(result.mutation_histos) > 0, "Mutation histograms should be generated"
-
@@ -0,0 +1,136 @@
+"""
+test generating bit vectors for many samples against one reference set
+"""
+import json
+
+import pytest
+
+from rna_map.core.config import BitVectorConfig
+from rna_map.pipeline.bit_vector_server import (
+    ReferenceSet,
+    main,
+    read_manifest,
+    serve_samples,
+)
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def _write_sample(tmp_path, name, num_reads):
+    sam = tmp_path / f"{name}.sam"
+    sam.write_text(
+        HEADER
+        + "".join(
+            f"r{i}\t0\tref\t1\t40\t3M1D6M\t*\t0\t0\tACGCGTACG\t{'I' * 9}\tAS:i:0\n"
+            for i in range(num_reads)
+        )
+    )
+    return sam
+
+
+def _num_reads(out_dir, sample_id):
+    stats = out_dir / sample_id / "BitVector_Files" / "bit_vector_stats.json"
+    return json.loads(stats.read_text())["reads"]
+
+
+def test_read_manifest(tmp_path):
+    manifest = tmp_path / "samples.csv"
+    manifest.write_text(
+        "sample_id,sam,paired,dot_bracket\n"
+        "s1,a.sam,True,\n"
+        "s2,b.sam,false,db.csv\n"
+    )
+    jobs = read_manifest(manifest)
+    assert [job.sample_id for job in jobs] == ["s1", "s2"]
+    assert jobs[0].paired and not jobs[1].paired
+    assert jobs[0].csv_file is None
+    assert str(jobs[1].csv_file) == "db.csv"
+    manifest.write_text("sample_id,sam,paired\ns1,a.sam,True\ns1,b.sam,True\n")
+    with pytest.raises(ValueError):
+        read_manifest(manifest)
+
+
+def test_serve_samples_shares_references(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sams = {
+        "s1": _write_sample(tmp_path, "s1", 3),
+        "s2": _write_sample(tmp_path, "s2", 4),
+    }
+    manifest = tmp_path / "samples.csv"
+    manifest.write_text(
+        "sample_id,sam,paired\n"
+        + "".join(f"{name},{sam},False\n" for name, sam in sams.items())
+    )
+    references = ReferenceSet.load(fasta)
+    out_dir = tmp_path / "out"
+    done = serve_samples(
+        read_manifest(manifest),
+        references,
+        BitVectorConfig(summary_output_only=True),
+        out_dir,
+    )
+    assert done == ["s1", "s2"]
+    assert _num_reads(out_dir, "s1") == 3
+    assert _num_reads(out_dir, "s2") == 4
+    # histogram JSON is only written when asked for
+    bv_dir = out_dir / "s1" / "BitVector_Files"
+    assert (bv_dir / "mutation_histos.rmh").exists()
+    assert not (bv_dir / "mutation_histos.json").exists()
+    # the deletion seen in s1 is served from the shared cache for s2
+    assert references.ambig_index.misses == 1
+    assert references.ambig_index.hits == 6
+
+
+def test_main(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sam = _write_sample(tmp_path, "s1", 2)
+    manifest = tmp_path / "samples.csv"
+    manifest.write_text(f"sample_id,sam,paired\ns1,{sam},False\n")
+    main(
+        [
+            "--fasta", str(fasta),
+            "--manifest", str(manifest),
+            "--output-dir", str(tmp_path / "out"),
+            "--summary-output-only",
+        ]
+    )
+    assert (tmp_path / "out" / "s1" / "BitVector_Files" / "summary.csv").exists()
+
+
+def test_num_of_surbases_reaches_the_ambiguity_index(tmp_path, monkeypatch):
+    from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
+    from rna_map.pipeline import bit_vector_server
+    from rna_map.pipeline.functions import generate_bit_vectors
+
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sam = _write_sample(tmp_path, "s1", 2)
+    manifest = tmp_path / "samples.csv"
+    manifest.write_text(f"sample_id,sam,paired\ns1,{sam},False\n")
+    served = {}
+    monkeypatch.setattr(
+        bit_vector_server,
+        "serve_samples",
+        lambda jobs, references, config, *args: served.update(
+            references=references, config=config
+        ),
+    )
+    main(["--fasta", str(fasta), "--manifest", str(manifest), "--num-of-surbases", "3"])
+    assert served["config"].num_of_surbases == 3
+    assert served["references"].ambig_index.num_of_surbases == 3
+
+    # the generator hands the configured value to the bit vector iterator
+    created = []
+    init = DeletionAmbiguityIndex.__init__
+
+    def record_init(self, num_of_surbases):
+        created.append(num_of_surbases)
+        init(self, num_of_surbases)
+
+    monkeypatch.setattr(DeletionAmbiguityIndex, "__init__", record_init)
+    config = BitVectorConfig(summary_output_only=True, num_of_surbases=3)
+    generate_bit_vectors(sam, fasta, tmp_path / "out", config, paired=False)
+    assert created == [3]
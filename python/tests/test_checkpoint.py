@@ -0,0 +1,149 @@
+"""
+test checkpointed, resumed and appended bit vector generation
+"""
+import pytest
+
+from rna_map.core.config import BitVectorConfig
+from rna_map.io.checkpoint import (
+    CHECKPOINT_FILE_NAME,
+    get_sam_signature,
+    read_checkpoint,
+    write_checkpoint,
+)
+from rna_map.io.histogram_binary import read_histogram_file, write_histogram_file
+from rna_map.io.rejected_log import RejectedLogMode
+from rna_map.pipeline import bit_vector_generator
+from rna_map.pipeline.functions import _generate_bit_vectors_python
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n"
+SEQS = ["ACGAACGTAC", "ACGTACCTAC", "ACGTACGTAC", "TCGTACGTAA", "ACGTTCGTAC"]
+
+
+def _records(first, last):
+    return "".join(
+        f"r{i}\t0\tref\t{1 + i % 3}\t{40 if i % 4 else 5}\t10M\t*\t0\t0\t"
+        f"{SEQS[i % len(SEQS)]}\t{'I' * 10}\n"
+        for i in range(first, last)
+    )
+
+
+def _run(tmp_path, name, sam, **kwargs):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    config = BitVectorConfig(
+        summary_output_only=True, rejected_log=RejectedLogMode.COUNTS, **kwargs
+    )
+    out_dir = tmp_path / name
+    _generate_bit_vectors_python(sam, fasta, out_dir, config, paired=False)
+    bv_dir = out_dir / "BitVector_Files"
+    return bv_dir, read_histogram_file(bv_dir / "mutation_histos.rmh")["ref"]
+
+
+@pytest.mark.parametrize("num_workers", [1, 2])
+def test_resume_from_checkpoint(tmp_path, num_workers):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 9))
+    _, expected = _run(tmp_path, "full", sam)
+    # the histograms a preempted run saved after 5 records
+    head = tmp_path / "head.sam"
+    head.write_text(HEADER + _records(0, 5))
+    bv_dir, partial = _run(tmp_path, "resumed", head)
+    write_checkpoint(bv_dir, {"ref": partial}, get_sam_signature(sam), 5)
+    bv_dir, resumed = _run(
+        tmp_path, "resumed", sam, resume=True, num_workers=num_workers
+    )
+    assert resumed.get_dict() == expected.get_dict()
+    assert not (bv_dir / CHECKPOINT_FILE_NAME).exists()
+
+
+def test_checkpoint_dir(tmp_path):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 9))
+    _, expected = _run(tmp_path, "full", sam)
+    head = tmp_path / "head.sam"
+    head.write_text(HEADER + _records(0, 5))
+    _, partial = _run(tmp_path, "partial", head)
+    # A retry in a new working directory finds the checkpoint of the first try
+    checkpoint_dir = tmp_path / "checkpoints"
+    checkpoint_dir.mkdir()
+    write_checkpoint(checkpoint_dir, {"ref": partial}, get_sam_signature(sam), 5)
+    _, resumed = _run(
+        tmp_path, "retry", sam, resume=True, checkpoint_dir=str(checkpoint_dir)
+    )
+    assert resumed.get_dict() == expected.get_dict()
+    assert not (checkpoint_dir / CHECKPOINT_FILE_NAME).exists()
+
+
+def test_resume_needs_histogram_only_outputs(tmp_path):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 3))
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    for config in (
+        BitVectorConfig(resume=True, rejected_log=RejectedLogMode.COUNTS),
+        BitVectorConfig(summary_output_only=True, resume=True),
+    ):
+        with pytest.raises(ValueError):
+            _generate_bit_vectors_python(
+                sam, fasta, tmp_path / "out", config, paired=False
+            )
+
+
+def test_checkpoints_written_during_run(tmp_path, monkeypatch):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 7))
+    saved = []
+    write = bit_vector_generator.write_checkpoint
+
+    def record_checkpoint(out_dir, mut_histos, signature, records):
+        write(out_dir, mut_histos, signature, records)
+        histos, num_records = read_checkpoint(out_dir, signature)
+        saved.append((num_records, histos["ref"].num_reads))
+
+    monkeypatch.setattr(bit_vector_generator, "write_checkpoint", record_checkpoint)
+    _run(tmp_path, "out", sam, checkpoint_every=3)
+    assert saved == [(3, 3), (6, 6)]
+
+
+def test_checkpoint_survives_interrupted_write(tmp_path):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 6))
+    bv_dir, expected = _run(tmp_path, "out", sam)
+    signature = get_sam_signature(sam)
+    write_checkpoint(bv_dir, {"ref": expected}, signature, 2)
+    # A job killed after writing the next histograms, before the JSON file
+    write_histogram_file({}, str(bv_dir / "bit_vector_checkpoint.4.rmh"))
+    mut_histos, num_records = read_checkpoint(bv_dir, signature)
+    assert num_records == 2
+    assert mut_histos["ref"].get_dict() == expected.get_dict()
+    # The next checkpoint removes the histograms of older ones
+    write_checkpoint(bv_dir, {"ref": expected}, signature, 6)
+    assert sorted(p.name for p in bv_dir.glob("bit_vector_checkpoint.*.rmh")) == [
+        "bit_vector_checkpoint.6.rmh"
+    ]
+
+
+def test_checkpoint_of_other_sam_is_ignored(tmp_path):
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(HEADER + _records(0, 4))
+    other = tmp_path / "other.sam"
+    other.write_text(HEADER + _records(0, 6))
+    bv_dir, expected = _run(tmp_path, "out", sam)
+    write_checkpoint(bv_dir, {"ref": expected}, get_sam_signature(other), 2)
+    assert read_checkpoint(bv_dir, get_sam_signature(sam)) is None
+    _, resumed = _run(tmp_path, "out", sam, resume=True)
+    assert resumed.get_dict() == expected.get_dict()
+
+
+def test_append_histograms(tmp_path):
+    first = tmp_path / "first.sam"
+    first.write_text(HEADER + _records(0, 5))
+    second = tmp_path / "second.sam"
+    second.write_text(HEADER + _records(5, 11))
+    both = tmp_path / "both.sam"
+    both.write_text(HEADER + _records(0, 11))
+    _, expected = _run(tmp_path, "both", both)
+    _run(tmp_path, "appended", first)
+    _, appended = _run(tmp_path, "appended", second, append_histograms=True)
+    assert appended.get_dict() == expected.get_dict()
@@ -0,0 +1,69 @@
+"""
+test the packed CIGAR decoder and the handling of each CIGAR op
+"""
+import pytest
+
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.core.cigar import (
+    OP_D,
+    OP_H,
+    OP_M,
+    OP_S,
+    format_cigar,
+    last_consuming_op,
+    pack_cigartuples,
+    parse_cigar,
+)
+from rna_map.io.sam import AlignedRead
+
+REF_SEQ = "ACGTACGTACGTACGTACGTACGTACGTAC"
+
+
+def _read(cigar, seq, pos=1, cigar_ops=None):
+    return AlignedRead(
+        "q", "0", "ref", pos, 40, cigar, "*", 0, 0, seq, "I" * len(seq), "",
+        cigar_ops=cigar_ops,
+    )
+
+
+def test_parse_cigar():
+    assert parse_cigar("134M12S") == (134 << 4 | OP_M, 12 << 4 | OP_S)
+    assert parse_cigar("3H5M2D4M") == (
+        3 << 4 | OP_H, 5 << 4 | OP_M, 2 << 4 | OP_D, 4 << 4 | OP_M
+    )
+    for cigar in ("*", ""):
+        assert parse_cigar(cigar) == ()
+    for cigar in ("10M5Z", "M10", "10M5", "10m", "10M 5S"):
+        assert parse_cigar(cigar) is None
+    for cigar in ("10M2I3D4N5S6H7P8=9X", "1M"):
+        assert format_cigar(parse_cigar(cigar)) == cigar
+    # pysam cigartuples use the same op codes
+    assert pack_cigartuples([(4, 3), (0, 10), (5, 2)]) == parse_cigar("3S10M2H")
+    assert pack_cigartuples(None) == ()
+    assert last_consuming_op(parse_cigar("10M5S2H")) == 1
+    assert last_consuming_op(parse_cigar("3H")) == -1
+
+
+@pytest.mark.parametrize("dense", [False, True])
+def test_cigar_ops_in_iterator(dense):
+    iterator = BitVectorIterator(None, {"ref": REF_SEQ}, False, dense=dense)
+
+    def data(read):
+        return dict(iterator.get_bit_vector([read]).data.items())
+
+    seq = "ACGAACGTAC"
+    expected = data(_read("10M", seq))
+    # sequence match / mismatch ops are compared like M
+    assert data(_read("3=1X6=", seq)) == expected
+    # hard clips and padding consume nothing, a trailing soft clip stays
+    assert data(_read("2H10M", seq)) == expected
+    assert data(_read("8M1P2S3H", seq)) == data(_read("8M2S", seq))
+    # skipped reference carries no data
+    spliced = data(_read("4M4N6M", seq))
+    assert [pos for pos in range(1, 15) if pos not in spliced] == [5, 6, 7, 8]
+    assert [spliced[pos] for pos in range(9, 15)] == ["0"] * 6
+    # binary CIGARs from BAM records are used as they are
+    binary = _read("*", seq, cigar_ops=pack_cigartuples([(0, 10)]))
+    assert data(binary) == expected
+    # unknown ops still give an empty bit vector
+    assert data(_read("5M5Z", seq)) == {}
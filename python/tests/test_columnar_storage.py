@@ -0,0 +1,79 @@
+"""
+test columnar binary bit vector storage
+"""
+from rna_map.core.dense_bit_vector import DenseBitVector
+from rna_map.io.bit_vector_storage import StorageFormat, create_storage_writer
+from rna_map.io.columnar_storage import (
+    COLUMNAR_FILE_NAME,
+    ColumnarBitVectorReader,
+    ColumnarStorageWriter,
+    concatenate_columnar_files,
+)
+from rna_map.io.sam import AlignedRead
+
+REF_SEQ = "ACGTACGTAC"
+
+
+def _read(qname, rname="ref", mapq=40, seq=REF_SEQ):
+    return AlignedRead(
+        qname, "0", rname, 1, mapq, "10M", "*", 0, 0, seq, "I" * len(seq), "10"
+    )
+
+
+def test_round_trip(tmp_path):
+    writer = create_storage_writer(
+        StorageFormat.COLUMNAR, tmp_path, references=["ref", "other"]
+    )
+    writer.write_bit_vector(
+        "r1", {3: "0", 2: "A", 5: "1", 7: "?", 8: "*"}, [_read("r1")]
+    )
+    writer.write_bit_vector(
+        "r2",
+        DenseBitVector.from_dict({1: "0", 4: "T", 6: "1"}),
+        [_read("r2", "other", 30), _read("r2", "other", 20, "ACGT")],
+    )
+    writer.write_bit_vector("r3", {1: "0"}, [_read("r3")])
+    writer.close()
+
+    with ColumnarBitVectorReader(tmp_path / COLUMNAR_FILE_NAME) as reader:
+        assert reader.references == ["ref", "other"]
+        assert reader.num_reads == 3
+        records = list(reader)
+        assert [r.qname for r in records] == ["r1", "r2", "r3"]
+        assert records[0].data == {2: "A", 5: "1", 7: "?"}
+        assert records[1].rname == "other"
+        assert (records[1].mapq1, records[1].mapq2) == (30, 20)
+        assert (records[1].read_len1, records[1].read_len2) == (10, 4)
+        assert records[1].data == {4: "T", 6: "1"}
+        assert records[2].data == {}
+        assert [r.qname for r in reader.iter_reference("ref")] == ["r1", "r3"]
+        assert list(reader.iter_reference("missing")) == []
+
+
+def test_chunks_and_concatenate(tmp_path):
+    inputs = []
+    for i, refs in enumerate((["ref"], ["other", "ref"])):
+        out_dir = tmp_path / f"chunk_{i}"
+        out_dir.mkdir()
+        writer = ColumnarStorageWriter(out_dir, refs, chunk_size=2)
+        for j in range(3):
+            writer.write_bit_vector(f"c{i}_r{j}", {j + 1: "G"}, [_read("q")])
+        writer.close()
+        inputs.append(out_dir / COLUMNAR_FILE_NAME)
+
+    with ColumnarBitVectorReader(inputs[0]) as reader:
+        assert len(reader.chunks) == 2
+        assert reader.read_chunk(1)["positions"].tolist() == [3]
+
+    output = tmp_path / "joined.rmbv"
+    concatenate_columnar_files(inputs, output)
+    with ColumnarBitVectorReader(output) as reader:
+        assert reader.references == ["ref", "other"]
+        assert len(reader.chunks) == 4
+        records = list(reader)
+        assert [r.qname for r in records] == [
+            f"c{i}_r{j}" for i in range(2) for j in range(3)
+        ]
+        assert all(r.rname == "ref" for r in records)
+        assert [r.data for r in records[3:]] == [{1: "G"}, {2: "G"}, {3: "G"}]
+        assert len(list(reader.iter_reference("ref"))) == 6
@@ -80,6 +80,8 @@ def test_bit_vector_config_defaults():
     assert config.plot_sequence is False
     assert config.summary_output_only is False
     assert config.stricter_constraints is None
+    assert config.num_workers == 1
+    assert config.max_memory_mb is None
 
 
 def test_bit_vector_config_with_stricter():
@@ -110,8 +112,12 @@ def test_bit_vector_config_from_dict():
         "map_score_cutoff": 20,
         "plot_sequence": True,
         "summary_output_only": True,
+        "num_workers": 4,
+        "max_memory_mb": 2048,
     }
     config = BitVectorConfig.from_dict(data)
+    assert config.num_workers == 4
+    assert config.max_memory_mb == 2048
     assert config.qscore_cutoff == 30
     assert config.num_of_surbases == 15
     assert config.map_score_cutoff == 20
@@ -151,6 +157,22 @@ def test_bit_vector_config_from_dict_stricter_disabled():
     assert config.stricter_constraints is None
 
 
+def test_bit_vector_config_to_params_round_trip():
+    """Test BitVectorConfig.to_params() is read back by from_dict()."""
+    config = BitVectorConfig(
+        qscore_cutoff=30,
+        num_of_surbases=4,
+        num_workers=2,
+        stricter_constraints=StricterConstraints(min_mut_distance=3),
+    )
+    params = config.to_params()
+    assert params["num_of_surbases"] == 4
+    assert params["storage_format"] == config.storage_format.value
+    assert params["stricter_constraints"]["min_mut_distance"] == 3
+    assert BitVectorConfig.from_dict(params, use_stricter=True) == config
+    assert "stricter_constraints" not in BitVectorConfig().to_params()
+
+
 def test_stricter_constraints_defaults():
     """Test StricterConstraints with default values."""
     constraints = StricterConstraints()
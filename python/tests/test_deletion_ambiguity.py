@@ -0,0 +1,41 @@
+"""
+test deletion ambiguity index
+"""
+from rna_map.analysis.deletion_ambiguity import DeletionAmbiguityIndex
+from rna_map.analysis.stage_stats import StageStats
+
+REF_SEQ = "GCTAGCTAGCATACGTAAAAACGTCCGATGCATCGATCGTAGC"
+
+
+def test_is_ambiguous():
+    index = DeletionAmbiguityIndex(10)
+    # single deletions inside the AAAAA homopolymer and the CC repeat
+    assert index.is_ambiguous(REF_SEQ, 19, 1)
+    assert index.is_ambiguous(REF_SEQ, 26, 1)
+    assert not index.is_ambiguous(REF_SEQ, 23, 1)
+    assert not index.is_ambiguous(REF_SEQ, 30, 2)
+
+
+def test_cache_matches_uncached():
+    index = DeletionAmbiguityIndex(10)
+    for _ in range(2):
+        for i in range(12, 34):
+            for length in (1, 2, 3):
+                assert index.is_ambiguous(REF_SEQ, i, length) == (
+                    index.calc_ambiguity(REF_SEQ, i, length)
+                )
+    assert index.misses == 22 * 3
+    assert index.hits == 22 * 3
+
+
+def test_report_adds_lookups_since_last_report():
+    index = DeletionAmbiguityIndex(10)
+    stats = StageStats()
+    index.is_ambiguous(REF_SEQ, 19, 1)
+    index.is_ambiguous(REF_SEQ, 19, 1)
+    index.report(stats)
+    index.is_ambiguous(REF_SEQ, 19, 1)
+    index.report(stats)
+    index.report(stats)
+    assert stats.counters["ambig_hits"] == 2
+    assert stats.counters["ambig_misses"] == 1
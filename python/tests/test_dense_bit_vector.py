@@ -0,0 +1,142 @@
+"""
+test dense bit vector representation
+"""
+import pickle
+import random
+
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import StricterConstraints
+from rna_map.core.dense_bit_vector import (
+    CONFLICT_TABLE,
+    SYMBOLS,
+    UNRESOLVED_CONFLICTS,
+    DenseBitVector,
+    get_bit_string,
+    merge_dense_bit_vectors,
+)
+from rna_map.io.bit_vector_storage import TextStorageWriter
+from rna_map.io.sam import AlignedRead
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def _sam_line(qname, flag, pos, cigar, seq, rnext="*", pnext=0, qual=None):
+    qual = qual or "I" * len(seq)
+    return (
+        f"{qname}\t{flag}\tref\t{pos}\t40\t{cigar}\t{rnext}\t{pnext}\t0\t"
+        f"{seq}\t{qual}\tAS:i:0\n"
+    )
+
+
+def _write_sam(path, lines):
+    path.write_text(HEADER + "".join(lines))
+
+
+def test_dense_bit_vector_mapping():
+    data = {3: "0", 4: "A", 5: "1", 7: "?"}
+    dense = DenseBitVector.from_dict(data)
+    assert dense.start == 3
+    assert dense.end == 7
+    assert len(dense) == 4
+    assert dense == data
+    assert 6 not in dense
+    assert dense.get(6) is None
+    assert list(dense) == [3, 4, 5, 7]
+    assert dense.get_bit_string(1, 8) == "..0A1.?."
+    assert get_bit_string(data, 1, 8) == "..0A1.?."
+    assert dense.mutation_positions(1, 20).tolist() == [4]
+    assert pickle.loads(pickle.dumps(dense)) == data
+
+
+def test_merge_dense_bit_vectors():
+    bv_1 = DenseBitVector.from_dict({1: "0", 2: "A", 3: "?"})
+    bv_2 = DenseBitVector.from_dict({2: "0", 3: "C", 4: "1"})
+    merged = merge_dense_bit_vectors(bv_1, bv_2)
+    assert merged == {1: "0", 2: "0", 3: "C", 4: "1"}
+    # resolve is only asked about pairs without a rule
+    bv_1 = DenseBitVector.from_dict({1: "N", 2: "A"})
+    bv_2 = DenseBitVector.from_dict({1: "C", 2: "G"})
+    merged = merge_dense_bit_vectors(bv_1, bv_2, lambda b1, b2: "*")
+    assert merged == {1: "*", 2: "?"}
+
+
+def test_conflict_table_matches_resolve_bit_conflict():
+    iterator = BitVectorIterator(None, {"ref": REF_SEQ}, True)
+    for code_1, bit1 in enumerate(SYMBOLS[1:], 1):
+        for code_2, bit2 in enumerate(SYMBOLS[1:], 1):
+            if bit1 == bit2:
+                continue
+            expected = iterator._resolve_bit_conflict(bit1, bit2)
+            assert SYMBOLS[CONFLICT_TABLE[code_1, code_2]] == expected
+            # only N against a base or a deletion has no rule
+            unresolved = "N" in (bit1, bit2) and not {bit1, bit2} & set("0?*")
+            assert UNRESOLVED_CONFLICTS[code_1, code_2] == unresolved
+
+
+def test_dense_iterator_matches_dict(tmp_path):
+    sam_path = tmp_path / "paired.sam"
+    _write_sam(
+        sam_path,
+        [
+            _sam_line("r1", 99, 1, "10M", "ACGAACGTAC", "=", 6),
+            _sam_line("r1", 147, 6, "2S4M2D4M", "TTCGTACGTA", "=", 1),
+            _sam_line("r2", 99, 2, "8M2S", "CGTACCTAGG", "=", 4, "IIII#IIIII"),
+            _sam_line("r2", 147, 4, "10M", "TACGTACGTA", "=", 2),
+        ],
+    )
+    ref_seqs = {"ref": REF_SEQ}
+    dict_bvs = list(BitVectorIterator(sam_path, ref_seqs, True))
+    dense_bvs = list(BitVectorIterator(sam_path, ref_seqs, True, dense=True))
+    assert len(dense_bvs) == 2
+    for bv_dict, bv_dense in zip(dict_bvs, dense_bvs):
+        assert isinstance(bv_dense.data, DenseBitVector)
+        assert bv_dense.data == bv_dict.data
+
+
+def test_dense_histogram_and_writer_match_dict(tmp_path):
+    data = {1: "0", 2: "A", 3: "1", 4: "?", 5: "*", 6: "N", 7: "T"}
+    histos = []
+    for bit_vector in (data, DenseBitVector.from_dict(data)):
+        mh = MutationHistogram("ref", REF_SEQ, "DMS", 1, len(REF_SEQ))
+        HistogramAccumulator({"ref": mh}, {"ref": REF_SEQ}, 0).record(mh, bit_vector)
+        histos.append(mh)
+    mh_dict, mh_dense = histos
+    assert mh_dense.num_of_mutations == mh_dict.num_of_mutations
+    for attr in ("mut_bases", "info_bases", "del_bases", "cov_bases"):
+        assert list(getattr(mh_dense, attr)) == list(getattr(mh_dict, attr))
+    for base in "ACGT":
+        assert list(mh_dense.mod_bases[base]) == list(mh_dict.mod_bases[base])
+
+    lines = []
+    for name, bit_vector in (("dict", data), ("dense", DenseBitVector.from_dict(data))):
+        writer = TextStorageWriter(tmp_path, name, REF_SEQ, "DMS", 1, len(REF_SEQ))
+        writer.write_bit_vector("r1", bit_vector, [])
+        writer.close()
+        lines.append((tmp_path / f"{name}_bitvectors.txt").read_text())
+    assert lines[0] == lines[1]
+
+
+def test_dense_rejection_reasons_match_dict():
+    rng = random.Random(1)
+    read = AlignedRead(
+        "r1", "0", "ref", 1, 40, "20M", "*", 0, 0, REF_SEQ, "I" * 20, "20"
+    )
+    stricter = StricterConstraints(
+        min_mut_distance=3, percent_length_cutoff=0.0, mutation_count_cutoff=4
+    )
+    mh = MutationHistogram("ref", REF_SEQ, "DMS", 3, 18)
+    acc = HistogramAccumulator({"ref": mh}, {"ref": REF_SEQ}, 0, stricter=stricter)
+    for _ in range(300):
+        start = rng.randint(1, 10)
+        data = {
+            pos: rng.choice("00000ACGT1?")
+            for pos in range(start, rng.randint(start, len(REF_SEQ)) + 1)
+        }
+        dense = DenseBitVector.from_dict(data)
+        assert acc.get_rejection_reason(
+            mh, BitVector([read], dense)
+        ) == acc.get_rejection_reason(mh, BitVector([read], data))
@@ -0,0 +1,127 @@
+"""
+test splitting FASTQ files into chunks
+"""
+import gzip
+
+import pytest
+
+from rna_map.io import fastq_splitter
+from rna_map.io.fastq_splitter import FastqRecordReader, split_fastq
+
+
+def _records(prefix, n):
+    return [f"@{prefix}{i}\nACGT{i % 10}\n+\nIIIII\n".encode() for i in range(n)]
+
+
+def _write(path, records, gz):
+    data = b"".join(records)
+    if gz:
+        with gzip.open(path, "wb") as f:
+            f.write(data)
+    else:
+        path.write_bytes(data)
+
+
+def _read(path):
+    if path.suffix == ".gz":
+        with gzip.open(path, "rb") as f:
+            return f.read()
+    return path.read_bytes()
+
+
+def test_record_reader_cuts_on_record_boundaries(tmp_path):
+    path = tmp_path / "reads.fastq"
+    records = _records("r", 10)
+    _write(path, records, False)
+    with open(path, "rb") as f:
+        # a tiny block size forces records to straddle blocks
+        reader = FastqRecordReader(f, block_size=7)
+        assert reader.read_records(3) == (b"".join(records[:3]), 3)
+        assert reader.read_records(100) == (b"".join(records[3:]), 7)
+        assert reader.read_records(1) == (b"", 0)
+
+
+def test_record_reader_rejects_truncated_file(tmp_path):
+    path = tmp_path / "reads.fastq"
+    path.write_bytes(b"".join(_records("r", 2)) + b"@r2\nACGT\n")
+    with open(path, "rb") as f:
+        with pytest.raises(ValueError):
+            FastqRecordReader(f).read_records(10)
+
+
+@pytest.mark.parametrize("use_pigz", [False, True])
+def test_split_paired_gz_in_lockstep(tmp_path, monkeypatch, use_pigz):
+    if use_pigz and not fastq_splitter._has_pigz():
+        pytest.skip("pigz is not installed")
+    monkeypatch.setattr(fastq_splitter, "_has_pigz", lambda: use_pigz)
+    monkeypatch.setattr(fastq_splitter, "BATCH_RECORDS", 3)
+    r1, r2 = _records("a", 25), _records("b", 25)
+    _write(tmp_path / "r1.fastq.gz", r1, True)
+    _write(tmp_path / "r2.fastq.gz", r2, True)
+    out = tmp_path / "chunks"
+    num_chunks = split_fastq(
+        tmp_path / "r1.fastq.gz", out, 10, fastq2=tmp_path / "r2.fastq.gz"
+    )
+    assert num_chunks == 3
+    for i, (start, end) in enumerate([(0, 10), (10, 20), (20, 25)]):
+        assert _read(out / f"chunk_{i}_1.fastq.gz") == b"".join(r1[start:end])
+        assert _read(out / f"chunk_{i}_2.fastq.gz") == b"".join(r2[start:end])
+
+
+def test_split_single_end_exact_multiple(tmp_path):
+    records = _records("r", 20)
+    _write(tmp_path / "r.fastq", records, False)
+    num_chunks = split_fastq(tmp_path / "r.fastq", tmp_path / "chunks", 10)
+    # no empty trailing chunk
+    assert num_chunks == 2
+    assert sorted(p.name for p in (tmp_path / "chunks").iterdir()) == [
+        "chunk_0.fastq",
+        "chunk_1.fastq",
+    ]
+
+
+def test_split_uncompressed_chunks(tmp_path):
+    records = _records("r", 5)
+    _write(tmp_path / "r.fastq.gz", records, True)
+    split_fastq(tmp_path / "r.fastq.gz", tmp_path / "chunks", 10, compress_level=0)
+    assert (tmp_path / "chunks" / "chunk_0.fastq").read_bytes() == b"".join(records)
+
+
+def test_split_mismatched_mates(tmp_path):
+    _write(tmp_path / "r1.fastq", _records("a", 5), False)
+    _write(tmp_path / "r2.fastq", _records("b", 4), False)
+    with pytest.raises(ValueError):
+        split_fastq(
+            tmp_path / "r1.fastq", tmp_path / "chunks", 10, fastq2=tmp_path / "r2.fastq"
+        )
+
+
+@pytest.mark.parametrize("gz", [False, True])
+def test_estimate_num_reads(tmp_path, monkeypatch, gz):
+    path = tmp_path / ("r.fastq.gz" if gz else "r.fastq")
+    _write(path, _records("r", 1000), gz)
+    assert fastq_splitter.estimate_num_reads(path) == 1000
+    if not gz:
+        # Scaled from a sample of the first records
+        monkeypatch.setattr(fastq_splitter, "ESTIMATE_SAMPLE_BYTES", 2000)
+        assert 500 < fastq_splitter.estimate_num_reads(path) < 2000
+
+
+def test_adaptive_chunk_size():
+    chunk_size = fastq_splitter.adaptive_chunk_size
+    # Even share across executors
+    assert chunk_size(10_000_000, 8, 600, 20000, 1000) == 1_250_000
+    # Capped by the target runtime per task
+    assert chunk_size(100_000_000, 8, 600, 20000, 1000) == 12_000_000
+    # Small inputs are not split below the minimum
+    assert chunk_size(5000, 8, 600, 20000, 1000) == 1000
+
+
+def test_main_auto_chunk_size(tmp_path, monkeypatch):
+    _write(tmp_path / "r.fastq", _records("r", 10), False)
+    monkeypatch.chdir(tmp_path)
+    fastq_splitter.main(
+        ["--fastq1", "r.fastq", "--chunk-size", "auto", "--executors", "3",
+         "--min-chunk-size", "1"]
+    )
+    assert (tmp_path / "chunk_count.txt").read_text() == "3"
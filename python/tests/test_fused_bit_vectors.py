@@ -0,0 +1,94 @@
+"""
+test streaming bit vector generation from an aligner pipe
+"""
+import argparse
+import json
+import os
+import threading
+
+from rna_map.core.config import BitVectorConfig
+from rna_map.io.bowtie2_log import parse_bowtie2_log
+from rna_map.io.plot_bundle import PlotMode
+from rna_map.pipeline.fused_bit_vectors import (
+    add_config_arguments,
+    config_from_args,
+    main,
+)
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+BOWTIE2_PAIRED_LOG = """10000 reads; of these:
+  10000 (100.00%) were paired; of these:
+    1000 (10.00%) aligned concordantly 0 times
+    8500 (85.00%) aligned concordantly exactly 1 time
+    500 (5.00%) aligned concordantly >1 times
+    ----
+    1000 pairs aligned concordantly 0 times; of these:
+      100 (10.00%) aligned discordantly 1 time
+92.50% overall alignment rate
+"""
+
+
+def test_parse_bowtie2_log():
+    stats = parse_bowtie2_log(BOWTIE2_PAIRED_LOG, True)
+    assert stats["total_reads"] == 10000
+    assert stats["concordant_0_times"] == 1000
+    assert stats["concordant_1_time"] == 8500
+    assert stats["concordant_multiple_percent"] == 5.0
+    assert stats["discordant_alignments"] == 100
+    assert stats["overall_alignment_rate"] == 92.5
+    assert "concordant_0_times" not in parse_bowtie2_log(BOWTIE2_PAIRED_LOG, False)
+
+
+def test_bit_vectors_from_pipe(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sam_text = HEADER + "".join(
+        f"r{i}\t0\tref\t1\t40\t10M\t*\t0\t0\tACGAACGTAC\t{'I' * 10}\tAS:i:0\n"
+        for i in range(5)
+    )
+    fifo = tmp_path / "aligned.fifo"
+    os.mkfifo(fifo)
+
+    def align():
+        with open(fifo, "w") as f:
+            f.write(sam_text)
+
+    aligner = threading.Thread(target=align)
+    aligner.start()
+    main(
+        [
+            "--sam", str(fifo),
+            "--fasta", str(fasta),
+            "--output-dir", str(tmp_path / "out"),
+            "--summary-output-only",
+            "--summary-copy", str(tmp_path / "summary.csv"),
+        ]
+    )
+    aligner.join()
+    assert (tmp_path / "summary.csv").exists()
+    stats_path = tmp_path / "out" / "BitVector_Files" / "bit_vector_stats.json"
+    assert json.loads(stats_path.read_text())["reads"] == 5
+
+
+def test_config_arguments_cover_every_option():
+    parser = argparse.ArgumentParser()
+    add_config_arguments(parser)
+    assert config_from_args(parser.parse_args([])) == BitVectorConfig()
+    args = parser.parse_args(
+        [
+            "--num-of-surbases", "4",
+            "--max-memory-mb", "512",
+            "--collapse-duplicates",
+            "--plot-mode", "TOP",
+            "--checkpoint-dir", "ckpt",
+        ]
+    )
+    config = config_from_args(args, use_cpp=True)
+    assert config.num_of_surbases == 4
+    assert config.max_memory_mb == 512
+    assert config.collapse_duplicates is True
+    assert config.plot_mode is PlotMode.TOP
+    assert config.checkpoint_dir == "ckpt"
+    assert config.use_cpp is True
@@ -0,0 +1,98 @@
+"""
+test histogram accumulator
+"""
+import random
+
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import StricterConstraints
+from rna_map.io.sam import AlignedRead
+
+REF_SEQ = "ACGTACGTAC"
+
+
+def _read(mapq=40, seq=REF_SEQ):
+    return AlignedRead(
+        "r1", "0", "ref", 1, mapq, "10M", "*", 0, 0, seq, "I" * len(seq), "10"
+    )
+
+
+def _accumulator(stricter=None, rejected=None):
+    mut_histos = {"ref": MutationHistogram("ref", REF_SEQ, "DMS", 1, len(REF_SEQ))}
+
+    def on_reject(mh, bit_vector, reason):
+        rejected.append(reason)
+
+    return HistogramAccumulator(
+        mut_histos,
+        {"ref": REF_SEQ},
+        20,
+        stricter=stricter,
+        on_reject=on_reject if rejected is not None else None,
+    )
+
+
+def test_record_bit_vector():
+    acc = _accumulator()
+    data = {1: "0", 2: "A", 3: "1", 4: "?"}
+    assert acc.add(BitVector([_read()], data))
+    mh = acc.mut_histos["ref"]
+    assert mh.num_reads == 1
+    assert mh.num_aligned == 1
+    assert mh.cov_bases[1] == 1 and mh.cov_bases[4] == 0
+    assert mh.info_bases[4] == 1
+    assert mh.mut_bases[2] == 1
+    assert mh.mod_bases["A"][2] == 1
+    assert mh.del_bases[3] == 1
+    assert mh.num_of_mutations[1] == 1
+
+
+def test_reject_low_mapq():
+    rejected = []
+    acc = _accumulator(rejected=rejected)
+    assert not acc.add(BitVector([_read(mapq=5)], {1: "A"}))
+    mh = acc.mut_histos["ref"]
+    assert rejected == ["low_mapq"]
+    assert mh.skips["low_mapq"] == 1
+    assert mh.num_reads == 1
+    assert mh.num_aligned == 0
+
+
+def test_reject_stricter_constraints():
+    stricter = StricterConstraints(
+        min_mut_distance=3, percent_length_cutoff=0.5, mutation_count_cutoff=2
+    )
+    rejected = []
+    acc = _accumulator(stricter=stricter, rejected=rejected)
+    acc.add(BitVector([_read(seq="ACG")], {1: "0"}))
+    acc.add(BitVector([_read()], {1: "A", 5: "C", 9: "G"}))
+    acc.add(BitVector([_read()], {1: "A", 3: "C"}))
+    assert acc.add(BitVector([_read()], {1: "A", 5: "C"}))
+    assert rejected == ["short_read", "too_many_muts", "muts_too_close"]
+
+
+def _legacy_muts_too_close(data, start, end, cutoff):
+    bases = ("A", "C", "G", "T")
+    mut_positions = [p for p, bit in data.items() if start <= p <= end and bit in bases]
+    for pos in sorted(mut_positions):
+        for pos2 in range(pos - cutoff, pos + cutoff):
+            if pos2 != pos and data.get(pos2) in bases:
+                return True
+    return False
+
+
+def test_muts_too_close_matches_per_position_probe():
+    rng = random.Random(0)
+    ref_seq = "ACGT" * 10
+    for cutoff in (0, 1, 2, 4):
+        stricter = StricterConstraints(
+            min_mut_distance=cutoff, percent_length_cutoff=0.0, mutation_count_cutoff=40
+        )
+        mh = MutationHistogram("ref", ref_seq, "DMS", 5, 35)
+        acc = HistogramAccumulator({"ref": mh}, {"ref": ref_seq}, 0, stricter=stricter)
+        for _ in range(300):
+            data = {pos: rng.choice("0000ACGT1?") for pos in range(1, len(ref_seq) + 1)}
+            expected = _legacy_muts_too_close(data, mh.start, mh.end, cutoff)
+            reason = acc.get_rejection_reason(mh, BitVector([_read(seq=ref_seq)], data))
+            assert (reason == "muts_too_close") == expected
@@ -0,0 +1,134 @@
+"""
+test binary mutation histogram files
+"""
+import struct
+
+import pytest
+
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.io.histogram_binary import (
+    COUNT_ROWS,
+    HistogramFile,
+    merge_histogram_files,
+    read_histogram_file,
+    write_histogram_file,
+)
+
+
+def _histogram(name, sequence, scale):
+    mh = MutationHistogram(name, sequence, "DMS")
+    mh.structure = "." * len(sequence)
+    mh.num_reads = 3 * scale
+    mh.num_aligned = 2 * scale
+    mh.skips["low_mapq"] = scale
+    mh.num_of_mutations[1] = 2 * scale
+    for pos in range(1, len(sequence) + 1):
+        mh.info_bases[pos] = 2 * scale
+        mh.cov_bases[pos] = 2 * scale
+    mh.mut_bases[2] = scale
+    mh.mod_bases["C"][2] = scale
+    mh.del_bases[3] = scale
+    return mh
+
+
+def test_round_trip(tmp_path):
+    mh = _histogram("seq1", "ACGTACGT", 1)
+    path = tmp_path / "mutation_histos.rmh"
+    write_histogram_file({"seq1": mh}, path)
+    loaded = read_histogram_file(path)["seq1"]
+    assert loaded.get_dict() == mh.get_dict()
+
+
+def test_lookup_by_name(tmp_path):
+    histos = {
+        name: _histogram(name, "ACGT" * (i + 1), i + 1)
+        for i, name in enumerate(["seq1", "seq2", "seq3"])
+    }
+    histos["empty"] = MutationHistogram("empty", "ACGT", "DMS")
+    path = tmp_path / "mutation_histos.rmh"
+    write_histogram_file(histos, path)
+    histo_file = HistogramFile(path)
+    assert histo_file.names == ["seq1", "seq2", "seq3", "empty"]
+    assert "seq2" in histo_file and "seq4" not in histo_file
+    assert histo_file.get("seq3").get_dict() == histos["seq3"].get_dict()
+    assert histo_file.get("empty").get_dict() == histos["empty"].get_dict()
+    # loaded counts are writable without changing the file
+    mh = histo_file.get("seq2")
+    mh.mut_bases[2] += 10
+    assert HistogramFile(path).get("seq2").mut_bases[2] == 2
+
+
+def test_from_dict_count_block():
+    mh = _histogram("seq1", "ACGT", 1)
+    d = {key: value for key, value in mh.get_dict().items() if key != "mut_bases"}
+    d["counts"] = mh.counts
+    loaded = MutationHistogram.from_dict(d)
+    assert loaded.get_dict() == mh.get_dict()
+    d["counts"] = mh.counts[:, :3]
+    with pytest.raises(ValueError):
+        MutationHistogram.from_dict(d)
+
+
+def test_merge_files(tmp_path):
+    paths = []
+    for i in range(3):
+        histos = {"seq1": _histogram("seq1", "ACGTACGT", i + 1)}
+        if i == 1:
+            histos["seq2"] = _histogram("seq2", "GGCC", 5)
+        paths.append(tmp_path / f"chunk_{i}.rmh")
+        write_histogram_file(histos, paths[-1])
+    merged = merge_histogram_files(paths)
+    assert sorted(merged) == ["seq1", "seq2"]
+    assert merged["seq1"].num_reads == 3 * 6
+    assert merged["seq1"].skips["low_mapq"] == 6
+    assert merged["seq1"].num_of_mutations[1] == 12
+    assert merged["seq1"].mod_bases["C"][2] == 6
+    assert merged["seq1"].del_bases[3] == 6
+    assert merged["seq2"].num_aligned == 10
+
+
+def test_merge_mismatched_sequences(tmp_path):
+    write_histogram_file({"seq1": _histogram("seq1", "ACGT", 1)}, tmp_path / "a.rmh")
+    write_histogram_file({"seq1": _histogram("seq1", "ACGA", 1)}, tmp_path / "b.rmh")
+    with pytest.raises(ValueError):
+        merge_histogram_files([tmp_path / "a.rmh", tmp_path / "b.rmh"])
+
+
+def test_rejects_other_files(tmp_path):
+    path = tmp_path / "bad.rmh"
+    path.write_bytes(struct.pack("<4sII", b"XXXX", 1, 0))
+    with pytest.raises(ValueError):
+        read_histogram_file(path)
+    write_histogram_file({"seq1": _histogram("seq1", "ACGT", 1)}, path)
+    path.write_bytes(path.read_bytes()[:-8])
+    with pytest.raises(ValueError):
+        read_histogram_file(path)
+
+
+def test_generator_pickle_is_opt_in(tmp_path):
+    from rna_map.core.config import BitVectorConfig
+    from rna_map.pipeline.bit_vector_generator import BitVectorGenerator
+    from rna_map.pipeline.functions import generate_bit_vectors
+
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(">ref\nACGTACGTAC\n")
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(
+        "@HD\tVN:1.0\n@SQ\tSN:ref\tLN:10\n"
+        "r1\t0\tref\t1\t40\t10M\t*\t0\t0\tACGAACGTAC\tIIIIIIIIII\n"
+    )
+    config = BitVectorConfig(summary_output_only=True)
+    generate_bit_vectors(sam, fasta, tmp_path / "out", config, paired=False)
+    bv_dir = tmp_path / "out" / "BitVector_Files"
+    assert (bv_dir / "mutation_histos.rmh").exists()
+    assert not (bv_dir / "mutation_histos.p").exists()
+    # a rerun without overwrite is recognized by the binary histograms
+    generator = BitVectorGenerator()
+    generator.setup(
+        {"overwrite": False, "dirs": {"output": str(tmp_path / "out")}, "bit_vector": {}}
+    )
+    assert generator._should_skip_generation()
+
+    config = BitVectorConfig(summary_output_only=True, histogram_pickle=True)
+    generate_bit_vectors(sam, fasta, tmp_path / "pickled", config, paired=False)
+    assert (tmp_path / "pickled" / "BitVector_Files" / "mutation_histos.p").exists()
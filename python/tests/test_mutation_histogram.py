@@ -4,12 +4,20 @@ test mutational histogram
 import os
 import pickle
 import json
+import csv
+import numpy as np
 import pytest
 from pathlib import Path
 
-from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.analysis.mutation_histogram import (
+    COUNT_DTYPE,
+    HistogramStore,
+    MutationHistogram,
+)
 from rna_map.analysis.statistics import (
+    HistogramStats,
     get_dataframe,
+    write_summary_csv,
     merge_mut_histo_dicts,
     merge_all_merge_mut_histo_dicts,
 )
@@ -46,6 +54,40 @@ def test_mutation_histogram():
     assert mh.end == 8
 
 
+def test_counts_allocated_on_first_hit():
+    store = HistogramStore(block_columns=12)
+    mhs = [MutationHistogram(f"c{i}", "ACGT", "DMS", store=store) for i in range(4)]
+    mhs[1].record_skip("low_mapq")
+    assert not any(mh.allocated for mh in mhs)
+    assert store.nbytes == 0
+    mhs[2].mod_bases["C"][2] += 1
+    mhs[3].mut_bases[2] += 1
+    assert mhs[2].allocated and mhs[3].allocated and not mhs[0].allocated
+    # both histograms share the first block, columns packed next to each other
+    assert len(store.blocks) == 1
+    assert mhs[3].counts.dtype == COUNT_DTYPE
+    assert mhs[2].mut_bases[2] == 0
+    assert mhs[2].get_dict()["mod_bases"]["C"] == [0, 0, 1, 0, 0]
+    mhs[0].info_bases[1] += 1
+    assert len(store.blocks) == 2
+
+
+def test_merge_and_pickle_shared_counts():
+    store = HistogramStore()
+    mh = MutationHistogram("c", "ACGT", "DMS", store=store)
+    mh.mut_bases[1] += 2
+    mh.num_of_mutations[1] += 2
+    loaded = pickle.loads(pickle.dumps(mh))
+    assert loaded.get_dict() == mh.get_dict()
+    mh.merge(loaded)
+    mh.merge(MutationHistogram("c", "ACGT", "DMS"))
+    assert mh.mut_bases[1] == 4
+    assert mh.num_of_mutations[1] == 4
+    # unpickled histograms own their counts
+    loaded.mut_bases[1] += 1
+    assert mh.mut_bases[1] == 4
+
+
 def test_merge():
     """
     test merge
@@ -58,6 +100,7 @@ def test_merge():
     for i in range(1, 134):
         assert mh.num_of_mutations[i] == mh2.num_of_mutations[i] * 2
         assert mh.mod_bases["A"][i] == mh2.mod_bases["A"][i] * 2
+        assert mh.del_bases[i] == mh2.del_bases[i] * 2
     assert mh.skips["low_mapq"] == mh2.skips["low_mapq"] * 2
 
 
@@ -200,3 +243,54 @@ def test_plot_population_avg():
     png_file = "mttr-6-alt-h3_1_134_pop_avg.png"
     if os.path.isfile(png_file):
         os.remove(png_file)
+
+
+def _synthetic_mut_histo(name, sequence, seed):
+    rng = np.random.default_rng(seed)
+    mh = MutationHistogram(name, sequence, "DMS")
+    length = len(sequence) + 1
+    mh.info_bases = rng.integers(0, 50, length)
+    mh.mut_bases = rng.integers(0, 5, length)
+    mh.del_bases = rng.integers(0, 3, length)
+    mh.cov_bases = rng.integers(0, 60, length)
+    mh.num_reads = 70
+    mh.num_aligned = 60
+    mh.num_of_mutations = rng.integers(0, 10, length).tolist()
+    return mh
+
+
+def test_histogram_stats_match_per_histogram_methods():
+    mhs = [
+        _synthetic_mut_histo("a", "ACGTACGTACGGA", 1),
+        _synthetic_mut_histo("b", "GGACUUACCA", 2),
+    ]
+    mhs[1].start, mhs[1].end = 3, 8
+    empty = MutationHistogram("empty", "ACGTAC", "DMS")
+    stats = HistogramStats(mhs + [empty])
+    for inc_del in (False, True):
+        for values, mh in zip(stats.pop_avg(inc_del), mhs):
+            assert np.array_equal(values, mh.get_pop_avg(inc_del), equal_nan=True)
+    for values, mh in zip(stats.read_coverage(), mhs):
+        assert np.array_equal(values, mh.get_read_coverage(), equal_nan=True)
+    assert stats.signal_to_noise() == [mh.get_signal_to_noise() for mh in mhs] + [0.0]
+    assert stats.column("percent_mutations") == [
+        mh.get_percent_mutations() for mh in mhs
+    ] + [[0.0] * 5]
+    assert stats.aligned_percentage() == [85.71, 85.71, 0.0]
+    # References without reads are read as zeros, not allocated
+    assert not empty.allocated
+
+
+def test_write_summary_csv_in_blocks(tmp_path):
+    mhs = {
+        name: _synthetic_mut_histo(name, "ACGTACGTACGGA", seed)
+        for seed, name in enumerate(["a", "b", "c"])
+    }
+    cols = ["name", "reads", "aligned", "no_mut", "3plus_mut", "sn"]
+    path = tmp_path / "summary.csv"
+    head = write_summary_csv(mhs.values(), path, cols, head_rows=2, block_size=2)
+    expected = get_dataframe(mhs, cols).values.tolist()
+    assert head == expected[:2]
+    with open(path, newline="") as f:
+        rows = list(csv.reader(f))
+    assert rows == [cols] + [[str(v) for v in row] for row in expected]
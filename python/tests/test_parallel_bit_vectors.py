@@ -0,0 +1,67 @@
+"""
+test parallel bit vector generation
+"""
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.analysis.histogram_accumulator import HistogramAccumulator
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.pipeline.parallel_bit_vectors import iter_batch_results, merge_shards
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def _write_sam(path):
+    reads = [
+        ("r1", 1, 40, "10M", "ACGTACGTAC"),
+        ("r2", 3, 40, "10M", "GTTCGTACGT"),
+        ("r3", 5, 5, "10M", "ACGTACGTAC"),
+        ("r4", 2, 40, "4M2D4M", "CGTAGTAC"),
+        ("r5", 11, 40, "10M", "AGGTACGTAA"),
+    ]
+    lines = [
+        f"{q}\t0\tref\t{pos}\t{mapq}\t{cigar}\t*\t0\t0\t{seq}\t{'I' * len(seq)}\t"
+        "AS:i:0\n"
+        for q, pos, mapq, cigar, seq in reads
+    ]
+    path.write_text(HEADER + "".join(lines))
+
+
+def _new_histos():
+    return {"ref": MutationHistogram("ref", REF_SEQ, "DMS", 1, len(REF_SEQ))}
+
+
+def _serial_histos(sam_path):
+    mut_histos = _new_histos()
+    accumulator = HistogramAccumulator(mut_histos, {"ref": REF_SEQ}, 15)
+    for bit_vector in BitVectorIterator(sam_path, {"ref": REF_SEQ}, False):
+        accumulator.add(bit_vector)
+    return mut_histos["ref"]
+
+
+def _parallel_histos(sam_path, num_workers):
+    mut_histos = _new_histos()
+    accepted = []
+    results = iter_batch_results(
+        sam_path, {"ref": REF_SEQ}, False, num_workers, 15, batch_size=2
+    )
+    for result in results:
+        merge_shards(mut_histos, result.mut_histos)
+        accepted.extend(bv.reads[0].qname for bv in result.accepted)
+    return mut_histos["ref"], accepted
+
+
+def test_parallel_matches_serial(tmp_path):
+    sam_path = tmp_path / "aligned.sam"
+    _write_sam(sam_path)
+    expected = _serial_histos(sam_path)
+    for num_workers in (1, 3):
+        mh, accepted = _parallel_histos(sam_path, num_workers)
+        assert accepted == ["r1", "r2", "r4", "r5"]
+        assert mh.num_reads == expected.num_reads
+        assert mh.num_aligned == expected.num_aligned
+        assert mh.skips == expected.skips
+        assert list(mh.num_of_mutations) == list(expected.num_of_mutations)
+        for attr in ("mut_bases", "info_bases", "del_bases", "cov_bases"):
+            assert list(getattr(mh, attr)) == list(getattr(expected, attr))
+        for base in "ACGT":
+            assert list(mh.mod_bases[base]) == list(expected.mod_bases[base])
@@ -0,0 +1,75 @@
+"""
+test plot selection, the pop_avg.json bundle and rendering from it
+"""
+from rna_map.core.config import BitVectorConfig
+from rna_map.io.plot_bundle import PLOT_BUNDLE_FILE_NAME, PlotMode, read_plot_bundle
+from rna_map.pipeline.functions import _generate_bit_vectors_python
+from rna_map.visualization import plot_scheduler
+from rna_map.visualization.plot_scheduler import render_bundle, select_references
+
+REF_SEQ = "ACGTACGTAC"
+
+
+def test_select_references():
+    num_aligned = {"a": 5, "b": 50, "c": 0, "d": 20}
+    assert select_references(num_aligned, PlotMode.ALL) == ["a", "b", "c", "d"]
+    assert select_references(num_aligned, PlotMode.ALL, min_reads=5) == [
+        "a", "b", "d"
+    ]
+    assert select_references(num_aligned, PlotMode.TOP, top_n=2) == ["b", "d"]
+    assert select_references(num_aligned, PlotMode.NONE) == []
+    assert PlotMode.parse("TOP") == PlotMode.TOP
+    assert PlotMode.parse("bogus") == PlotMode.ALL
+
+
+def _write_inputs(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">many\n{REF_SEQ}\n>few\n{REF_SEQ}\n>none\n{REF_SEQ}\n")
+    header = "@HD\tVN:1.0\n" + "".join(
+        f"@SQ\tSN:{name}\tLN:10\n" for name in ("many", "few", "none")
+    )
+    records = [("many", i) for i in range(3)] + [("few", 3)]
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(
+        header
+        + "".join(
+            f"r{i}\t0\t{name}\t1\t40\t10M\t*\t0\t0\t{REF_SEQ}\t{'I' * 10}\n"
+            for name, i in records
+        )
+    )
+    return sam, fasta
+
+
+def test_generator_plots_selected_references(tmp_path, monkeypatch):
+    plotted = []
+    monkeypatch.setattr(
+        plot_scheduler,
+        "plot_population_avg",
+        lambda df, name, fname, plot_sequence=False: plotted.append(fname),
+    )
+    sam, fasta = _write_inputs(tmp_path)
+    config = BitVectorConfig(plot_mode=PlotMode.TOP, plot_top_n=2, plot_min_reads=1)
+    _generate_bit_vectors_python(sam, fasta, tmp_path / "out", config, paired=False)
+    bv_dir = tmp_path / "out" / "BitVector_Files"
+    assert plotted == [
+        f"{bv_dir}/many_1_10_pop_avg.png", f"{bv_dir}/few_1_10_pop_avg.png"
+    ]
+    bundle = read_plot_bundle(bv_dir / PLOT_BUNDLE_FILE_NAME)
+    assert list(bundle) == ["many", "few", "none"]
+    assert bundle["many"]["num_aligned"] == 3
+    assert bundle["many"]["mismatches"] == [0.0] * 10
+    assert bundle["none"]["sequence"] == REF_SEQ
+    # references without reads are null-filled; the bundle is strict JSON
+    assert bundle["none"]["mismatches"] == [None] * 10
+    assert bundle["none"]["mismatch_del"] == [None] * 10
+    assert "NaN" not in (bv_dir / PLOT_BUNDLE_FILE_NAME).read_text()
+
+    plotted.clear()
+    config = BitVectorConfig(plot_mode=PlotMode.NONE)
+    _generate_bit_vectors_python(sam, fasta, tmp_path / "lazy", config, paired=False)
+    assert plotted == []
+    lazy_dir = tmp_path / "lazy" / "BitVector_Files"
+    assert render_bundle(lazy_dir / PLOT_BUNDLE_FILE_NAME, tmp_path, ["few"]) == [
+        "few"
+    ]
+    assert plotted == [f"{tmp_path}/few_1_10_pop_avg.png"]
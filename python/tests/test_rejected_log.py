@@ -0,0 +1,94 @@
+"""
+test the rejected read log modes
+"""
+import gzip
+
+import pytest
+
+from rna_map.analysis.mutation_histogram import MutationHistogram
+from rna_map.core.bit_vector import BitVector
+from rna_map.core.config import BitVectorConfig
+from rna_map.io.rejected_log import (
+    HEADER,
+    RejectedLog,
+    RejectedLogMode,
+    write_rejected_counts,
+)
+from rna_map.io.sam import AlignedRead
+from rna_map.pipeline.functions import _generate_bit_vectors_python
+
+REF_SEQ = "ACGTACGTAC"
+HEADER_SAM = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:10\n@PG\tID:bowtie2\n"
+
+
+def _bit_vector(i):
+    read = AlignedRead(
+        f"q{i}", "0", "ref", 1, 5, "4M", "*", 0, 0, "ACGT", "IIII", "4"
+    )
+    return BitVector([read], {1: "0", 2: "A", 3: "1", 4: "?"})
+
+
+def _rows(path, opener=open):
+    with opener(path, "rt") as f:
+        lines = f.readlines()
+    assert lines[0] == HEADER
+    return [line.split(",")[0] for line in lines[1:]]
+
+
+def test_full_and_sampled(tmp_path):
+    log = RejectedLog(tmp_path, buffer_bytes=100)
+    for i in range(10):
+        log.add(_bit_vector(i), "low_mapq", 1, 4)
+    log.close()
+    assert _rows(log.path) == [f"q{i}" for i in range(10)]
+    with open(log.path) as f:
+        assert f.readlines()[1] == "q0,ref,low_mapq,ACGT,,0A1?\n"
+
+    log = RejectedLog(tmp_path, sample_every=4, compress=True)
+    for i in range(10):
+        log.add(_bit_vector(i), "low_mapq", 1, 4)
+    log.close()
+    assert log.path.name == "rejected_bvs.csv.gz"
+    assert _rows(log.path, gzip.open) == ["q0", "q4", "q8"]
+    assert (log.num_rejected, log.num_written) == (10, 3)
+    with pytest.raises(ValueError):
+        RejectedLog(tmp_path, sample_every=0)
+
+
+def test_write_rejected_counts(tmp_path):
+    mh = MutationHistogram("ref", REF_SEQ, "DMS")
+    mh.record_skip("low_mapq")
+    mh.record_skip("low_mapq")
+    empty = MutationHistogram("other", REF_SEQ, "DMS")
+    path = tmp_path / "rejected_counts.csv"
+    write_rejected_counts({"ref": mh.skips, "other": empty.skips}, path)
+    assert path.read_text() == "rname,reason,count\nref,low_mapq,2\n"
+
+
+def test_modes_in_generator(tmp_path):
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(
+        HEADER_SAM
+        + "".join(
+            f"r{i}\t0\tref\t1\t{40 if i % 2 else 5}\t10M\t*\t0\t0\t{REF_SEQ}\t"
+            f"{'I' * 10}\tAS:i:0\n"
+            for i in range(6)
+        )
+    )
+    for mode in RejectedLogMode:
+        out_dir = tmp_path / mode.value
+        config = BitVectorConfig(summary_output_only=True, rejected_log=mode)
+        _generate_bit_vectors_python(sam, fasta, out_dir, config, paired=False)
+        bv_dir = out_dir / "BitVector_Files"
+        has_rows = (bv_dir / "rejected_bvs.csv").exists()
+        has_counts = (bv_dir / "rejected_counts.csv").exists()
+        assert has_rows == (mode in (RejectedLogMode.SAMPLED, RejectedLogMode.FULL))
+        assert has_counts == (mode == RejectedLogMode.COUNTS)
+    assert _rows(tmp_path / "full" / "BitVector_Files" / "rejected_bvs.csv") == [
+        "r0", "r2", "r4"
+    ]
+    assert _rows(tmp_path / "sampled" / "BitVector_Files" / "rejected_bvs.csv") == [
+        "r0"
+    ]
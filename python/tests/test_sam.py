@@ -3,7 +3,7 @@ test sam module
 """
 import os
 from pathlib import Path
-from rna_map.io.sam import SingleSamIterator
+from rna_map.io.sam import SingleSamIterator, get_aligned_read_from_line
 from rna_map.io.fasta import fasta_to_dict
 
 from conftest import TEST_DATA_DIR
@@ -24,3 +24,48 @@ def test_single_sam_iterator():
     assert read.rnext == "*"
     assert read.pnext == 0
     assert read.tlen == 0
+
+
+def test_get_aligned_read_from_line_md_tag():
+    fields = ["q", "0", "ref", "1", "40", "4M", "*", "0", "0", "ACGT", "IIII"]
+    line = "\t".join(fields + ["AS:i:0", "XN:i:0", "MD:Z:2A1"])
+    assert get_aligned_read_from_line(line).md_string == "2A1"
+    assert get_aligned_read_from_line("\t".join(fields + ["AS:i:0"])).md_string == ""
+    assert get_aligned_read_from_line("\t".join(fields)).md_string == ""
+
+
+def test_iterators_detect_header(tmp_path):
+    from rna_map.io.sam import PairedSamIterator
+
+    # header length does not follow the number of references
+    header = "@HD\tVN:1.0\n@SQ\tSN:ref\tLN:8\n@SQ\tSN:other\tLN:8\n@PG\tID:bt2\n"
+    record = "q{}\t{}\tref\t1\t40\t4M\t=\t1\t4\tACGT\tIIII\n"
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(header + record.format(1, 99) + record.format(1, 147))
+    single = [reads[0].flag for reads in SingleSamIterator(sam, {"ref": "A"})]
+    assert single == ["99", "147"]
+    pairs = list(PairedSamIterator(sam, {"ref": "A"}))
+    assert [[read.flag for read in reads] for reads in pairs] == [["99", "147"]]
+
+
+def test_paired_iterators_skip_any_number_of_inconsistent_pairs(tmp_path):
+    from rna_map.io.sam import PairedSamIterator
+    from rna_map.io.sam_reader import iter_sam_fields
+
+    header = "@HD\tVN:1.0\n@SQ\tSN:ref\tLN:8\n@PG\tID:bt2\n"
+    record = "q{}\t{}\tref\t{}\t40\t4M\t=\t{}\t4\tACGT\tIIII\n"
+    # mate 2 does not start where mate 1 expects it
+    bad = [record.format(i, 99, 1, 3) + record.format(i, 147, 5, 1) for i in range(150)]
+    good = record.format("ok", 99, 1, 5) + record.format("ok", 147, 5, 1)
+    sam = tmp_path / "aligned.sam"
+    sam.write_text(header + "".join(bad) + good)
+    pairs = list(PairedSamIterator(sam, {"ref": "A"}))
+    assert [[read.qname for read in reads] for reads in pairs] == [["qok", "qok"]]
+    fields = list(iter_sam_fields(sam, paired=True))
+    assert [[f[0] for f in record] for record in fields] == [["qok", "qok"]]
+
+
+def test_fasta_to_dict_multiline(tmp_path):
+    fa_path = tmp_path / "refs.fasta"
+    fa_path.write_text(">ref\nACGT\nAC\n>other\nGG\n")
+    assert fasta_to_dict(fa_path) == {"ref": "ACGTAC", "other": "GG"}
@@ -0,0 +1,73 @@
+"""
+test sam_reader module
+"""
+from rna_map.io.sam_reader import (
+    _pair_records,
+    get_md_tag,
+    is_proper_pair,
+    iter_sam_fields,
+)
+
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def _sam_line(qname, flag, pos, rnext="*", pnext=0, mapq=40):
+    return (
+        f"{qname}\t{flag}\tref\t{pos}\t{mapq}\t10M\t{rnext}\t{pnext}\t0\t"
+        "ACGTACGTAC\tIIIIIIIIII\tAS:i:0\tMD:Z:10\n"
+    )
+
+
+def test_iter_sam_fields_single(tmp_path):
+    sam_path = tmp_path / "single.sam"
+    sam_path.write_text(HEADER + _sam_line("r1", 0, 1) + _sam_line("r2", 0, 3))
+    records = list(iter_sam_fields(sam_path, paired=False))
+    assert len(records) == 2
+    assert records[0][0][0] == "r1"
+    assert records[1][0][3] == "3"
+
+
+def test_iter_sam_fields_paired_skips_inconsistent(tmp_path):
+    sam_path = tmp_path / "paired.sam"
+    lines = [
+        _sam_line("r1", 99, 1, "=", 5),
+        _sam_line("r1", 147, 5, "=", 1),
+        _sam_line("r2", 99, 1, "=", 7),
+        _sam_line("r2", 147, 5, "=", 1),
+    ]
+    sam_path.write_text(HEADER + "".join(lines))
+    records = list(iter_sam_fields(sam_path, paired=True))
+    assert len(records) == 1
+    assert [fields[0] for fields in records[0]] == ["r1", "r1"]
+
+
+def test_pair_records_by_qname():
+    # BAM records arrive with unmapped mates already dropped
+    lines = [
+        _sam_line("r1", 99, 1, "=", 5),
+        _sam_line("r2", 99, 1, "=", 5),
+        _sam_line("r2", 147, 5, "=", 1),
+        _sam_line("r3", 99, 1, "=", 5),
+        _sam_line("r3", 147, 5, "=", 1),
+        _sam_line("r4", 99, 1, "=", 5),
+    ]
+    records = iter(line.rstrip("\n").split("\t") for line in lines)
+    pairs = list(_pair_records(records))
+    assert [[fields[0] for fields in pair] for pair in pairs] == [
+        ["r2", "r2"],
+        ["r3", "r3"],
+    ]
+
+
+def test_get_md_tag():
+    fields = _sam_line("r1", 0, 1).rstrip("\n").split("\t")
+    assert get_md_tag(fields) == "10"
+    assert get_md_tag(fields[:11]) == ""
+
+
+def test_is_proper_pair():
+    mate_1 = _sam_line("r1", 99, 1, "=", 5).split("\t")
+    mate_2 = _sam_line("r1", 147, 5, "=", 1).split("\t")
+    other = _sam_line("r2", 147, 5, "=", 1).split("\t")
+    assert is_proper_pair(mate_1, mate_2)
+    assert not is_proper_pair(mate_1, other)
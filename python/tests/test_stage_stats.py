@@ -0,0 +1,70 @@
+"""
+test bit vector stage timers and counters
+"""
+import json
+import os
+
+from rna_map.analysis.stage_stats import STAGES, StageStats
+from rna_map.core.config import BitVectorConfig
+from rna_map.pipeline.functions import generate_bit_vectors
+
+REF_SEQ = "ACGTACGTACGTACGTACGT"
+HEADER = "@HD\tVN:1.0\tSO:unsorted\n@SQ\tSN:ref\tLN:20\n@PG\tID:bowtie2\n"
+
+
+def test_stage_stats_merge_and_dict(tmp_path):
+    stats = StageStats("python")
+    with stats.timed("plots"):
+        pass
+    stats.add("kernel", 1.5)
+    stats.count("reads", 3)
+    worker = StageStats("parallel")
+    worker.add("kernel", 0.5)
+    worker.count("reads", 2)
+    stats.merge(worker)
+    data = stats.to_dict({"low_mapq": 1})
+    assert data["reads"] == 5
+    assert data["stage_seconds"]["kernel"] == 2.0
+    assert set(data["stage_seconds"]) == set(STAGES)
+    assert data["rejects"] == {"low_mapq": 1}
+    stats.write_json(tmp_path / "stats.json")
+    assert json.loads((tmp_path / "stats.json").read_text())["engine"] == "python"
+
+
+def test_bytes_read_left_out_for_streams(tmp_path):
+    sam_path = tmp_path / "aligned.sam"
+    sam_path.write_text(HEADER)
+    fifo = tmp_path / "sam.fifo"
+    os.mkfifo(fifo)
+    stats = StageStats()
+    stats.count_input_bytes(fifo)
+    assert stats.to_dict()["bytes_read"] is None
+    stats.count_input_bytes(sam_path)
+    assert stats.to_dict()["bytes_read"] == len(HEADER)
+
+
+def test_generator_writes_stats(tmp_path):
+    reads = [("r1", 40, "ACGAACGTAC"), ("r2", 40, "ACGTACGTAC"), ("r3", 5, "ACGTACGTAC")]
+    sam_path = tmp_path / "aligned.sam"
+    sam_path.write_text(
+        HEADER
+        + "".join(
+            f"{q}\t0\tref\t1\t{mapq}\t10M\t*\t0\t0\t{seq}\t{'I' * 10}\tAS:i:0\n"
+            for q, mapq, seq in reads
+        )
+    )
+    fasta = tmp_path / "ref.fa"
+    fasta.write_text(f">ref\n{REF_SEQ}\n")
+    result = generate_bit_vectors(
+        sam_path, fasta, tmp_path / "out", BitVectorConfig(summary_output_only=True),
+        paired=False,
+    )
+    stats_file = result.summary_path.parent / "bit_vector_stats.json"
+    data = json.loads(stats_file.read_text())
+    assert data["engine"] == "python"
+    assert data["reads"] == 3
+    assert data["accepted"] == 2
+    assert data["bytes_read"] == sam_path.stat().st_size
+    assert data["rejects"]["low_mapq"] == 1
+    # no read has a deletion, so the ambiguity table was never consulted
+    assert data["counters"]["ambig_hits"] == data["counters"]["ambig_misses"] == 0
@@ -0,0 +1,62 @@
+"""
+test bounded streaming stages
+"""
+import threading
+import time
+
+import pytest
+
+from rna_map.pipeline.streaming import EST_RECORD_BYTES, iter_bounded, plan_window
+
+
+def test_iter_bounded_keeps_order():
+    assert list(iter_bounded(iter(range(100)), depth=2)) == list(range(100))
+
+
+def test_iter_bounded_limits_read_ahead():
+    produced = []
+
+    def items():
+        for i in range(50):
+            produced.append(i)
+            yield i
+
+    stream = iter_bounded(items(), depth=3)
+    assert next(stream) == 0
+    # one item handed out, at most depth queued and one blocked on put
+    assert len(produced) <= 5
+    stream.close()
+
+
+def test_iter_bounded_close_does_not_wait_on_blocked_source():
+    release = threading.Event()
+
+    def items():
+        yield 1
+        release.wait()  # a read that never returns while the consumer is open
+        yield 2
+
+    stream = iter_bounded(items())
+    assert next(stream) == 1
+    start = time.monotonic()
+    stream.close()
+    assert time.monotonic() - start < 5
+    release.set()
+
+
+def test_iter_bounded_reraises_producer_error():
+    def items():
+        yield 1
+        raise ValueError("bad record")
+
+    stream = iter_bounded(items())
+    assert next(stream) == 1
+    with pytest.raises(ValueError):
+        next(stream)
+
+
+def test_plan_window():
+    assert plan_window(None, 5000, 8) == (5000, 8)
+    batch_size, batches = plan_window(64, 5000, 8)
+    assert batch_size * batches * EST_RECORD_BYTES <= 64 * 2**20
+    assert plan_window(1, 5000, 8)[0] >= 1
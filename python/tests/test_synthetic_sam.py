@@ -0,0 +1,63 @@
+"""
+test synthetic SAM generation and benchmark reports
+"""
+import re
+
+from rna_map.analysis.bit_vector_iterator import BitVectorIterator
+from rna_map.benchmark.runner import build_report, compare_reports, run_engine
+from rna_map.benchmark.synthetic_sam import SyntheticSamSpec, write_synthetic_dataset
+from rna_map.io.fasta import fasta_to_dict
+from rna_map.io.sam_reader import iter_sam_fields
+
+
+def _check_record(fields, ref_seq):
+    seq, md = fields[9], fields[-1][len("MD:Z:"):]
+    ops = re.findall(r"(\d+)([MID])", fields[5])
+    assert sum(int(n) for n, op in ops if op in "MI") == len(seq)
+    # walk the MD tag and check it against the reference
+    ref_i = int(fields[3]) - 1
+    for token in re.findall(r"\d+|\^[ACGT]+|[ACGT]", md):
+        if token.isdigit():
+            ref_i += int(token)
+        elif token.startswith("^"):
+            assert ref_seq[ref_i : ref_i + len(token) - 1] == token[1:]
+            ref_i += len(token) - 1
+        else:
+            assert ref_seq[ref_i] == token
+            ref_i += 1
+    assert ref_i - int(fields[3]) + 1 == sum(int(n) for n, op in ops if op in "MD")
+
+
+def test_synthetic_dataset_is_consistent(tmp_path):
+    spec = SyntheticSamSpec(
+        num_reads=100, read_length=30, num_references=2, reference_length=50,
+        mutation_rate=0.05, indel_rate=0.05, paired=True,
+    )
+    dataset = write_synthetic_dataset(spec, tmp_path)
+    ref_seqs = fasta_to_dict(dataset.fasta)
+    assert sorted(ref_seqs) == ["ref_0", "ref_1"]
+    records = list(iter_sam_fields(dataset.sam, True))
+    assert len(records) == 100
+    assert dataset.num_bases == sum(len(f[9]) for r in records for f in r)
+    for record in records:
+        for fields in record:
+            _check_record(fields, ref_seqs[fields[2]])
+
+
+def test_benchmark_report(tmp_path):
+    spec = SyntheticSamSpec(num_reads=20, read_length=12, reference_length=40)
+    dataset = write_synthetic_dataset(spec, tmp_path)
+    bit_vectors = list(
+        BitVectorIterator(dataset.sam, fasta_to_dict(dataset.fasta), False)
+    )
+    assert len(bit_vectors) == 20
+
+    result = run_engine("python", dataset.sam, dataset.fasta, False, dataset.num_bases)
+    assert result.status == "ok"
+    assert result.num_reads == 20
+    assert result.num_bases == 240
+    report = build_report(spec.to_dict(), [result])
+    assert report["dataset"]["num_reads"] == 20
+    faster = build_report(spec.to_dict(), [result])
+    faster["results"][0]["reads_per_sec"] *= 2
+    assert compare_reports(report, faster) == {"python": 2.0}
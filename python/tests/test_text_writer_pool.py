@@ -0,0 +1,71 @@
+"""
+test the pooled text bit vector writer for many references
+"""
+from collections import namedtuple
+import random
+
+from rna_map.io.bit_vector_storage import (
+    StorageFormat,
+    TextStorageWriter,
+    TextWriterPool,
+    create_storage_writer,
+)
+
+Read = namedtuple("Read", ["qname", "rname"])
+
+
+def _records(num_refs, num_reads):
+    rng = random.Random(0)
+    ref_seqs = {f"ref_{i}": "ACGT" * (i + 2) for i in range(num_refs)}
+    records = []
+    for i in range(num_reads):
+        name = f"ref_{rng.randrange(num_refs - 1)}"  # the last reference gets no reads
+        length = len(ref_seqs[name])
+        data = {pos: "0" for pos in range(1, length + 1, 2)}
+        data[2] = rng.choice("ACGT1?")
+        records.append((f"q{i}", data, [Read(f"q{i}", name)]))
+    return ref_seqs, records
+
+
+def test_pool_matches_per_reference_writers(tmp_path):
+    ref_seqs, records = _records(10, 500)
+    expected_dir = tmp_path / "expected"
+    expected_dir.mkdir()
+    writers = {
+        name: TextStorageWriter(expected_dir, name, seq, "DMS", 1, len(seq))
+        for name, seq in ref_seqs.items()
+    }
+    for qname, data, reads in records:
+        writers[reads[0].rname].write_bit_vector(qname, data, reads)
+    for writer in writers.values():
+        writer.close()
+
+    pool_dir = tmp_path / "pool"
+    pool_dir.mkdir()
+    pool = TextWriterPool(pool_dir, ref_seqs, max_open=2, buffer_bytes=200)
+    for qname, data, reads in records:
+        pool.write_bit_vector(qname, data, reads)
+    pool.close()
+
+    # files are reopened for appending when evicted and flushed again
+    assert pool.files_opened > len(ref_seqs)
+    for name in ref_seqs:
+        file_name = f"{name}_bitvectors.txt"
+        expected = (expected_dir / file_name).read_text()
+        assert (pool_dir / file_name).read_text() == expected
+
+
+def test_pool_skips_unknown_references(tmp_path):
+    pool = TextWriterPool(tmp_path, {"ref": "ACGT"})
+    pool.write_bit_vector("q0", {1: "0"}, [Read("q0", "other")])
+    pool.close()
+    assert [p.name for p in tmp_path.iterdir()] == ["ref_bitvectors.txt"]
+    assert pool.files_opened == 0
+
+
+def test_create_storage_writer_returns_pool(tmp_path):
+    writer = create_storage_writer(
+        StorageFormat.TEXT, tmp_path, ref_seqs={"ref": "ACGT"}
+    )
+    assert isinstance(writer, TextWriterPool)
+    writer.close()
@@ -210,6 +210,7 @@ nextflow run main.nf \
     --output_dir "$OUTPUT_DIR" \
     --split_fastq \
     --chunk_size "$CHUNK_SIZE" \
+    --join_sam \
     --skip_fastqc \
     --skip_trim_galore \
     -with-report test_report_parallel.html \
@@ -258,7 +259,7 @@ JSON_FILE=$(find "${OUTPUT_DIR}" -name "mutation_histos.json" -path "*/BitVector
 if [ -n "${JSON_FILE}" ] && [ -f "${JSON_FILE}" ]; then
     echo "✅ Mutation histograms JSON found: ${JSON_FILE}"
 else
-    echo "❌ Mutation histograms JSON not found"
+    echo "⚠️  Mutation histograms JSON not found (only written with --histogram_json)"
 fi
 
 echo ""
@@ -0,0 +1,64 @@
+/*
+ * Bowtie2 Index Subworkflow
+ *
+ * Builds one Bowtie2 index per distinct reference and fans it out to every
+ * sample that uses it. Samples are keyed by the SHA-256 of their FASTA
+ * content, so copies of a reference under different paths share an index.
+ *
+ * Only the references are taken, so the index is built straight from the
+ * sample sheet, while reads are still being trimmed or split. Callers
+ * combine the emitted index with their reads by sample_id.
+ */
+
+// Include required modules
+include { BOWTIE2_BUILD } from '../modules/bowtie2_build.nf'
+
+// SHA-256 of a file's content, read in blocks
+def fastaContentHash(fasta) {
+    def digest = java.security.MessageDigest.getInstance('SHA-256')
+    fasta.withInputStream { stream ->
+        def buffer = new byte[1 << 16]
+        def n
+        while ((n = stream.read(buffer)) > 0) {
+            digest.update(buffer, 0, n)
+        }
+    }
+    digest.digest().encodeHex().toString()
+}
+
+workflow BOWTIE2_INDEX {
+    take:
+    references_ch  // channel: [sample_id, fasta]
+
+    main:
+    // Each distinct FASTA path is hashed once, however many samples use it
+    references_ch
+        .map { sample_id, fasta -> [fasta.toString(), sample_id, fasta] }
+        .groupTuple(by: 0)
+        .flatMap { _path, sample_ids, fastas ->
+            def ref_key = fastaContentHash(fastas[0])
+            sample_ids.collect { sample_id -> [ref_key, sample_id, fastas[0]] }
+        }
+        .set { keyed_samples }
+
+    // One build per distinct reference
+    keyed_samples
+        .map { ref_key, _sample_id, fasta -> [ref_key, fasta] }
+        .unique { ref_key, _fasta -> ref_key }
+        .set { references }
+
+    BOWTIE2_BUILD(references)
+
+    // The index files keep the name of the FASTA they were built from, which may
+    // differ from a sample's own FASTA; the align processes take the index prefix
+    // from the index files
+    keyed_samples
+        .combine(BOWTIE2_BUILD.out, by: 0)
+        .map { _ref_key, sample_id, _fasta, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2 ->
+            [sample_id, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2]
+        }
+        .set { sample_indices }
+
+    emit:
+    out = sample_indices  // [sample_id, index_files]
+}
@@ -8,7 +8,7 @@
 // Include required modules
 include { FASTQC } from '../modules/fastqc.nf'
 include { TRIM_GALORE } from '../modules/trim_galore.nf'
-include { BOWTIE2_BUILD } from '../modules/bowtie2_build.nf'
+include { BOWTIE2_INDEX } from './bowtie2_index.nf'
 include { BOWTIE2_ALIGN } from '../modules/bowtie2_align.nf'
 
 workflow MAPPING {
@@ -22,19 +22,24 @@ workflow MAPPING {
     bt2_alignment_args
     
     main:
-    // Step 1: FastQC (optional)
+    // Step 1: Build Bowtie2 index (once per distinct reference), alongside QC and trimming
+    BOWTIE2_INDEX(samples_ch.map { sample_id, fasta, _fq1, _fq2, _dot_bracket -> [sample_id, fasta] })
+    
+    // Step 2: FastQC (optional)
     FASTQC(samples_ch, skip_fastqc, fastqc_args)
     
-    // Step 2: Trim Galore (optional)
+    // Step 3: Trim Galore (optional)
     TRIM_GALORE(FASTQC.out, skip_trim_galore, tg_q_cutoff, tg_args)
     
-    // Step 3: Build Bowtie2 index
-    BOWTIE2_BUILD(TRIM_GALORE.out)
-    
     // Step 4: Bowtie2 alignment
     // BOWTIE2_ALIGN expects: tuple with [sample_id, fasta, index_files, trimmed_fq1, trimmed_fq2, dot_bracket], bt2_args
-    // BOWTIE2_BUILD.out has: [sample_id, fasta, index_files, trimmed_fq1, trimmed_fq2, dot_bracket]
-    BOWTIE2_ALIGN(BOWTIE2_BUILD.out, bt2_alignment_args)
+    TRIM_GALORE.out
+        .combine(BOWTIE2_INDEX.out.out, by: 0)
+        .map { sample_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2 ->
+            [sample_id, fasta, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2, trimmed_fq1, trimmed_fq2, dot_bracket]
+        }
+        .set { align_input }
+    BOWTIE2_ALIGN(align_input, bt2_alignment_args)
     
     emit:
     aligned = BOWTIE2_ALIGN.out.aligned
@@ -9,9 +9,10 @@
 include { SPLIT_FASTQ } from '../modules/split_fastq.nf'
 include { FASTQC } from '../modules/fastqc.nf'
 include { TRIM_GALORE } from '../modules/trim_galore.nf'
-include { BOWTIE2_BUILD } from '../modules/bowtie2_build.nf'
+include { BOWTIE2_INDEX } from './bowtie2_index.nf'
 include { BOWTIE2_ALIGN } from '../modules/bowtie2_align.nf'
 include { RNA_MAP_BIT_VECTORS } from '../modules/rna_map_bit_vectors.nf'
+include { RNA_MAP_BIT_VECTOR_SERVER } from '../modules/rna_map_bit_vector_server.nf'
 include { JOIN_SAM } from '../modules/join_sam.nf'
 include { JOIN_MUTATION_HISTOS } from '../modules/join_mutation_histos.nf'
 include { JOIN_BIT_VECTORS } from '../modules/join_bit_vectors.nf'
@@ -25,13 +26,18 @@ workflow PARALLEL_MAPPING {
     tg_q_cutoff
     tg_args
     bt2_alignment_args
-    chunk_size  // Number of reads per chunk
+    chunk_size  // Number of reads per chunk, or "auto"
     qscore_cutoff
     map_score_cutoff
     summary_output_only
     plot_sequence
     
     main:
+    // The index is built once per distinct reference from the sample sheet, so
+    // it is ready by the time chunks are trimmed (and linked from
+    // params.bt2_index_cache on later launches)
+    BOWTIE2_INDEX(samples_ch.map { sample_id, fasta, _fq1, _fq2, _dot_bracket -> [sample_id, fasta] })
+    
     // Step 1: Split FASTQ files into chunks
     SPLIT_FASTQ(samples_ch, chunk_size)
     
@@ -71,53 +77,71 @@ workflow PARALLEL_MAPPING {
         }
         .set { chunk_samples }
     
-    // Step 4: Build index first (use original sample, not chunks)
-    // This needs to complete before we can align chunks
-    samples_ch.first()
-        .map { sample_id, fasta, fastq1, fastq2, dot_bracket ->
-            [sample_id, fasta, fastq1, fastq2, dot_bracket]
-        }
-        .set { index_input }
-    
-    BOWTIE2_BUILD(index_input)
-    
-    // Step 5: Process each chunk in parallel
+    // Step 4: Process each chunk in parallel
     // Trim each chunk
     TRIM_GALORE(chunk_samples, skip_trim_galore, tg_q_cutoff, tg_args)
     
-    // Step 6: Align each chunk (in parallel)
-    // Use combine() without 'by' to create cartesian product (like cross())
-    // This will pair each trimmed chunk with the index
-    BOWTIE2_BUILD.out
-        .map { _sample_id, _fasta, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2, _t1, _t2, _db -> 
-            [idx1, idx2, idx3, idx4, idx_rev1, idx_rev2]
-        }
-        .set { index_ch }
-    
-    // Use combine() without 'by' - creates cartesian product: each trimmed chunk × index
+    // Step 5: Align each chunk (in parallel) against the index of its sample
     TRIM_GALORE.out
-        .combine(index_ch)
-        .map { chunk_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2 ->
+        .map { chunk_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket ->
+            def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
+            [sample_id, chunk_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket]
+        }
+        .combine(BOWTIE2_INDEX.out.out, by: 0)
+        .map { _sample_id, chunk_id, fasta, trimmed_fq1, trimmed_fq2, dot_bracket, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2 ->
             [chunk_id, fasta, idx1, idx2, idx3, idx4, idx_rev1, idx_rev2, trimmed_fq1, trimmed_fq2, dot_bracket]
         }
         .set { align_input }
     
     BOWTIE2_ALIGN(align_input, bt2_alignment_args)
     
-    // Step 5: Generate bit vectors on each chunk (in parallel)
+    // Step 6: Generate bit vectors on each chunk (in parallel)
     // Access the aligned output channel (not stats)
-    RNA_MAP_BIT_VECTORS(BOWTIE2_ALIGN.out.aligned, qscore_cutoff, map_score_cutoff, summary_output_only, plot_sequence)
+    def chunk_batch = params.chunk_bit_vector_batch ?: (chunk_size.toString() == "auto" ? 8 : 1)
+    if (chunk_batch > 1) {
+        // Batches of chunks of a sample; each task pays process startup and
+        // reference loading once, and its workers pull chunks off the batch
+        BOWTIE2_ALIGN.out.aligned
+            .map { chunk_id, sam, fasta, is_paired_file, dot_bracket ->
+                def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
+                [sample_id, chunk_id, sam, fasta, is_paired_file.text.trim(), dot_bracket]
+            }
+            .groupTuple(by: 0, size: chunk_batch, remainder: true)
+            .map { _sample_id, chunk_ids, sams, fastas, is_paired_list, dot_brackets ->
+                [chunk_ids, sams, fastas[0], is_paired_list, dot_brackets]
+            }
+            .set { server_input }
+        
+        RNA_MAP_BIT_VECTOR_SERVER(server_input, qscore_cutoff, map_score_cutoff, summary_output_only, plot_sequence)
+        
+        // samples/<chunk_id>/BitVector_Files/... -> [chunk_id, files]
+        RNA_MAP_BIT_VECTOR_SERVER.out.summaries
+            .flatten()
+            .map { summary_file -> [summary_file.parent.parent.name, summary_file] }
+            .set { chunk_summaries }
+        RNA_MAP_BIT_VECTOR_SERVER.out.bitvector_files
+            .flatten()
+            .map { bv_file ->
+                [bv_file.toString().replaceAll(/^.*\/samples\/([^\/]+)\/BitVector_Files\/.*$/, '$1'), bv_file]
+            }
+            .groupTuple(by: 0)
+            .set { chunk_bitvector_files }
+    } else {
+        RNA_MAP_BIT_VECTORS(BOWTIE2_ALIGN.out.aligned, qscore_cutoff, map_score_cutoff, summary_output_only, plot_sequence)
+        RNA_MAP_BIT_VECTORS.out.summary.set { chunk_summaries }
+        RNA_MAP_BIT_VECTORS.out.bitvector_files.set { chunk_bitvector_files }
+    }
     
-    // Step 6: Join results from all chunks
+    // Step 7: Join results from all chunks
     // Group by original sample_id
-    RNA_MAP_BIT_VECTORS.out.summary
+    chunk_summaries
         .map { chunk_id, _summary ->
             def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
             [sample_id, chunk_id]
         }
         .groupTuple(by: 0)
     
-    RNA_MAP_BIT_VECTORS.out.bitvector_files
+    chunk_bitvector_files
         .map { chunk_id, bv_files ->
             def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
             // Extract parent directory from first bitvector file
@@ -141,18 +165,20 @@ workflow PARALLEL_MAPPING {
         }
         .set { sam_metadata }
     
-    // Join SAM files
-    JOIN_SAM(sam_metadata)
+    // Join SAM files (only on request; bit vectors and histograms are merged from chunks)
+    if (params.join_sam) {
+        JOIN_SAM(sam_metadata)
+    }
     
     // Join mutation histograms (from bit vector output directories)
-    // Get mutation histogram files directly from RNA_MAP_BIT_VECTORS output
-    RNA_MAP_BIT_VECTORS.out.bitvector_files
+    // Get mutation histogram files directly from the bit vector outputs
+    chunk_bitvector_files
         .map { chunk_id, bv_files ->
             def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
-            // Extract parent directory from first bitvector file to find mutation_histos.p
+            // Extract parent directory from first bitvector file to find mutation_histos.rmh
             def bv_files_list = bv_files instanceof List ? bv_files : [bv_files]
             def bv_dir = file(bv_files_list[0].toString()).parent
-            def mut_histo_p = file("${bv_dir}/mutation_histos.p")
+            def mut_histo_p = file("${bv_dir}/mutation_histos.rmh")
             def mut_histo_json = file("${bv_dir}/mutation_histos.json")
             [sample_id, mut_histo_p, mut_histo_json]
         }
@@ -169,8 +195,8 @@ workflow PARALLEL_MAPPING {
     JOIN_MUTATION_HISTOS(mut_histo_input)
     
     // Join bit vector files
-    // Get bit vector files directly from RNA_MAP_BIT_VECTORS output
-    RNA_MAP_BIT_VECTORS.out.bitvector_files
+    // Get bit vector files directly from the bit vector outputs
+    chunk_bitvector_files
         .map { chunk_id, bv_files ->
             def sample_id = chunk_id.replaceAll(/^(.*)_chunk[0-9]+$/, '$1')
             [sample_id, bv_files]
@@ -187,8 +213,9 @@ workflow PARALLEL_MAPPING {
     
     JOIN_BIT_VECTORS(bv_join_input)
     
-    // Create final aligned channel (from joined SAM - mutation histos already joined)
-    JOIN_SAM.out
+    // Create final aligned channel (from joined SAM - mutation histos already joined).
+    // Without join_sam the channel carries JOIN_MUTATION_HISTOS' placeholder SAM
+    (params.join_sam ? JOIN_SAM.out : JOIN_MUTATION_HISTOS.out.out)
         .set { final_aligned }
     
     emit: